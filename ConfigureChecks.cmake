@@ -14,11 +14,15 @@ CHECK_INCLUDE_FILE(libgen.h HAVE_LIBGEN_H)
 CHECK_INCLUDE_FILE(unistd.h HAVE_UNISTD_H)
 CHECK_INCLUDE_FILE(direct.h HAVE_DIRECT_H)
 CHECK_INCLUDE_FILE(stdint.h HAVE_STDINT_H)
+CHECK_INCLUDE_FILE(sys/time.h HAVE_SYS_TIME_H)
+CHECK_INCLUDE_FILE(sys/resource.h HAVE_SYS_RESOURCE_H)
 
 CHECK_SYMBOL_EXISTS(abort "stdlib.h" HAVE_ABORT)
 
 CHECK_FUNCTION_EXISTS(getcwd HAVE_GETCWD)
 CHECK_FUNCTION_EXISTS(toascii HAVE_TOASCII)
+CHECK_FUNCTION_EXISTS(gettimeofday HAVE_GETTIMEOFDAY)
+CHECK_FUNCTION_EXISTS(getrusage HAVE_GETRUSAGE)
 
 CHECK_LIBRARY_EXISTS(dl dlopen "" HAVE_LIBDL)
 
@@ -28,6 +32,17 @@ ELSE (HAVE_LIBDL)
     SET(LIBDL "")
 ENDIF (HAVE_LIBDL)
 
+# Threads, per-thread storage and memory barriers, for running parts of the
+# assembly on several threads
+FIND_PACKAGE(Threads)
+IF (CMAKE_USE_PTHREADS_INIT)
+    SET(HAVE_PTHREAD 1)
+ENDIF (CMAKE_USE_PTHREADS_INIT)
+CHECK_C_SOURCE_COMPILES("static __thread int x; int main(void) { x = 1; return x; }"
+                        HAVE_THREAD_LOCAL)
+CHECK_C_SOURCE_COMPILES("int main(void) { __sync_synchronize(); return 0; }"
+                        HAVE_SYNC_SYNCHRONIZE)
+
 CONFIGURE_FILE(libyasm-stdint.h.cmake
                ${CMAKE_CURRENT_BINARY_DIR}/libyasm-stdint.h)
 CONFIGURE_FILE(config.h.cmake ${CMAKE_CURRENT_BINARY_DIR}/config.h)
@@ -17,12 +17,33 @@
 /* Define to 1 if you have the <direct.h> header file. */
 #cmakedefine HAVE_DIRECT_H 1
 
+/* Define to 1 if you have the <sys/time.h> header file. */
+#cmakedefine HAVE_SYS_TIME_H 1
+
+/* Define to 1 if you have the <sys/resource.h> header file. */
+#cmakedefine HAVE_SYS_RESOURCE_H 1
+
 /* Define to 1 if you have the `getcwd' function. */
 #cmakedefine HAVE_GETCWD 1
 
 /* Define to 1 if you have the `toascii' function. */
 #cmakedefine HAVE_TOASCII 1
 
+/* Define to 1 if you have the `gettimeofday' function. */
+#cmakedefine HAVE_GETTIMEOFDAY 1
+
+/* Define to 1 if you have the `getrusage' function. */
+#cmakedefine HAVE_GETRUSAGE 1
+
+/* Define to 1 if you have POSIX threads */
+#cmakedefine HAVE_PTHREAD 1
+
+/* Define to 1 if the compiler supports __thread variables */
+#cmakedefine HAVE_THREAD_LOCAL 1
+
+/* Define to 1 if the compiler has the __sync_synchronize builtin */
+#cmakedefine HAVE_SYNC_SYNCHRONIZE 1
+
 /* Name of package */
 #define PACKAGE "yasm"
 
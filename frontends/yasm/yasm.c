@@ -27,6 +27,7 @@
 #include <util.h>
 
 #include <ctype.h>
+#include <limits.h>
 #include <libyasm/compat-queue.h>
 #include <libyasm/bitvect.h>
 #include <libyasm.h>
@@ -35,6 +36,14 @@
 #include <libgen.h>
 #endif
 
+#include <time.h>
+#ifdef HAVE_SYS_TIME_H
+#include <sys/time.h>
+#endif
+#ifdef HAVE_SYS_RESOURCE_H
+#include <sys/resource.h>
+#endif
+
 #include "yasm-options.h"
 
 #ifdef CMAKE_BUILD
@@ -49,6 +58,9 @@
 /*@null@*/ /*@only@*/ static char *obj_filename = NULL, *in_filename = NULL;
 /*@null@*/ /*@only@*/ static char *global_prefix = NULL, *global_suffix = NULL;
 /*@null@*/ /*@only@*/ static char *list_filename = NULL, *map_filename = NULL;
+/*@null@*/ /*@only@*/ static char *size_hints_filename = NULL;
+/*@null@*/ /*@only@*/ static char *save_size_hints_filename = NULL;
+/*@null@*/ /*@only@*/ static yasm_size_hints *size_hints = NULL;
 /*@null@*/ /*@only@*/ static char *machine_name = NULL;
 static int special_options = 0;
 /*@null@*/ /*@dependent@*/ static yasm_arch *cur_arch = NULL;
@@ -70,7 +82,17 @@ static int special_options = 0;
 static int preproc_only = 0;
 static unsigned int force_strict = 0;
 static int generate_make_dependencies = 0;
+static int presize_output = 0;
+static int pipeline = 0;
+static int verify_size_hints = 0;
+static enum {
+    STATS_NONE = 0,
+    STATS_TEXT,
+    STATS_JSON
+} stats_style = STATS_NONE;
 static int warning_error = 0;   /* warnings being treated as errors */
+static unsigned long max_diagnostics = 0;   /* 0=unlimited */
+static unsigned int finalize_threads = 1;
 static FILE *errfile;
 /*@null@*/ /*@only@*/ static char *error_filename = NULL;
 static enum {
@@ -80,6 +102,7 @@ static enum {
 
 /*@null@*/ /*@dependent@*/ static FILE *open_file(const char *filename,
                                                   const char *mode);
+static void output_errwarns(yasm_errwarns *errwarns, yasm_linemap *linemap);
 static void check_errors(/*@only@*/ yasm_errwarns *errwarns,
                          /*@only@*/ yasm_object *object,
                          /*@only@*/ yasm_linemap *linemap);
@@ -108,6 +131,17 @@ static int opt_ewmsg_handler(char *cmd, /*@null@*/ char *param, int extra);
 static int opt_makedep_handler(char *cmd, /*@null@*/ char *param, int extra);
 static int opt_prefix_handler(char *cmd, /*@null@*/ char *param, int extra);
 static int opt_suffix_handler(char *cmd, /*@null@*/ char *param, int extra);
+static int opt_presize_handler(char *cmd, /*@null@*/ char *param, int extra);
+static int opt_pipeline_handler(char *cmd, /*@null@*/ char *param, int extra);
+static int opt_stats_handler(char *cmd, /*@null@*/ char *param, int extra);
+static int opt_max_diagnostics_handler(char *cmd, /*@null@*/ char *param,
+                                       int extra);
+static int opt_finalize_threads_handler(char *cmd, /*@null@*/ char *param,
+                                        int extra);
+static int opt_size_hints_handler(char *cmd, /*@null@*/ char *param,
+                                  int extra);
+static int opt_verify_size_hints_handler(char *cmd, /*@null@*/ char *param,
+                                         int extra);
 #ifdef CMAKE_BUILD
 static int opt_plugin_handler(char *cmd, /*@null@*/ char *param, int extra);
 #endif
@@ -204,6 +238,28 @@ static opt_option options[] =
       N_("append argument to name of all external symbols"), N_("suffix") },
     { 0, "postfix", 1, opt_suffix_handler, 0,
       N_("append argument to name of all external symbols"), N_("suffix") },
+    { 0, "presize-output", 0, opt_presize_handler, 0,
+      N_("lay out object file before writing section contents (elf, coff)"),
+      NULL },
+    { 0, "stats", 0, opt_stats_handler, 0,
+      N_("print time, memory and counts per phase (--stats=json for JSON)"),
+      NULL },
+    { 0, "max-diagnostics", 1, opt_max_diagnostics_handler, 0,
+      N_("print at most this many errors and warnings (0=unlimited)"),
+      N_("count") },
+    { 0, "finalize-threads", 1, opt_finalize_threads_handler, 0,
+      N_("finalize instructions on up to this many threads"), N_("count") },
+    { 0, "pipeline", 0, opt_pipeline_handler, 0,
+      N_("preprocess on a thread of its own, ahead of the parser"), NULL },
+    { 0, "size-hints", 1, opt_size_hints_handler, 0,
+      N_("start optimizing from jump and operand sizes saved in file"),
+      N_("filename") },
+    { 0, "save-size-hints", 1, opt_size_hints_handler, 1,
+      N_("save jump and operand sizes chosen by the optimizer to file"),
+      N_("filename") },
+    { 0, "verify-size-hints", 0, opt_verify_size_hints_handler, 0,
+      N_("use sizes from --size-hints as is; error if any are too small"),
+      NULL },
 #ifdef CMAKE_BUILD
     { 'N', "plugin", 1, opt_plugin_handler, 0,
       N_("load plugin module"), N_("plugin") },
@@ -252,6 +308,8 @@ do_preproc_only(void)
     FILE *out = NULL;
     yasm_errwarns *errwarns = yasm_errwarns_create();
 
+    yasm_errwarns_set_max_output(errwarns, max_diagnostics);
+
     /* Initialize line map */
     linemap = yasm_linemap_create();
     yasm_linemap_set(linemap, in_filename, 0, 1, 1);
@@ -327,8 +385,7 @@ do_preproc_only(void)
         fclose(out);
 
     if (yasm_errwarns_num_errors(errwarns, warning_error) > 0) {
-        yasm_errwarns_output_all(errwarns, linemap, warning_error,
-                                 print_yasm_error, print_yasm_warning);
+        output_errwarns(errwarns, linemap);
         if (out != stdout)
             remove(obj_filename);
         yasm_linemap_destroy(linemap);
@@ -337,14 +394,247 @@ do_preproc_only(void)
         return EXIT_FAILURE;
     }
 
-    yasm_errwarns_output_all(errwarns, linemap, warning_error,
-                             print_yasm_error, print_yasm_warning);
+    output_errwarns(errwarns, linemap);
     yasm_linemap_destroy(linemap);
     yasm_errwarns_destroy(errwarns);
     cleanup(NULL);
     return EXIT_SUCCESS;
 }
 
+/* Phases reported by --stats, in report order.  The preprocessor runs
+ * interleaved with the parser, so its time is measured around each
+ * yasm_preproc_get_line() call and subtracted from the parse time (and
+ * its peak RSS is that of the parse).
+ */
+enum {
+    PHASE_PREPROC = 0,
+    PHASE_PARSE,
+    PHASE_FINALIZE,
+    PHASE_OPTIMIZE,
+    PHASE_OPTIMIZE_1A,
+    PHASE_OPTIMIZE_1B,
+    PHASE_OPTIMIZE_1C,
+    PHASE_OPTIMIZE_1D,
+    PHASE_OPTIMIZE_2,
+    PHASE_OPTIMIZE_3,
+    PHASE_OPTIMIZE_VERIFY,
+    PHASE_DBGFMT,
+    PHASE_OBJFMT,
+    PHASE_LISTFMT,
+    NUM_PHASES
+};
+
+typedef struct stats_mark {
+    double wall, cpu;
+} stats_mark;
+
+static struct stats_phase {
+    const char *name;
+    /*@null@*/ const char *step;    /* optimizer step name (if a step) */
+    double wall, cpu;           /* seconds */
+    unsigned long peak_rss;     /* peak RSS (KiB) at end of phase */
+} stats_phases[NUM_PHASES] = {
+    {"preprocess", NULL, 0, 0, 0},
+    {"parse", NULL, 0, 0, 0},
+    {"finalize", NULL, 0, 0, 0},
+    {"optimize", NULL, 0, 0, 0},
+    {"optimize.1a", "1a", 0, 0, 0},
+    {"optimize.1b", "1b", 0, 0, 0},
+    {"optimize.1c", "1c", 0, 0, 0},
+    {"optimize.1d", "1d", 0, 0, 0},
+    {"optimize.2", "2", 0, 0, 0},
+    {"optimize.3", "3", 0, 0, 0},
+    {"optimize.verify", "verify", 0, 0, 0},
+    {"dbgfmt", NULL, 0, 0, 0},
+    {"objfmt", NULL, 0, 0, 0},
+    {"listfmt", NULL, 0, 0, 0}
+};
+
+/* Counts reported by --stats, in report order. */
+enum {
+    COUNT_BYTECODES = 0,
+    COUNT_SYMBOLS,
+    COUNT_EXPRESSIONS,
+    COUNT_SPANS,
+    COUNT_ITREE_NODES,
+    COUNT_EXPANSIONS,
+    COUNT_ITERATIONS,
+    COUNT_HINTED,
+    COUNT_RELOCATIONS,
+    NUM_COUNTS
+};
+
+static const char *stats_count_names[NUM_COUNTS] = {
+    "bytecodes",
+    "symbols",
+    "expressions",
+    "spans",
+    "itree_nodes",
+    "expansions",
+    "iterations",
+    "hinted",
+    "relocations"
+};
+
+static yasm_optimize_stats stats_opt;
+static yasm_preproc_module stats_preproc_module;
+/*@dependent@*/ static const yasm_preproc_module *stats_preproc_orig;
+static int stats_opt_phase = -1;
+static stats_mark stats_opt_mark;
+
+static void
+stats_begin(/*@out@*/ stats_mark *mark)
+{
+#ifdef HAVE_GETTIMEOFDAY
+    struct timeval tv;
+    gettimeofday(&tv, NULL);
+    mark->wall = (double)tv.tv_sec + (double)tv.tv_usec / 1e6;
+#else
+    mark->wall = (double)time(NULL);
+#endif
+    mark->cpu = (double)clock() / CLOCKS_PER_SEC;
+}
+
+static void
+stats_add_time(int phase, const stats_mark *start)
+{
+    stats_mark now;
+
+    stats_begin(&now);
+    stats_phases[phase].wall += now.wall - start->wall;
+    stats_phases[phase].cpu += now.cpu - start->cpu;
+}
+
+static void
+stats_end(int phase, const stats_mark *start)
+{
+#ifdef HAVE_GETRUSAGE
+    struct rusage ru;
+#endif
+
+    stats_add_time(phase, start);
+#ifdef HAVE_GETRUSAGE
+    if (getrusage(RUSAGE_SELF, &ru) == 0) {
+#ifdef __APPLE__
+        stats_phases[phase].peak_rss = (unsigned long)ru.ru_maxrss / 1024;
+#else
+        stats_phases[phase].peak_rss = (unsigned long)ru.ru_maxrss;
+#endif
+    }
+#endif
+}
+
+static char *
+stats_preproc_get_line(yasm_preproc *preproc)
+{
+    stats_mark mark;
+    char *line;
+
+    stats_begin(&mark);
+    line = stats_preproc_orig->get_line(preproc);
+    stats_add_time(PHASE_PREPROC, &mark);
+    return line;
+}
+
+/* Interpose stats_preproc_get_line() on the preprocessor's module. */
+static void
+stats_wrap_preproc(yasm_preproc *preproc)
+{
+    stats_preproc_orig = ((yasm_preproc_base *)preproc)->module;
+    stats_preproc_module = *stats_preproc_orig;     /* structure copy */
+    stats_preproc_module.get_line = stats_preproc_get_line;
+    ((yasm_preproc_base *)preproc)->module = &stats_preproc_module;
+}
+
+static void
+stats_optimize_step(/*@unused@*/ void *d, const char *name)
+{
+    int i;
+
+    if (stats_opt_phase >= 0)
+        stats_end(stats_opt_phase, &stats_opt_mark);
+    stats_opt_phase = -1;
+    if (!name)
+        return;
+    for (i=0; i<NUM_PHASES; i++) {
+        if (stats_phases[i].step && strcmp(stats_phases[i].step, name) == 0) {
+            stats_opt_phase = i;
+            stats_begin(&stats_opt_mark);
+            break;
+        }
+    }
+}
+
+static int
+stats_count_symbol(/*@unused@*/ yasm_symrec *sym, void *d)
+{
+    (*(unsigned long *)d)++;
+    return 0;
+}
+
+static int
+stats_count_relocs(yasm_section *sect, void *d)
+{
+    yasm_reloc *reloc;
+
+    for (reloc = yasm_section_relocs_first(sect); reloc;
+         reloc = yasm_section_reloc_next(reloc))
+        (*(unsigned long *)d)++;
+    return 0;
+}
+
+static void
+stats_output(yasm_object *object)
+{
+    unsigned long num_symbols = 0, num_relocs = 0;
+    unsigned long counts[NUM_COUNTS];
+    int i;
+
+    yasm_symtab_traverse(object->symtab, &num_symbols, stats_count_symbol);
+    yasm_object_sections_traverse(object, &num_relocs, stats_count_relocs);
+
+    counts[COUNT_BYTECODES] = stats_opt.bytecodes;
+    counts[COUNT_SYMBOLS] = num_symbols;
+    counts[COUNT_EXPRESSIONS] = yasm_expr_get_num_created();
+    counts[COUNT_SPANS] = stats_opt.spans;
+    counts[COUNT_ITREE_NODES] = stats_opt.itree_nodes;
+    counts[COUNT_EXPANSIONS] = stats_opt.expansions;
+    counts[COUNT_ITERATIONS] = stats_opt.iterations;
+    counts[COUNT_HINTED] = stats_opt.hinted;
+    counts[COUNT_RELOCATIONS] = num_relocs;
+
+    /* The parse time includes the preprocessor calls made by the parser,
+     * unless they were made on a thread of their own.
+     */
+    if (!pipeline) {
+        stats_phases[PHASE_PARSE].wall -= stats_phases[PHASE_PREPROC].wall;
+        stats_phases[PHASE_PARSE].cpu -= stats_phases[PHASE_PREPROC].cpu;
+    }
+
+    if (stats_style == STATS_JSON) {
+        printf("{\n  \"version\": 1,\n  \"phases\": {\n");
+        for (i=0; i<NUM_PHASES; i++)
+            printf("    \"%s\": {\"wall\": %.6f, \"cpu\": %.6f, "
+                   "\"peak_rss_kb\": %lu}%s\n", stats_phases[i].name,
+                   stats_phases[i].wall, stats_phases[i].cpu,
+                   stats_phases[i].peak_rss, i<NUM_PHASES-1 ? "," : "");
+        printf("  },\n  \"counts\": {\n");
+        for (i=0; i<NUM_COUNTS; i++)
+            printf("    \"%s\": %lu%s\n", stats_count_names[i], counts[i],
+                   i<NUM_COUNTS-1 ? "," : "");
+        printf("  }\n}\n");
+    } else {
+        printf("%-16s %10s %10s %12s\n", _("phase"), _("wall (s)"),
+               _("cpu (s)"), _("peak RSS (K)"));
+        for (i=0; i<NUM_PHASES; i++)
+            printf("%-16s %10.6f %10.6f %12lu\n", stats_phases[i].name,
+                   stats_phases[i].wall, stats_phases[i].cpu,
+                   stats_phases[i].peak_rss);
+        for (i=0; i<NUM_COUNTS; i++)
+            printf("%-16s %10lu\n", stats_count_names[i], counts[i]);
+    }
+}
+
 static int
 do_assemble(void)
 {
@@ -356,6 +646,9 @@ do_assemble(void)
     yasm_errwarns *errwarns = yasm_errwarns_create();
     int i, matched;
     const char *machine;
+    stats_mark mark;
+
+    yasm_errwarns_set_max_output(errwarns, max_diagnostics);
 
     /* Initialize line map */
     linemap = yasm_linemap_create();
@@ -468,9 +761,52 @@ do_assemble(void)
         yasm_object_set_global_prefix(object, global_prefix);
     if (global_suffix)
         yasm_object_set_global_suffix(object, global_suffix);
+    yasm_object_set_presize_output(object, presize_output);
+    yasm_object_set_finalize_threads(object, finalize_threads);
+    if (stats_style != STATS_NONE) {
+        stats_opt.step = stats_optimize_step;
+        stats_opt.d = NULL;
+        yasm_object_set_optimize_stats(object, &stats_opt);
+    }
+    if (size_hints_filename || save_size_hints_filename) {
+        size_hints = yasm_size_hints_create(linemap);
+        if (size_hints_filename) {
+            FILE *f = fopen(size_hints_filename, "rb");
+            if (f) {
+                int invalid = yasm_size_hints_read(size_hints, f);
+                fclose(f);
+                if (invalid && verify_size_hints) {
+                    /* Verifying needs the hints: don't fall back to the
+                     * shortest forms.
+                     */
+                    print_error(_("%s: `%s' is not a valid size hints file"),
+                                _("FATAL"), size_hints_filename);
+                    cleanup(object);
+                    return EXIT_FAILURE;
+                } else if (invalid)
+                    print_error(
+                        _("warning: `%s' is not a valid size hints file"),
+                        size_hints_filename);
+            } else if (verify_size_hints) {
+                print_error(_("%s: could not open size hints file `%s'"),
+                            _("FATAL"), size_hints_filename);
+                cleanup(object);
+                return EXIT_FAILURE;
+            } else if (!save_size_hints_filename ||
+                       strcmp(size_hints_filename,
+                              save_size_hints_filename) != 0) {
+                /* Not warned about when it's about to be created */
+                print_error(_("warning: could not open size hints file `%s'"),
+                            size_hints_filename);
+            }
+        }
+        yasm_object_set_size_hints(object, size_hints);
+    }
 
     cur_preproc = yasm_preproc_create(cur_preproc_module, in_filename,
                                       object->symtab, linemap, errwarns);
+    if (stats_style != STATS_NONE)
+        stats_wrap_preproc(cur_preproc);
 
     apply_preproc_builtins();
     apply_preproc_standard_macros(cur_parser_module->stdmacs);
@@ -511,22 +847,64 @@ do_assemble(void)
         }
     }
 
+    /* Run the preprocessor ahead of the parser if asked to; not for TASM,
+     * whose preprocessor sets state the parser reads (tasm_segment).
+     */
+    if (pipeline && strcmp(cur_preproc_module->keyword, "tasm") == 0)
+        pipeline = 0;
+    if (pipeline)
+        cur_preproc = yasm_preproc_pipe_create(cur_preproc);
+
     /* Parse! */
+    if (stats_style != STATS_NONE)
+        stats_begin(&mark);
     cur_parser_module->do_parse(object, cur_preproc, list_filename != NULL,
                                 linemap, errwarns);
+    if (stats_style != STATS_NONE) {
+        stats_end(PHASE_PARSE, &mark);
+        stats_phases[PHASE_PREPROC].peak_rss =
+            stats_phases[PHASE_PARSE].peak_rss;
+    }
 
     check_errors(errwarns, object, linemap);
 
     /* Finalize parse */
+    if (stats_style != STATS_NONE)
+        stats_begin(&mark);
     yasm_object_finalize(object, errwarns);
+    if (stats_style != STATS_NONE)
+        stats_end(PHASE_FINALIZE, &mark);
     check_errors(errwarns, object, linemap);
 
     /* Optimize */
-    yasm_object_optimize(object, errwarns);
+    if (stats_style != STATS_NONE)
+        stats_begin(&mark);
+    if (verify_size_hints)
+        yasm_object_optimize_verify(object, errwarns);
+    else
+        yasm_object_optimize(object, errwarns);
+    if (stats_style != STATS_NONE)
+        stats_end(PHASE_OPTIMIZE, &mark);
     check_errors(errwarns, object, linemap);
 
+    if (save_size_hints_filename) {
+        FILE *f = open_file(save_size_hints_filename, "wb");
+        if (!f) {
+            cleanup(object);
+            return EXIT_FAILURE;
+        }
+        if (yasm_size_hints_write(size_hints, f))
+            print_error(_("warning: error writing size hints file `%s'"),
+                        save_size_hints_filename);
+        fclose(f);
+    }
+
     /* generate any debugging information */
+    if (stats_style != STATS_NONE)
+        stats_begin(&mark);
     yasm_dbgfmt_generate(object, linemap, errwarns);
+    if (stats_style != STATS_NONE)
+        stats_end(PHASE_DBGFMT, &mark);
     check_errors(errwarns, object, linemap);
 
     /* open the object file for output (if not already opened by dbg objfmt) */
@@ -539,12 +917,16 @@ do_assemble(void)
     }
 
     /* Write the object file */
+    if (stats_style != STATS_NONE)
+        stats_begin(&mark);
     yasm_objfmt_output(object, obj?obj:stderr,
                        strcmp(cur_dbgfmt_module->keyword, "null"), errwarns);
 
     /* Close object file */
     if (obj)
         fclose(obj);
+    if (stats_style != STATS_NONE)
+        stats_end(PHASE_OBJFMT, &mark);
 
     /* If we had an error at this point, we also need to delete the output
      * object file (to make sure it's not left newer than the source).
@@ -561,14 +943,20 @@ do_assemble(void)
             return EXIT_FAILURE;
         }
         /* Initialize the list format */
+        if (stats_style != STATS_NONE)
+            stats_begin(&mark);
         cur_listfmt = yasm_listfmt_create(cur_listfmt_module, in_filename,
                                           obj_filename);
         yasm_listfmt_output(cur_listfmt, list, linemap, cur_arch);
         fclose(list);
+        if (stats_style != STATS_NONE)
+            stats_end(PHASE_LISTFMT, &mark);
     }
 
-    yasm_errwarns_output_all(errwarns, linemap, warning_error,
-                             print_yasm_error, print_yasm_warning);
+    output_errwarns(errwarns, linemap);
+
+    if (stats_style != STATS_NONE)
+        stats_output(object);
 
     yasm_linemap_destroy(linemap);
     yasm_errwarns_destroy(errwarns);
@@ -711,6 +1099,13 @@ main(int argc, char *argv[])
         return EXIT_FAILURE;
     }
 
+    if (verify_size_hints && !size_hints_filename) {
+        print_error(_("%s: `%s' requires `%s'"), _("FATAL"),
+                    "--verify-size-hints", "--size-hints");
+        cleanup(NULL);
+        return EXIT_FAILURE;
+    }
+
     /* handle preproc-only case here */
     if (preproc_only)
         return do_preproc_only();
@@ -754,13 +1149,28 @@ open_file(const char *filename, const char *mode)
     return f;
 }
 
+/* Output all errors and warnings, noting how many --max-diagnostics left
+ * out.
+ */
+static void
+output_errwarns(yasm_errwarns *errwarns, yasm_linemap *linemap)
+{
+    unsigned long num_unshown;
+
+    num_unshown = yasm_errwarns_output_all(errwarns, linemap, warning_error,
+                                           print_yasm_error,
+                                           print_yasm_warning);
+    if (num_unshown > 0)
+        print_error(_("warning: %lu more errors and warnings not shown"),
+                    num_unshown);
+}
+
 static void
 check_errors(yasm_errwarns *errwarns, yasm_object *object,
              yasm_linemap *linemap)
 {
     if (yasm_errwarns_num_errors(errwarns, warning_error) > 0) {
-        yasm_errwarns_output_all(errwarns, linemap, warning_error,
-                                 print_yasm_error, print_yasm_warning);
+        output_errwarns(errwarns, linemap);
         yasm_linemap_destroy(linemap);
         yasm_errwarns_destroy(errwarns);
         cleanup(object);
@@ -785,6 +1195,8 @@ cleanup(yasm_object *object)
             yasm_preproc_destroy(cur_preproc);
         if (object)
             yasm_object_destroy(object);
+        if (size_hints)
+            yasm_size_hints_destroy(size_hints);
 
         yasm_floatnum_cleanup();
         yasm_intnum_cleanup();
@@ -803,6 +1215,10 @@ cleanup(yasm_object *object)
             yasm_xfree(list_filename);
         if (map_filename)
             yasm_xfree(map_filename);
+        if (size_hints_filename)
+            yasm_xfree(size_hints_filename);
+        if (save_size_hints_filename)
+            yasm_xfree(save_size_hints_filename);
         if (machine_name)
             yasm_xfree(machine_name);
         if (objfmt_keyword)
@@ -1192,6 +1608,96 @@ opt_suffix_handler(/*@unused@*/ char *cmd, char *param, /*@unused@*/ int extra)
     return 0;
 }
 
+static int
+opt_presize_handler(/*@unused@*/ char *cmd, /*@unused@*/ char *param,
+                    /*@unused@*/ int extra)
+{
+    presize_output = 1;
+    return 0;
+}
+
+static int
+opt_pipeline_handler(/*@unused@*/ char *cmd, /*@unused@*/ char *param,
+                     /*@unused@*/ int extra)
+{
+    pipeline = 1;
+    return 0;
+}
+
+static int
+opt_stats_handler(char *cmd, /*@unused@*/ char *param, /*@unused@*/ int extra)
+{
+    /* cmd is "stats" or "stats=<style>" */
+    const char *style = strchr(cmd, '=');
+
+    if (!style || yasm__strcasecmp(style+1, "text") == 0)
+        stats_style = STATS_TEXT;
+    else if (yasm__strcasecmp(style+1, "json") == 0)
+        stats_style = STATS_JSON;
+    else {
+        print_error(_("%s: unrecognized %s `%s'"), _("FATAL"),
+                    _("statistics style"), style+1);
+        exit(EXIT_FAILURE);
+    }
+    return 0;
+}
+
+static int
+opt_max_diagnostics_handler(/*@unused@*/ char *cmd, char *param,
+                            /*@unused@*/ int extra)
+{
+    char *end;
+
+    assert(param != NULL);
+    max_diagnostics = strtoul(param, &end, 10);
+    if (*param == '\0' || *end != '\0') {
+        print_error(_("%s: invalid diagnostic count `%s'"), _("FATAL"),
+                    param);
+        exit(EXIT_FAILURE);
+    }
+    return 0;
+}
+
+static int
+opt_finalize_threads_handler(/*@unused@*/ char *cmd, char *param,
+                             /*@unused@*/ int extra)
+{
+    char *end;
+    unsigned long num;
+
+    assert(param != NULL);
+    num = strtoul(param, &end, 10);
+    if (*param == '\0' || *end != '\0' || num == 0 || num > UINT_MAX) {
+        print_error(_("%s: invalid thread count `%s'"), _("FATAL"), param);
+        exit(EXIT_FAILURE);
+    }
+    finalize_threads = (unsigned int)num;
+    return 0;
+}
+
+static int
+opt_size_hints_handler(/*@unused@*/ char *cmd, char *param, int extra)
+{
+    char **filename = extra ? &save_size_hints_filename : &size_hints_filename;
+
+    if (*filename)
+        yasm_xfree(*filename);
+
+    assert(param != NULL);
+    *filename = yasm__xstrdup(param);
+
+    return 0;
+}
+
+static int
+opt_verify_size_hints_handler(/*@unused@*/ char *cmd,
+                              /*@unused@*/ char *param,
+                              /*@unused@*/ int extra)
+{
+    verify_size_hints = 1;
+    return 0;
+}
+
 #ifdef CMAKE_BUILD
 static int
 opt_plugin_handler(/*@unused@*/ char *cmd, char *param,
@@ -57,6 +57,8 @@ typedef unsigned long uintptr_t;
 
 #include <libyasm/bytecode.h>
 #include <libyasm/section.h>
+#include <libyasm/sizehints.h>
+#include <libyasm/strtab.h>
 #include <libyasm/insn.h>
 
 #include <libyasm/arch.h>
@@ -35,22 +35,74 @@ typedef struct assoc_data_item {
     void *data;
 } assoc_data_item;
 
+/* Data of registered callbacks is kept in slots[slot-1]; data of other
+ * callbacks in a vector that is searched.  The slots are allocated together
+ * with the container, which is reallocated to add slots.
+ */
 struct yasm__assoc_data {
     assoc_data_item *vector;
     size_t size;
     size_t alloc;
+    size_t num_slots;
+    void *slots[1];
 };
 
+/* Registered callbacks, indexed by slot-1, and an open-addressed hash table
+ * of slot numbers (0 = empty) keyed by callback address to find the slot of
+ * a callback.  The table is kept at most half full; callbacks registered
+ * beyond that are simply left unregistered.
+ */
+#define ASSOC_SLOT_HASH_SIZE    64
+#define ASSOC_SLOT_HASH(cb) \
+    ((unsigned int)(((uintptr_t)(cb)) >> 4) & (ASSOC_SLOT_HASH_SIZE-1))
+
+static /*@only@*/ /*@null@*/ const yasm_assoc_data_callback **registered = NULL;
+static unsigned int num_registered = 0;
+static unsigned int slot_hash[ASSOC_SLOT_HASH_SIZE];
+
+/* Returns the slot of callback, or 0 if it is not registered. */
+static unsigned int
+assoc_data_slot(const yasm_assoc_data_callback *callback)
+{
+    unsigned int h = ASSOC_SLOT_HASH(callback);
+
+    while (slot_hash[h] != 0) {
+        if (registered[slot_hash[h]-1] == callback)
+            return slot_hash[h];
+        h = (h+1) & (ASSOC_SLOT_HASH_SIZE-1);
+    }
+    return 0;
+}
+
+void
+yasm_assoc_data_register(const yasm_assoc_data_callback *callback)
+{
+    unsigned int h;
+
+    if (assoc_data_slot(callback) != 0
+        || 2*(num_registered+1) > ASSOC_SLOT_HASH_SIZE)
+        return;
+    registered = yasm_xrealloc((void *)registered,
+                               (num_registered+1) *
+                               sizeof(const yasm_assoc_data_callback *));
+    registered[num_registered++] = callback;
+
+    h = ASSOC_SLOT_HASH(callback);
+    while (slot_hash[h] != 0)
+        h = (h+1) & (ASSOC_SLOT_HASH_SIZE-1);
+    slot_hash[h] = num_registered;
+}
 
 yasm__assoc_data *
 yasm__assoc_data_create(void)
 {
     yasm__assoc_data *assoc_data = yasm_xmalloc(sizeof(yasm__assoc_data));
 
+    assoc_data->vector = NULL;
     assoc_data->size = 0;
-    assoc_data->alloc = 2;
-    assoc_data->vector = yasm_xmalloc(assoc_data->alloc *
-                                      sizeof(assoc_data_item));
+    assoc_data->alloc = 0;
+    assoc_data->num_slots = 1;
+    assoc_data->slots[0] = NULL;
 
     return assoc_data;
 }
@@ -59,11 +111,18 @@ void *
 yasm__assoc_data_get(yasm__assoc_data *assoc_data,
                      const yasm_assoc_data_callback *callback)
 {
-    size_t i;
+    size_t i, slot;
 
     if (!assoc_data)
         return NULL;
 
+    slot = assoc_data_slot(callback);
+    if (slot != 0) {
+        if (slot > assoc_data->num_slots)
+            return NULL;
+        return assoc_data->slots[slot-1];
+    }
+
     for (i=0; i<assoc_data->size; i++) {
         if (assoc_data->vector[i].callback == callback)
             return assoc_data->vector[i].data;
@@ -77,7 +136,7 @@ yasm__assoc_data_add(yasm__assoc_data *assoc_data_arg,
 {
     yasm__assoc_data *assoc_data;
     assoc_data_item *item = NULL;
-    size_t i;
+    size_t i, slot;
 
     /* Create a new assoc_data if necessary */
     if (assoc_data_arg)
@@ -85,6 +144,27 @@ yasm__assoc_data_add(yasm__assoc_data *assoc_data_arg,
     else
         assoc_data = yasm__assoc_data_create();
 
+    slot = assoc_data_slot(callback);
+    if (slot != 0) {
+        void **slotp;
+
+        /* Add slots up to this one if necessary */
+        if (slot > assoc_data->num_slots) {
+            assoc_data = yasm_xrealloc(assoc_data,
+                sizeof(yasm__assoc_data) + (slot-1)*sizeof(void *));
+            for (i=assoc_data->num_slots; i<slot; i++)
+                assoc_data->slots[i] = NULL;
+            assoc_data->num_slots = slot;
+        }
+
+        /* Delete existing data (if any) */
+        slotp = &assoc_data->slots[slot-1];
+        if (*slotp && *slotp != data)
+            callback->destroy(*slotp);
+        *slotp = data;
+        return assoc_data;
+    }
+
     /* See if there's already assocated data for this callback */
     for (i=0; i<assoc_data->size; i++) {
         if (assoc_data->vector[i].callback == callback) {
@@ -97,7 +177,7 @@ yasm__assoc_data_add(yasm__assoc_data *assoc_data_arg,
     if (!item) {
         assoc_data->size++;
         if (assoc_data->size > assoc_data->alloc) {
-            assoc_data->alloc *= 2;
+            assoc_data->alloc = assoc_data->alloc ? assoc_data->alloc*2 : 2;
             assoc_data->vector =
                 yasm_xrealloc(assoc_data->vector,
                               assoc_data->alloc * sizeof(assoc_data_item));
@@ -124,9 +204,14 @@ yasm__assoc_data_destroy(yasm__assoc_data *assoc_data)
     if (!assoc_data)
         return;
 
+    for (i=0; i<assoc_data->num_slots; i++) {
+        if (assoc_data->slots[i])
+            registered[i]->destroy(assoc_data->slots[i]);
+    }
     for (i=0; i<assoc_data->size; i++)
         assoc_data->vector[i].callback->destroy(assoc_data->vector[i].data);
-    yasm_xfree(assoc_data->vector);
+    if (assoc_data->vector)
+        yasm_xfree(assoc_data->vector);
     yasm_xfree(assoc_data);
 }
 
@@ -49,6 +49,7 @@ struct yasm_dataval {
         struct {
             /*@only@*/ unsigned char *contents;
             unsigned long len;
+            unsigned long alloc;    /* allocated size of contents */
         } raw;
     } data;
 
@@ -464,6 +465,7 @@ yasm_dv_create_raw(unsigned char *contents, unsigned long len)
     retval->type = DV_RAW;
     retval->data.raw.contents = contents;
     retval->data.raw.len = len;
+    retval->data.raw.alloc = len;
     retval->multiple = NULL;
 
     return retval;
@@ -556,6 +558,54 @@ yasm_dvs_append(yasm_datavalhead *headp, yasm_dataval *dv)
     return (yasm_dataval *)NULL;
 }
 
+void
+yasm_dvs_append_expr(yasm_datavalhead *headp, yasm_expr *e, unsigned int size,
+                     yasm_arch *arch)
+{
+    yasm_dataval *dv;
+    /*@dependent@*/ /*@null@*/ yasm_intnum *intn;
+    unsigned long len, newalloc;
+
+    /* Values that don't fit are left for yasm_bc_create_data() to warn
+     * about, so nothing is reported for a line that fails to parse.
+     */
+    intn = yasm_expr_get_intnum(&e, 0);
+    if (!intn || size == 0 || (!arch && size != 1)
+        || !yasm_intnum_check_size(intn, size*8, 0, 2)) {
+        yasm_dvs_append(headp, yasm_dv_create_expr(e));
+        return;
+    }
+
+    /* Add to the last data value if it's raw data without a multiple;
+     * otherwise start a new raw data value.
+     */
+    dv = STAILQ_LAST(headp, yasm_dataval, link);
+    if (!dv || dv->type != DV_RAW || dv->multiple)
+        dv = yasm_dvs_append(headp, yasm_dv_create_raw(NULL, 0));
+
+    /* Pad to nearest multiple of size (as yasm_bc_create_data() would) */
+    len = (dv->data.raw.len + size - 1) / size * size;
+    if (len + size > dv->data.raw.alloc) {
+        newalloc = dv->data.raw.alloc < 16 ? 16 : dv->data.raw.alloc;
+        while (newalloc < len + size)
+            newalloc *= 2;
+        dv->data.raw.contents = yasm_xrealloc(dv->data.raw.contents,
+                                              newalloc);
+        dv->data.raw.alloc = newalloc;
+    }
+    memset(&dv->data.raw.contents[dv->data.raw.len], 0,
+           len - dv->data.raw.len);
+
+    if (size == 1)
+        yasm_intnum_get_sized(intn, &dv->data.raw.contents[len], 1, 8, 0, 0,
+                              0);
+    else
+        yasm_arch_intnum_tobytes(arch, intn, &dv->data.raw.contents[len],
+                                 size, size*8, 0, NULL, 0);
+    dv->data.raw.len = len + size;
+    yasm_expr_destroy(e);
+}
+
 void
 yasm_dvs_print(const yasm_datavalhead *head, FILE *f, int indent_level)
 {
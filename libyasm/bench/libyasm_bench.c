@@ -0,0 +1,1110 @@
+/*
+ * Microbenchmarks for libyasm core primitives
+ *
+ *  Copyright (C) 2026  Yasm developers
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR AND OTHER CONTRIBUTORS ``AS IS''
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE AUTHOR OR OTHER CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ *
+ * Each benchmark runs its body for a number of iterations that is grown
+ * until a single timed run lasts at least the minimum time (-t, default
+ * 0.2 seconds), and then reports the time, the number of yasm_xmalloc() /
+ * yasm_xrealloc() calls and the number of bytes requested from them, each
+ * per iteration.  Setup (building the tables and trees that are queried)
+ * is not timed.
+ *
+ * Usage: libyasm_bench [-t seconds] [-j] [-l] [filter...]
+ *   -j     write the results as JSON instead of a text table
+ *   -l     list benchmark names and exit
+ * Only benchmarks whose name contains one of the filter strings are run.
+ */
+#include <util.h>
+
+#include <ctype.h>
+#include <time.h>
+#ifdef HAVE_SYS_TIME_H
+#include <sys/time.h>
+#endif
+
+#include "libyasm-stdint.h"
+#include <libyasm.h>
+#include <libyasm/bitvect.h>
+#include <libyasm/inttree.h>
+
+#ifdef CMAKE_BUILD
+#include "frontends/yasm/yasm-plugin.h"
+#endif
+
+/* Number of distinct names, intervals, and line mappings in the prebuilt
+ * tables; operations that add to a table start over with a fresh table once
+ * this many entries have been added.
+ */
+#define TABLE_SIZE      65536
+
+static volatile unsigned long sink;
+
+/* Entries added to the table under test since it was last (re)created. */
+static unsigned long table_fill;
+
+/*
+ * Allocation counting
+ */
+
+static unsigned long num_allocs;
+static unsigned long num_alloc_bytes;
+
+static /*@only@*/ void * (*orig_xmalloc) (size_t size);
+static /*@only@*/ void * (*orig_xrealloc) (/*@only@*/ /*@out@*/
+                                           /*@returned@*/ /*@null@*/
+                                           void *oldmem, size_t size);
+
+static void *
+count_xmalloc(size_t size)
+{
+    num_allocs++;
+    num_alloc_bytes += (unsigned long)size;
+    return orig_xmalloc(size);
+}
+
+static void *
+count_xrealloc(void *oldmem, size_t size)
+{
+    num_allocs++;
+    num_alloc_bytes += (unsigned long)size;
+    return orig_xrealloc(oldmem, size);
+}
+
+static double
+bench_now(void)
+{
+#ifdef HAVE_GETTIMEOFDAY
+    struct timeval tv;
+    gettimeofday(&tv, NULL);
+    return (double)tv.tv_sec + (double)tv.tv_usec / 1e6;
+#else
+    return (double)clock() / CLOCKS_PER_SEC;
+#endif
+}
+
+/* Small deterministic generator so every run sees the same inputs. */
+static unsigned long rng_state;
+
+static unsigned long
+rng_next(void)
+{
+    rng_state = (rng_state * 1103515245UL + 12345UL) & 0x7fffffffUL;
+    return rng_state;
+}
+
+static void
+check_errors(const char *what)
+{
+    yasm_error_class eclass;
+    char *str, *xrefstr;
+    unsigned long xrefline;
+
+    if (!yasm_error_occurred())
+        return;
+    yasm_error_fetch(&eclass, &str, &xrefline, &xrefstr);
+    fprintf(stderr, "%s: %s\n", what, str ? str : "error");
+    exit(EXIT_FAILURE);
+}
+
+/*
+ * yasm_intnum_calc() / yasm_intnum_create_dec() / yasm_intnum_create_hex()
+ */
+
+static yasm_expr_op intnum_ops[] = {
+    YASM_EXPR_ADD, YASM_EXPR_MUL, YASM_EXPR_DIV, YASM_EXPR_SHL
+};
+
+/* Operand pairs: both fit in a long (kept in the small representation),
+ * a 100-bit by 24-bit pair, and a 190-bit by 60-bit pair (products still
+ * fit in 256 bits).  The second operand of a shift is replaced by a small
+ * count.
+ */
+static char *intnum_vals[][2] = {
+    {"12345678", "1234"},
+    {"FEDCBA9876543210123456789", "ABCDEF"},
+    {"3FEDCBA9876543210123456789ABCDEF0011223344556677",
+     "FEDCBA987654321"}
+};
+
+static yasm_intnum *intn_a, *intn_b, *intn_acc;
+static yasm_expr_op intn_op;
+
+static void
+setup_intnum(int arg)
+{
+    char buf[80];
+
+    intn_op = intnum_ops[arg / 3];
+    strcpy(buf, intnum_vals[arg % 3][0]);
+    intn_a = yasm_intnum_create_hex(buf);
+    if (intn_op == YASM_EXPR_SHL)
+        intn_b = yasm_intnum_create_uint(7);
+    else {
+        strcpy(buf, intnum_vals[arg % 3][1]);
+        intn_b = yasm_intnum_create_hex(buf);
+    }
+    intn_acc = yasm_intnum_create_uint(0);
+}
+
+static void
+run_intnum_calc(unsigned long iters, int arg)
+{
+    unsigned long i;
+
+    for (i = 0; i < iters; i++) {
+        yasm_intnum_set(intn_acc, intn_a);
+        yasm_intnum_calc(intn_acc, intn_op, intn_b);
+    }
+    sink += yasm_intnum_get_uint(intn_acc);
+}
+
+static void
+teardown_intnum(int arg)
+{
+    yasm_intnum_destroy(intn_a);
+    yasm_intnum_destroy(intn_b);
+    yasm_intnum_destroy(intn_acc);
+}
+
+/* Literals as they appear in source: mostly small, some full 64-bit, and
+ * one that only fits in the BitVector representation.
+ */
+static const char *intnum_dec_strs[] = {
+    "0", "42", "65535", "1000000", "2147483648", "18446744073709551615",
+    "123456789012345678901234567890"
+};
+static const char *intnum_hex_strs[] = {
+    "0", "FF", "DEAD_BEEF", "7FFFFFFF", "FFFFFFFFFFFFFFFF",
+    "123456789ABCDEF0123456789ABCDEF"
+};
+
+static void
+run_intnum_create(unsigned long iters, int arg)
+{
+    const char **strs = arg ? intnum_hex_strs : intnum_dec_strs;
+    unsigned long n = arg ? sizeof(intnum_hex_strs)/sizeof(char *) :
+        sizeof(intnum_dec_strs)/sizeof(char *);
+    unsigned long i;
+    char buf[40];
+
+    for (i = 0; i < iters; i++) {
+        strcpy(buf, strs[i % n]);
+        if (arg)
+            yasm_intnum_destroy(yasm_intnum_create_hex(buf));
+        else
+            yasm_intnum_destroy(yasm_intnum_create_dec(buf));
+    }
+}
+
+/*
+ * BitVector
+ */
+
+static wordptr bv_x, bv_y, bv_z, bv_r;
+
+static void
+setup_bitvect(int arg)
+{
+    bv_x = BitVector_Create(256, TRUE);
+    bv_y = BitVector_Create(256, TRUE);
+    bv_z = BitVector_Create(256, TRUE);
+    bv_r = BitVector_Create(256, TRUE);
+    BitVector_from_Hex(bv_y,
+                       (charptr)"7FEDCBA98765432100112233445566778899AABB");
+    BitVector_from_Hex(bv_z, (charptr)"123456789ABCDEF");
+}
+
+static void
+run_bitvect_add(unsigned long iters, int arg)
+{
+    unsigned long i;
+    boolean carry;
+
+    for (i = 0; i < iters; i++) {
+        carry = 0;
+        BitVector_add(bv_x, bv_y, bv_z, &carry);
+    }
+}
+
+static void
+run_bitvect_multiply(unsigned long iters, int arg)
+{
+    unsigned long i;
+
+    for (i = 0; i < iters; i++)
+        BitVector_Multiply(bv_x, bv_y, bv_z);
+}
+
+static void
+run_bitvect_divide(unsigned long iters, int arg)
+{
+    unsigned long i;
+
+    for (i = 0; i < iters; i++)
+        BitVector_Divide(bv_x, bv_y, bv_z, bv_r);
+}
+
+static void
+run_bitvect_shift(unsigned long iters, int arg)
+{
+    unsigned long i;
+
+    for (i = 0; i < iters; i++) {
+        BitVector_Copy(bv_x, bv_y);
+        BitVector_Move_Left(bv_x, 7);
+    }
+}
+
+static void
+run_bitvect_from_hex(unsigned long iters, int arg)
+{
+    unsigned long i;
+
+    for (i = 0; i < iters; i++)
+        BitVector_from_Hex(bv_x,
+            (charptr)"7FEDCBA9876543210123456789ABCDEF00112233445566778899");
+}
+
+static void
+run_bitvect_to_dec(unsigned long iters, int arg)
+{
+    unsigned long i;
+    charptr str;
+
+    for (i = 0; i < iters; i++) {
+        str = BitVector_to_Dec(bv_y);
+        sink += str[0];
+        BitVector_Dispose(str);
+    }
+}
+
+static void
+teardown_bitvect(int arg)
+{
+    BitVector_Destroy(bv_x);
+    BitVector_Destroy(bv_y);
+    BitVector_Destroy(bv_z);
+    BitVector_Destroy(bv_r);
+}
+
+/*
+ * yasm_floatnum_create() / yasm_floatnum_get_sized()
+ */
+
+static const char *float_strs[] = {
+    "3.14159265358979323846", "1.0e300", "6.02214076e23", "0.1",
+    "2.2250738585072014e-308", "65504.0", "1.5", "123456789.125"
+};
+#define NUM_FLOAT_STRS  (sizeof(float_strs)/sizeof(float_strs[0]))
+
+static yasm_floatnum *flts[NUM_FLOAT_STRS];
+
+static void
+run_floatnum_create(unsigned long iters, int arg)
+{
+    unsigned long i;
+
+    for (i = 0; i < iters; i++)
+        yasm_floatnum_destroy(yasm_floatnum_create(
+            float_strs[i % NUM_FLOAT_STRS]));
+}
+
+static void
+setup_floatnum(int arg)
+{
+    size_t i;
+
+    for (i = 0; i < NUM_FLOAT_STRS; i++)
+        flts[i] = yasm_floatnum_create(float_strs[i]);
+}
+
+static void
+run_floatnum_get_sized(unsigned long iters, int arg)
+{
+    unsigned long i;
+    unsigned char buf[10];
+
+    for (i = 0; i < iters; i++) {
+        yasm_floatnum_get_sized(flts[i % NUM_FLOAT_STRS], buf, (size_t)arg,
+                                (size_t)arg*8, 0, 0, 0);
+        sink += buf[0];
+    }
+}
+
+static void
+teardown_floatnum(int arg)
+{
+    size_t i;
+
+    for (i = 0; i < NUM_FLOAT_STRS; i++)
+        yasm_floatnum_destroy(flts[i]);
+}
+
+/*
+ * yasm_expr__level_tree()
+ */
+
+static yasm_symtab *symtab;
+static char **names;
+static yasm_expr *expr_tree;
+
+static void
+make_names(void)
+{
+    char buf[40];
+    unsigned long i;
+
+    names = yasm_xmalloc(TABLE_SIZE * sizeof(char *));
+    rng_state = 1;
+    for (i = 0; i < TABLE_SIZE; i++) {
+        sprintf(buf, "label_%lu_%lx", i, rng_next() & 0xffffff);
+        names[i] = yasm__xstrdup(buf);
+    }
+}
+
+static void
+free_names(void)
+{
+    unsigned long i;
+
+    for (i = 0; i < TABLE_SIZE; i++)
+        yasm_xfree(names[i]);
+    yasm_xfree(names);
+}
+
+/* Right-nested s0 - (s1 - (s2 - ... (s15 - 4))), as produced by parsing
+ * a long difference expression; the subtractions are only turned into a
+ * single ADD of negated terms by the level pass.
+ */
+static yasm_expr *
+make_neg_tree(int n)
+{
+    yasm_expr *e;
+    int i;
+
+    e = yasm_expr_create_ident(yasm_expr_int(yasm_intnum_create_uint(4)), 0);
+    for (i = n-1; i >= 0; i--)
+        e = yasm_expr_create(YASM_EXPR_SUB,
+            yasm_expr_sym(yasm_symtab_use(symtab, names[i], 0)),
+            yasm_expr_expr(e), 0);
+    return e;
+}
+
+/* Sum of n EQU symbols, each defined as sK*4+K; every term is expanded
+ * and the result leveled into one ADD.
+ */
+static yasm_expr *
+make_equ_tree(int n)
+{
+    yasm_expr *e = NULL, *equ;
+    int i;
+
+    for (i = 0; i < n; i++) {
+        equ = yasm_expr_create(YASM_EXPR_MUL,
+            yasm_expr_sym(yasm_symtab_use(symtab, names[i], 0)),
+            yasm_expr_int(yasm_intnum_create_uint(4)), 0);
+        equ = yasm_expr_create(YASM_EXPR_ADD, yasm_expr_expr(equ),
+            yasm_expr_int(yasm_intnum_create_uint((unsigned long)i)), 0);
+        yasm_symtab_define_equ(symtab, names[n+i], equ, 0);
+        if (!e)
+            e = yasm_expr_create_ident(yasm_expr_sym(
+                yasm_symtab_use(symtab, names[n+i], 0)), 0);
+        else
+            e = yasm_expr_create(YASM_EXPR_ADD, yasm_expr_expr(e),
+                yasm_expr_sym(yasm_symtab_use(symtab, names[n+i], 0)), 0);
+    }
+    return e;
+}
+
+/* Chain of n constant EQUs, as in generated structure offsets: s0 equ 8,
+ * sK equ s(K-1)+K*8; the expression is the last one plus 1.
+ */
+static yasm_expr *
+make_equ_const_tree(int n)
+{
+    yasm_expr *equ;
+    int i;
+
+    for (i = 0; i < n; i++) {
+        equ = yasm_expr_create(YASM_EXPR_MUL,
+            yasm_expr_int(yasm_intnum_create_uint((unsigned long)i)),
+            yasm_expr_int(yasm_intnum_create_uint(8)), 0);
+        if (i > 0)
+            equ = yasm_expr_create(YASM_EXPR_ADD,
+                yasm_expr_sym(yasm_symtab_use(symtab, names[i-1], 0)),
+                yasm_expr_expr(equ), 0);
+        yasm_symtab_define_equ(symtab, names[i], equ, 0);
+    }
+    return yasm_expr_create(YASM_EXPR_ADD,
+        yasm_expr_sym(yasm_symtab_use(symtab, names[n-1], 0)),
+        yasm_expr_int(yasm_intnum_create_uint(1)), 0);
+}
+
+static void
+setup_expr(int arg)
+{
+    symtab = yasm_symtab_create();
+    if (arg == 0)
+        expr_tree = make_neg_tree(16);
+    else if (arg == 1)
+        expr_tree = make_equ_tree(8);
+    else
+        expr_tree = make_equ_const_tree(32);
+}
+
+static void
+run_expr_copy(unsigned long iters, int arg)
+{
+    unsigned long i;
+
+    for (i = 0; i < iters; i++)
+        yasm_expr_destroy(yasm_expr_copy(expr_tree));
+}
+
+static void
+run_expr_level_tree(unsigned long iters, int arg)
+{
+    unsigned long i;
+    yasm_expr *e;
+
+    for (i = 0; i < iters; i++) {
+        e = yasm_expr__level_tree(yasm_expr_copy(expr_tree), 1, 1, 1, 0,
+                                  NULL, NULL);
+        sink += e->numterms;
+        yasm_expr_destroy(e);
+    }
+}
+
+static void
+teardown_expr(int arg)
+{
+    yasm_expr_destroy(expr_tree);
+    yasm_symtab_destroy(symtab);
+}
+
+/*
+ * Symbol table (HAMT)
+ */
+
+static void
+setup_symtab(int arg)
+{
+    unsigned long i;
+
+    symtab = yasm_symtab_create();
+    table_fill = 0;
+    if (arg == 0) {
+        for (i = 0; i < TABLE_SIZE; i++)
+            yasm_symtab_use(symtab, names[i], 1);
+    }
+}
+
+static void
+run_symtab_use(unsigned long iters, int arg)
+{
+    unsigned long i;
+
+    rng_state = 2;
+    for (i = 0; i < iters; i++)
+        sink += (uintptr_t)yasm_symtab_use(symtab,
+                                           names[rng_next() % TABLE_SIZE], 1);
+}
+
+static void
+run_symtab_define_label(unsigned long iters, int arg)
+{
+    unsigned long i;
+
+    for (i = 0; i < iters; i++) {
+        if (table_fill == TABLE_SIZE) {
+            yasm_symtab_destroy(symtab);
+            symtab = yasm_symtab_create();
+            table_fill = 0;
+        }
+        yasm_symtab_define_label(symtab, names[table_fill++], NULL, 1, i);
+    }
+    check_errors("symtab_define_label");
+}
+
+static void
+teardown_symtab(int arg)
+{
+    yasm_symtab_destroy(symtab);
+}
+
+/*
+ * Line map
+ */
+
+static const char *line_files[] = {
+    "main.asm", "macros.inc", "defs.inc", "x86.inc"
+};
+
+static yasm_linemap *linemap;
+
+static void
+fill_linemap(unsigned long n)
+{
+    unsigned long i;
+
+    for (i = 0; i < n; i++) {
+        yasm_linemap_set(linemap, line_files[(i/8) % 4], 0, i*3+1, 1);
+        yasm_linemap_goto_next(linemap);
+    }
+}
+
+static void
+setup_linemap(int arg)
+{
+    linemap = yasm_linemap_create();
+    table_fill = 0;
+    if (arg == 0)
+        fill_linemap(TABLE_SIZE);
+}
+
+static void
+run_linemap_set(unsigned long iters, int arg)
+{
+    unsigned long i;
+
+    for (i = 0; i < iters; i++) {
+        if (table_fill == TABLE_SIZE) {
+            yasm_linemap_destroy(linemap);
+            linemap = yasm_linemap_create();
+            table_fill = 0;
+        }
+        yasm_linemap_set(linemap, line_files[(table_fill/8) % 4], 0,
+                         table_fill*3+1, 1);
+        yasm_linemap_goto_next(linemap);
+        table_fill++;
+    }
+}
+
+static void
+run_linemap_lookup(unsigned long iters, int arg)
+{
+    unsigned long i, file_line;
+    const char *filename;
+
+    rng_state = 3;
+    for (i = 0; i < iters; i++) {
+        yasm_linemap_lookup(linemap, rng_next() % TABLE_SIZE + 1, &filename,
+                            &file_line);
+        sink += file_line;
+    }
+}
+
+static void
+teardown_linemap(int arg)
+{
+    yasm_linemap_destroy(linemap);
+}
+
+/*
+ * Error/warning sets
+ */
+
+#define ERRWARN_SIZE    16384
+
+static yasm_errwarns *errwarns;
+
+static void
+setup_errwarns(int arg)
+{
+    errwarns = yasm_errwarns_create();
+    table_fill = 0;
+    yasm_warn_enable(YASM_WARN_GENERAL);
+}
+
+/* arg=0: propagated in line order (as the parser does).
+ * arg=1: two interleaved runs of lines, the second above the first (as
+ *        passes reporting in section or span order can do).
+ */
+static void
+run_errwarn_propagate(unsigned long iters, int arg)
+{
+    unsigned long i, line;
+
+    for (i = 0; i < iters; i++) {
+        if (table_fill == ERRWARN_SIZE) {
+            yasm_errwarns_destroy(errwarns);
+            errwarns = yasm_errwarns_create();
+            table_fill = 0;
+        }
+        if (arg == 0)
+            line = table_fill+1;
+        else
+            line = (table_fill & 1)*ERRWARN_SIZE + table_fill/2 + 1;
+        yasm_warn_set(YASM_WARN_GENERAL, N_("value does not fit"));
+        yasm_errwarn_propagate(errwarns, line);
+        table_fill++;
+    }
+}
+
+static void
+teardown_errwarns(int arg)
+{
+    yasm_errwarns_destroy(errwarns);
+    yasm_warn_disable(YASM_WARN_GENERAL);
+}
+
+/*
+ * Interval tree
+ */
+
+static IntervalTree *itree;
+
+static void
+insert_interval(unsigned long n)
+{
+    long low = (long)(rng_next() % (1UL << 20));
+    IT_insert(itree, low, low + (long)(rng_next() % 256), (void *)n);
+}
+
+static void
+itree_count(IntervalTreeNode *node, void *d)
+{
+    (*(unsigned long *)d)++;
+}
+
+static void
+setup_itree(int arg)
+{
+    unsigned long i;
+
+    itree = IT_create();
+    table_fill = 0;
+    rng_state = 4;
+    if (arg == 0) {
+        for (i = 0; i < TABLE_SIZE; i++)
+            insert_interval(i);
+    }
+}
+
+static void
+run_itree_insert(unsigned long iters, int arg)
+{
+    unsigned long i;
+
+    for (i = 0; i < iters; i++) {
+        if (table_fill == TABLE_SIZE) {
+            IT_destroy(itree);
+            itree = IT_create();
+            table_fill = 0;
+        }
+        insert_interval(table_fill++);
+    }
+}
+
+static void
+run_itree_enumerate(unsigned long iters, int arg)
+{
+    unsigned long i, count = 0;
+    long pos;
+
+    rng_state = 5;
+    for (i = 0; i < iters; i++) {
+        pos = (long)(rng_next() % (1UL << 20));
+        IT_enumerate(itree, pos, pos, &count, itree_count);
+    }
+    sink += count;
+}
+
+static void
+teardown_itree(int arg)
+{
+    IT_destroy(itree);
+}
+
+/*
+ * x86 instructions
+ */
+
+static yasm_arch *arch;
+
+static const char *insn_names[] = {
+    "mov", "add", "lea", "jmp", "vpaddd", "vfmadd231ps", "lock", "rep",
+    "movzx", "pxor", "notaninsn", "push", "call", "ret", "cmovne", "imul"
+};
+#define NUM_INSN_NAMES  (sizeof(insn_names)/sizeof(insn_names[0]))
+
+/* Operands are register names, decimal immediates, or "mem" for
+ * [rbx+rcx*4+16].
+ */
+static const struct {
+    const char *name;
+    const char *ops[3];
+} insn_forms[] = {
+    {"mov", {"rax", "rbx", NULL}},
+    {"add", {"rcx", "1000", NULL}},
+    {"lea", {"rdx", "mem", NULL}},
+    {"vpaddd", {"ymm0", "ymm1", "ymm2"}},
+    {"movzx", {"eax", "bl", NULL}},
+    {"imul", {"rax", "rbx", "10"}},
+    {"pxor", {"xmm0", "mem", NULL}},
+    {"push", {"r12", NULL, NULL}}
+};
+#define NUM_INSN_FORMS  (sizeof(insn_forms)/sizeof(insn_forms[0]))
+
+static uintptr_t
+get_reg(const char *name)
+{
+    uintptr_t reg;
+
+    if (yasm_arch_parse_check_regtmod(arch, name, strlen(name), &reg)
+        != YASM_ARCH_REG) {
+        fprintf(stderr, "unknown register `%s'\n", name);
+        exit(EXIT_FAILURE);
+    }
+    return reg;
+}
+
+static yasm_bytecode *
+create_insn(size_t form)
+{
+    const char *name = insn_forms[form].name;
+    yasm_bytecode *bc = NULL;
+    uintptr_t prefix;
+    yasm_insn *insn;
+    yasm_insn_operand *op;
+    yasm_expr *e;
+    const char *opstr;
+    int i;
+
+    yasm_arch_parse_check_insnprefix(arch, name, strlen(name), 1, &bc,
+                                     &prefix);
+    insn = yasm_bc_get_insn(bc);
+    for (i = 0; i < 3 && (opstr = insn_forms[form].ops[i]) != NULL; i++) {
+        if (isdigit((unsigned char)opstr[0])) {
+            e = yasm_expr_create_ident(yasm_expr_int(
+                yasm_intnum_create_uint(strtoul(opstr, NULL, 10))), 1);
+            op = yasm_operand_create_imm(e);
+        } else if (strcmp(opstr, "mem") == 0) {
+            e = yasm_expr_create(YASM_EXPR_MUL, yasm_expr_reg(get_reg("rcx")),
+                                 yasm_expr_int(yasm_intnum_create_uint(4)), 1);
+            e = yasm_expr_create(YASM_EXPR_ADD, yasm_expr_reg(get_reg("rbx")),
+                                 yasm_expr_expr(e), 1);
+            e = yasm_expr_create(YASM_EXPR_ADD, yasm_expr_expr(e),
+                                 yasm_expr_int(yasm_intnum_create_uint(16)),
+                                 1);
+            op = yasm_operand_create_mem(yasm_arch_ea_create(arch, e));
+        } else
+            op = yasm_operand_create_reg(get_reg(opstr));
+        yasm_insn_ops_append(insn, op);
+    }
+    return bc;
+}
+
+static void
+setup_x86(int arg)
+{
+    yasm_arch_module *arch_module;
+    yasm_arch_create_error aerr;
+
+    arch_module = yasm_load_arch("x86");
+    if (!arch_module) {
+        fprintf(stderr, "could not load x86 architecture\n");
+        exit(EXIT_FAILURE);
+    }
+    arch = yasm_arch_create(arch_module, "amd64", "nasm", &aerr);
+    if (!arch) {
+        fprintf(stderr, "could not create x86 architecture\n");
+        exit(EXIT_FAILURE);
+    }
+    yasm_arch_set_var(arch, "mode_bits", 64);
+}
+
+static void
+run_x86_check_insnprefix(unsigned long iters, int arg)
+{
+    unsigned long i;
+    const char *name;
+    yasm_bytecode *bc;
+    uintptr_t prefix;
+
+    for (i = 0; i < iters; i++) {
+        name = insn_names[i % NUM_INSN_NAMES];
+        bc = NULL;
+        sink += yasm_arch_parse_check_insnprefix(arch, name, strlen(name), 1,
+                                                 &bc, &prefix);
+        if (bc)
+            yasm_bc_destroy(bc);
+    }
+}
+
+static void
+run_x86_insn_create(unsigned long iters, int arg)
+{
+    unsigned long i;
+
+    for (i = 0; i < iters; i++)
+        yasm_bc_destroy(create_insn(i % NUM_INSN_FORMS));
+}
+
+static void
+run_x86_insn_finalize(unsigned long iters, int arg)
+{
+    unsigned long i;
+    yasm_bytecode *bc;
+
+    for (i = 0; i < iters; i++) {
+        bc = create_insn(i % NUM_INSN_FORMS);
+        yasm_bc_finalize(bc, NULL);
+        yasm_bc_destroy(bc);
+    }
+    check_errors("x86_insn_finalize");
+}
+
+static void
+teardown_x86(int arg)
+{
+    yasm_arch_destroy(arch);
+}
+
+/*
+ * Benchmark table and driver
+ */
+
+typedef struct bench {
+    const char *name;
+    /*@null@*/ void (*setup) (int arg);
+    void (*run) (unsigned long iters, int arg);
+    /*@null@*/ void (*teardown) (int arg);
+    int arg;
+} bench;
+
+static const bench benchmarks[] = {
+    {"intnum_calc/add/32", setup_intnum, run_intnum_calc, teardown_intnum, 0},
+    {"intnum_calc/add/128", setup_intnum, run_intnum_calc, teardown_intnum, 1},
+    {"intnum_calc/add/256", setup_intnum, run_intnum_calc, teardown_intnum, 2},
+    {"intnum_calc/mul/32", setup_intnum, run_intnum_calc, teardown_intnum, 3},
+    {"intnum_calc/mul/128", setup_intnum, run_intnum_calc, teardown_intnum, 4},
+    {"intnum_calc/mul/256", setup_intnum, run_intnum_calc, teardown_intnum, 5},
+    {"intnum_calc/div/32", setup_intnum, run_intnum_calc, teardown_intnum, 6},
+    {"intnum_calc/div/128", setup_intnum, run_intnum_calc, teardown_intnum, 7},
+    {"intnum_calc/div/256", setup_intnum, run_intnum_calc, teardown_intnum, 8},
+    {"intnum_calc/shl/32", setup_intnum, run_intnum_calc, teardown_intnum, 9},
+    {"intnum_calc/shl/128", setup_intnum, run_intnum_calc, teardown_intnum,
+     10},
+    {"intnum_calc/shl/256", setup_intnum, run_intnum_calc, teardown_intnum,
+     11},
+    {"intnum/create_dec", NULL, run_intnum_create, NULL, 0},
+    {"intnum/create_hex", NULL, run_intnum_create, NULL, 1},
+    {"bitvect/add", setup_bitvect, run_bitvect_add, teardown_bitvect, 0},
+    {"bitvect/multiply", setup_bitvect, run_bitvect_multiply,
+     teardown_bitvect, 0},
+    {"bitvect/divide", setup_bitvect, run_bitvect_divide, teardown_bitvect,
+     0},
+    {"bitvect/shift_left", setup_bitvect, run_bitvect_shift,
+     teardown_bitvect, 0},
+    {"bitvect/from_hex", setup_bitvect, run_bitvect_from_hex,
+     teardown_bitvect, 0},
+    {"bitvect/to_dec", setup_bitvect, run_bitvect_to_dec, teardown_bitvect,
+     0},
+    {"floatnum/create", NULL, run_floatnum_create, NULL, 0},
+    {"floatnum/get_sized/32", setup_floatnum, run_floatnum_get_sized,
+     teardown_floatnum, 4},
+    {"floatnum/get_sized/64", setup_floatnum, run_floatnum_get_sized,
+     teardown_floatnum, 8},
+    {"floatnum/get_sized/80", setup_floatnum, run_floatnum_get_sized,
+     teardown_floatnum, 10},
+    {"expr/copy/neg", setup_expr, run_expr_copy, teardown_expr, 0},
+    {"expr/copy/equ", setup_expr, run_expr_copy, teardown_expr, 1},
+    {"expr/level_tree/neg", setup_expr, run_expr_level_tree, teardown_expr,
+     0},
+    {"expr/level_tree/equ", setup_expr, run_expr_level_tree, teardown_expr,
+     1},
+    {"expr/level_tree/equ_const", setup_expr, run_expr_level_tree,
+     teardown_expr, 2},
+    {"symtab/use", setup_symtab, run_symtab_use, teardown_symtab, 0},
+    {"symtab/define_label", setup_symtab, run_symtab_define_label,
+     teardown_symtab, 1},
+    {"linemap/set", setup_linemap, run_linemap_set, teardown_linemap, 1},
+    {"linemap/lookup", setup_linemap, run_linemap_lookup, teardown_linemap,
+     0},
+    {"errwarn/propagate/in_order", setup_errwarns, run_errwarn_propagate,
+     teardown_errwarns, 0},
+    {"errwarn/propagate/interleaved", setup_errwarns, run_errwarn_propagate,
+     teardown_errwarns, 1},
+    {"inttree/insert", setup_itree, run_itree_insert, teardown_itree, 1},
+    {"inttree/enumerate", setup_itree, run_itree_enumerate, teardown_itree,
+     0},
+    {"x86/check_insnprefix", setup_x86, run_x86_check_insnprefix,
+     teardown_x86, 0},
+    {"x86/insn_create", setup_x86, run_x86_insn_create, teardown_x86, 0},
+    {"x86/insn_finalize", setup_x86, run_x86_insn_finalize, teardown_x86, 0}
+};
+#define NUM_BENCHMARKS  (sizeof(benchmarks)/sizeof(benchmarks[0]))
+
+typedef struct bench_result {
+    unsigned long iters;
+    double ns_per_op;
+    double allocs_per_op;
+    double bytes_per_op;
+} bench_result;
+
+static void
+run_bench(const bench *b, double min_time, /*@out@*/ bench_result *result)
+{
+    unsigned long iters = 1;
+    double start, elapsed, next;
+
+    if (b->setup)
+        b->setup(b->arg);
+    for (;;) {
+        num_allocs = 0;
+        num_alloc_bytes = 0;
+        start = bench_now();
+        b->run(iters, b->arg);
+        elapsed = bench_now() - start;
+        if (elapsed >= min_time || iters >= 1000000000UL)
+            break;
+        /* Aim a little past the minimum time, growing by at most 100x per
+         * step in case the first runs were dominated by timer resolution.
+         */
+        if (elapsed < 1e-9)
+            next = (double)iters * 100;
+        else
+            next = (double)iters * min_time * 1.4 / elapsed;
+        if (next > (double)iters * 100)
+            next = (double)iters * 100;
+        if (next < (double)iters + 1)
+            next = (double)iters + 1;
+        if (next > 1e9)
+            next = 1e9;
+        iters = (unsigned long)next;
+    }
+    if (b->teardown)
+        b->teardown(b->arg);
+
+    result->iters = iters;
+    result->ns_per_op = elapsed * 1e9 / iters;
+    result->allocs_per_op = (double)num_allocs / iters;
+    result->bytes_per_op = (double)num_alloc_bytes / iters;
+}
+
+static int
+selected(const char *name, int nfilters, char **filters)
+{
+    int i;
+
+    if (nfilters == 0)
+        return 1;
+    for (i = 0; i < nfilters; i++) {
+        if (strstr(name, filters[i]))
+            return 1;
+    }
+    return 0;
+}
+
+int
+main(int argc, char *argv[])
+{
+    double min_time = 0.2;
+    int json = 0, list = 0, first = 1;
+    int argi = 1;
+    size_t i;
+    bench_result r;
+
+    while (argi < argc && argv[argi][0] == '-') {
+        if (strcmp(argv[argi], "-t") == 0 && argi+1 < argc) {
+            min_time = atof(argv[argi+1]);
+            argi += 2;
+        } else if (strcmp(argv[argi], "-j") == 0) {
+            json = 1;
+            argi++;
+        } else if (strcmp(argv[argi], "-l") == 0) {
+            list = 1;
+            argi++;
+        } else {
+            fprintf(stderr,
+                    "Usage: %s [-t seconds] [-j] [-l] [filter...]\n",
+                    argv[0]);
+            return EXIT_FAILURE;
+        }
+    }
+
+    if (list) {
+        for (i = 0; i < NUM_BENCHMARKS; i++)
+            printf("%s\n", benchmarks[i].name);
+        return EXIT_SUCCESS;
+    }
+
+    orig_xmalloc = yasm_xmalloc;
+    orig_xrealloc = yasm_xrealloc;
+    yasm_xmalloc = count_xmalloc;
+    yasm_xrealloc = count_xrealloc;
+
+    yasm_errwarn_initialize();
+    if (BitVector_Boot() != ErrCode_Ok) {
+        fprintf(stderr, "could not initialize BitVector\n");
+        return EXIT_FAILURE;
+    }
+    yasm_intnum_initialize();
+    yasm_floatnum_initialize();
+    yasm_warn_disable_all();
+#ifdef CMAKE_BUILD
+    if (!load_plugin("yasmstd")) {
+        fprintf(stderr, "could not load standard modules\n");
+        return EXIT_FAILURE;
+    }
+#endif
+    make_names();
+
+    if (json)
+        printf("{\n \"version\": 1,\n \"min_time\": %g,\n \"benchmarks\": [",
+               min_time);
+    else
+        printf("%-24s %12s %12s %10s %10s\n", "benchmark", "iterations",
+               "ns/op", "allocs/op", "bytes/op");
+    for (i = 0; i < NUM_BENCHMARKS; i++) {
+        if (!selected(benchmarks[i].name, argc-argi, &argv[argi]))
+            continue;
+        run_bench(&benchmarks[i], min_time, &r);
+        if (json) {
+            printf("%s\n  {\"name\": \"%s\", \"iterations\": %lu, "
+                   "\"ns_per_op\": %.2f, \"allocs_per_op\": %.3f, "
+                   "\"bytes_per_op\": %.1f}", first ? "" : ",",
+                   benchmarks[i].name, r.iters, r.ns_per_op,
+                   r.allocs_per_op, r.bytes_per_op);
+            first = 0;
+        } else
+            printf("%-24s %12lu %12.1f %10.2f %10.1f\n", benchmarks[i].name,
+                   r.iters, r.ns_per_op, r.allocs_per_op, r.bytes_per_op);
+        fflush(stdout);
+    }
+    if (json)
+        printf("\n ]\n}\n");
+
+    free_names();
+#ifdef CMAKE_BUILD
+    unload_plugins();
+#endif
+    yasm_floatnum_cleanup();
+    yasm_intnum_cleanup();
+    yasm_errwarn_cleanup();
+    BitVector_Shutdown();
+    return EXIT_SUCCESS;
+}
@@ -2678,6 +2678,211 @@ Z_int BitVector_Sign(wordptr addr)
     }
 }
 
+/*****************************************************************************/
+/*  Word-level kernels for multiplication and division of bit vectors of     */
+/*  up to BIT_VECTOR_FAST_BITS bits (the native size used by intnum).  The   */
+/*  operands are split into half-word digits so that every digit product and */
+/*  every two-digit partial dividend fits into an N_word, which keeps the    */
+/*  code portable without a double-width integer type.  Larger vectors, and  */
+/*  products that overflow, are left to the bit-serial loops further below.  */
+/*****************************************************************************/
+
+#define BIT_VECTOR_FAST_BITS    256
+#define BIT_VECTOR_FAST_DIGITS  (BIT_VECTOR_FAST_BITS / 8)  /* BITS >= 16 */
+
+static N_word BIT_VECTOR_to_digits(N_word *digit, wordptr addr)
+{
+    N_word  half = BITS >> 1;
+    N_word  dmask = (LSB << half) - 1;
+    N_word  size = size_(addr);
+    N_word  count = 0;
+    N_word  word;
+    N_word  i;
+
+    for ( i = 0; i < size; i++ )
+    {
+        word = *(addr+i);
+        if (i == size - 1) word &= mask_(addr);
+        digit[count++] = word AND dmask;
+        digit[count++] = word >> half;
+    }
+    while ((count > 0) and (digit[count-1] == 0)) count--;
+    return(count);                  /* number of significant digits */
+}
+
+static void BIT_VECTOR_from_digits(wordptr addr, N_word *digit, N_word count)
+{
+    N_word  half = BITS >> 1;
+    N_word  size = size_(addr);
+    N_word  lo;
+    N_word  hi;
+    N_word  i;
+
+    for ( i = 0; i < size; i++ )
+    {
+        lo = (i+i < count) ? digit[i+i] : 0;
+        hi = (i+i+1 < count) ? digit[i+i+1] : 0;
+        *(addr+i) = lo OR (hi << half);
+    }
+}
+
+static boolean BIT_VECTOR_mul_fast(wordptr X, wordptr Y, wordptr Z,
+                                   boolean strict)
+{
+    N_word  u[BIT_VECTOR_FAST_DIGITS];
+    N_word  v[BIT_VECTOR_FAST_DIGITS];
+    N_word  w[BIT_VECTOR_FAST_DIGITS+BIT_VECTOR_FAST_DIGITS];
+    N_word  half = BITS >> 1;
+    N_word  dmask = (LSB << half) - 1;
+    N_word  size = size_(X);
+    N_word  mask = mask_(X);
+    N_word  m;
+    N_word  n;
+    N_word  i;
+    N_word  j;
+    N_word  k;
+    N_word  t;
+
+    /* X = Y * Z for non-negative Y and Z; returns FALSE (X undefined) if */
+    /* the product does not fit (into X without its sign bit if strict). */
+
+    if ((bits_(X) > BIT_VECTOR_FAST_BITS) or
+        (bits_(Y) > BIT_VECTOR_FAST_BITS) or
+        (bits_(Z) > BIT_VECTOR_FAST_BITS)) return(FALSE);
+    m = BIT_VECTOR_to_digits(u,Y);
+    n = BIT_VECTOR_to_digits(v,Z);
+    for ( i = 0; i < m + n; i++ ) w[i] = 0;
+    for ( j = 0; j < n; j++ )
+    {
+        k = 0;
+        if (v[j] != 0)
+        {
+            for ( i = 0; i < m; i++ )
+            {
+                t = u[i] * v[j] + w[i+j] + k;   /* < 2^BITS */
+                w[i+j] = t AND dmask;
+                k = t >> half;
+            }
+        }
+        w[j+m] = k;
+    }
+    m += n;
+    while ((m > 0) and (w[m-1] == 0)) m--;
+    if (m > size + size) return(FALSE);
+    BIT_VECTOR_from_digits(X,w,m);
+    if (strict) mask >>= 1;
+    return((*(X+size-1) AND NOT mask) == 0);
+}
+
+static boolean BIT_VECTOR_div_fast(wordptr Q, wordptr X, wordptr Y, wordptr R)
+{
+    N_word  un[BIT_VECTOR_FAST_DIGITS+1];
+    N_word  vn[BIT_VECTOR_FAST_DIGITS];
+    N_word  q[BIT_VECTOR_FAST_DIGITS];
+    N_word  half = BITS >> 1;
+    N_word  dmask = (LSB << half) - 1;
+    N_word  base = dmask + 1;
+    N_word  m;
+    N_word  n;
+    N_word  s;
+    N_word  i;
+    N_word  j;
+    N_word  k;
+    N_word  t;
+    N_word  qhat;
+    N_word  rhat;
+    boolean borrow;
+
+    /* Q = X / Y and R = X % Y for non-negative X and positive Y, using */
+    /* Knuth's algorithm D (TAOCP vol. 2, 4.3.1) on half-word digits.    */
+
+    if (bits_(Q) > BIT_VECTOR_FAST_BITS) return(FALSE);
+    m = BIT_VECTOR_to_digits(un,X);
+    n = BIT_VECTOR_to_digits(vn,Y);
+    if (m < n)
+    {
+        BitVector_Empty(Q);
+        BIT_VECTOR_from_digits(R,un,m);
+        return(TRUE);
+    }
+    if (n == 1)
+    {
+        t = 0;
+        for ( j = m; j-- > 0; )
+        {
+            t = (t << half) OR un[j];
+            q[j] = t / vn[0];
+            t -= q[j] * vn[0];
+        }
+        un[0] = t;
+    }
+    else
+    {
+        /* normalize: shift the divisor until its top digit's MSB is set */
+        s = 0;
+        while (((vn[n-1] << s) AND (LSB << (half-1))) == 0) s++;
+        for ( i = n - 1; i > 0; i-- )
+            vn[i] = ((vn[i] << s) OR (vn[i-1] >> (half-s))) AND dmask;
+        vn[0] = (vn[0] << s) AND dmask;
+        un[m] = un[m-1] >> (half-s);
+        for ( i = m - 1; i > 0; i-- )
+            un[i] = ((un[i] << s) OR (un[i-1] >> (half-s))) AND dmask;
+        un[0] = (un[0] << s) AND dmask;
+
+        for ( j = m - n + 1; j-- > 0; )
+        {
+            /* estimate the quotient digit; at most one too large after this */
+            t = (un[j+n] << half) OR un[j+n-1];
+            qhat = t / vn[n-1];
+            rhat = t - qhat * vn[n-1];
+            while ((qhat >= base) or
+                   (qhat * vn[n-2] > ((rhat << half) OR un[j+n-2])))
+            {
+                qhat--;
+                rhat += vn[n-1];
+                if (rhat >= base) break;
+            }
+            /* multiply and subtract */
+            k = 0;
+            for ( i = 0; i < n; i++ )
+            {
+                t = qhat * vn[i] + k;
+                k = t >> half;
+                t &= dmask;
+                if (un[i+j] >= t) un[i+j] -= t;
+                else
+                {
+                    un[i+j] += base - t;
+                    k++;
+                }
+            }
+            borrow = (un[j+n] < k);
+            un[j+n] = (un[j+n] + base - k) AND dmask;
+            q[j] = qhat;
+            if (borrow)
+            {
+                /* add back */
+                q[j]--;
+                k = 0;
+                for ( i = 0; i < n; i++ )
+                {
+                    t = un[i+j] + vn[i] + k;
+                    un[i+j] = t AND dmask;
+                    k = t >> half;
+                }
+                un[j+n] = (un[j+n] + k) AND dmask;
+            }
+        }
+        /* unnormalize the remainder */
+        for ( i = 0; i < n - 1; i++ )
+            un[i] = ((un[i] >> s) OR (un[i+1] << (half-s))) AND dmask;
+        un[n-1] >>= s;
+    }
+    BIT_VECTOR_from_digits(Q,q,m-n+1);
+    BIT_VECTOR_from_digits(R,un,n);
+    return(TRUE);
+}
+
 ErrCode BitVector_Mul_Pos(wordptr X, wordptr Y, wordptr Z, boolean strict)
 {
     N_word  mask;
@@ -2709,6 +2914,8 @@ ErrCode BitVector_Mul_Pos(wordptr X, wordptr Y, wordptr Z, boolean strict)
     mask = mask_(Y);
     *sign &= mask;
     mask &= NOT (mask >> 1);
+    if (BIT_VECTOR_mul_fast(X,Y,Z,strict)) return(ErrCode_Ok);
+    BitVector_Empty(X);  /* overflow: let the loop below produce the result */
     for ( count = 0; (ok and (count <= limit)); count++ )
     {
         if ( BIT_VECTOR_TST_BIT(Z,count) )
@@ -2837,6 +3044,8 @@ ErrCode BitVector_Div_Pos(wordptr Q, wordptr X, wordptr Y, wordptr R)
         return(ErrCode_Same);
     if (BitVector_is_empty(Y))
         return(ErrCode_Zero);
+    if (BIT_VECTOR_div_fast(Q,X,Y,R))
+        return(ErrCode_Ok);
 
     BitVector_Empty(R);
     BitVector_Copy(Q,X);
@@ -26,6 +26,8 @@
  */
 #include "util.h"
 
+#include <limits.h>
+
 #include "libyasm-stdint.h"
 #include "coretype.h"
 
@@ -216,6 +218,28 @@ yasm_calc_bc_dist(yasm_bytecode *precbc1, yasm_bytecode *precbc2)
     return yasm_intnum_create_uint(dist2);
 }
 
+int
+yasm_calc_bc_dist_long(yasm_bytecode *precbc1, yasm_bytecode *precbc2,
+                       long *dist)
+{
+    unsigned long dist2, dist1;
+
+    if (precbc1->section != precbc2->section)
+        return 0;
+
+    /* Saturate beyond 32 bits the same way yasm_intnum_get_int() does */
+    dist1 = yasm_bc_next_offset(precbc1);
+    dist2 = yasm_bc_next_offset(precbc2);
+    if (dist2 < dist1) {
+        dist1 -= dist2;
+        *dist = dist1 > 0x7FFFFFFFUL ? LONG_MIN : -(long)dist1;
+    } else {
+        dist2 -= dist1;
+        *dist = dist2 > 0x7FFFFFFFUL ? LONG_MAX : (long)dist2;
+    }
+    return 1;
+}
+
 unsigned long
 yasm_bc_next_offset(yasm_bytecode *precbc)
 {
@@ -297,6 +321,33 @@ yasm_bc_expand(yasm_bytecode *bc, int span, long old_val, long new_val,
                                     pos_thres);
 }
 
+/* Write copies [first, first+count) of a bytecode into bufstart, which must
+ * have room for bc->len*(first+count) bytes.
+ */
+static void
+bc_tobytes_copies(yasm_bytecode *bc, unsigned char *bufstart,
+                  unsigned long first, unsigned long count, void *d,
+                  yasm_output_value_func output_value,
+                  /*@null@*/ yasm_output_reloc_func output_reloc)
+{
+    unsigned char *destbuf = bufstart + first*bc->len;
+    unsigned char *origbuf;
+    unsigned long i;
+    int error = 0;
+
+    if (!bc->callback)
+        yasm_internal_error(N_("got empty bytecode in bc_tobytes"));
+    else for (i=0; i<count; i++) {
+        origbuf = destbuf;
+        error = bc->callback->tobytes(bc, &destbuf, bufstart, d, output_value,
+                                      output_reloc);
+
+        if (!error && ((unsigned long)(destbuf - origbuf) != bc->len))
+            yasm_internal_error(
+                N_("written length does not match optimized length"));
+    }
+}
+
 /*@null@*/ /*@only@*/ unsigned char *
 yasm_bc_tobytes(yasm_bytecode *bc, unsigned char *buf, unsigned long *bufsize,
                 /*@out@*/ int *gap, void *d,
@@ -305,10 +356,7 @@ yasm_bc_tobytes(yasm_bytecode *bc, unsigned char *buf, unsigned long *bufsize,
     /*@sets *buf@*/
 {
     /*@only@*/ /*@null@*/ unsigned char *mybuf = NULL;
-    unsigned char *bufstart;
-    unsigned char *origbuf, *destbuf;
-    long i;
-    int error = 0;
+    unsigned char *destbuf;
 
     long mult;
     if (yasm_bc_get_multiple(bc, &mult, 1) || mult == 0) {
@@ -330,23 +378,263 @@ yasm_bc_tobytes(yasm_bytecode *bc, unsigned char *buf, unsigned long *bufsize,
         destbuf = mybuf;
     } else
         destbuf = buf;
-    bufstart = destbuf;
 
     *bufsize = bc->len*bc->mult_int;
 
-    if (!bc->callback)
-        yasm_internal_error(N_("got empty bytecode in bc_tobytes"));
-    else for (i=0; i<bc->mult_int; i++) {
-        origbuf = destbuf;
-        error = bc->callback->tobytes(bc, &destbuf, bufstart, d, output_value,
-                                      output_reloc);
+    bc_tobytes_copies(bc, destbuf, 0, (unsigned long)bc->mult_int, d,
+                      output_value, output_reloc);
 
-        if (!error && ((unsigned long)(destbuf - origbuf) != bc->len))
-            yasm_internal_error(
-                N_("written length does not match optimized length"));
+    return mybuf;
+}
+
+/* Initial allocation size for output buffers.  File-backed buffers are
+ * flushed rather than grown past this unless a single bytecode needs more.
+ */
+#define OUTBUF_INITIAL_SIZE     16384
+
+/* Grow an output buffer to hold at least size more bytes, without
+ * flushing any pending contents.
+ */
+static void
+outbuf_grow(yasm_outbuf *ob, unsigned long size)
+{
+    unsigned long newalloc;
+
+    if (ob->len + size <= ob->alloc)
+        return;
+
+    newalloc = ob->alloc ? ob->alloc : OUTBUF_INITIAL_SIZE;
+    while (newalloc < ob->len + size)
+        newalloc *= 2;
+    ob->buf = yasm_xrealloc(ob->buf, newalloc);
+    ob->alloc = newalloc;
+}
+
+/* Wraps the objfmt output functions while the first copy of a repeated
+ * bytecode is generated, noting whether any copy could differ from it.
+ */
+typedef struct bc_repeat_info {
+    void *d;
+    yasm_output_value_func output_value;
+    /*@null@*/ yasm_output_reloc_func output_reloc;
+    int varies;         /* copies may differ (or generate relocations) */
+} bc_repeat_info;
+
+static int
+bc_repeat_output_value(yasm_value *value, unsigned char *buf,
+                       unsigned int destsize, unsigned long offset,
+                       yasm_bytecode *bc, int warn, void *d)
+{
+    bc_repeat_info *info = (bc_repeat_info *)d;
+
+    if (value->rel || value->wrt || value->seg_of || value->section_rel ||
+        value->curpos_rel || value->ip_rel)
+        info->varies = 1;
+    return info->output_value(value, buf, destsize, offset, bc, warn,
+                              info->d);
+}
+
+static int
+bc_repeat_output_reloc(yasm_symrec *sym, yasm_bytecode *bc,
+                       unsigned char *buf, unsigned int destsize,
+                       unsigned int valsize, int warn, void *d)
+{
+    bc_repeat_info *info = (bc_repeat_info *)d;
+
+    info->varies = 1;
+    return info->output_reloc(sym, bc, buf, destsize, valsize, warn, info->d);
+}
+
+unsigned long
+yasm_bc_tobytes_outbuf(yasm_bytecode *bc, yasm_outbuf *ob, /*@out@*/ int *gap,
+                       void *d, yasm_output_value_func output_value,
+                       /*@null@*/ yasm_output_reloc_func output_reloc)
+{
+    bc_repeat_info info;
+    unsigned long size, start;
+    long mult;
+
+    *gap = 0;
+    if (yasm_bc_get_multiple(bc, &mult, 1) || mult == 0)
+        return 0;
+    bc->mult_int = mult;
+    size = bc->len*bc->mult_int;
+
+    /* special case for reserve bytecodes */
+    if (bc->callback->special == YASM_BC_SPECIAL_RESERVE) {
+        if (size > 0) {
+            *gap = 1;
+            yasm_outbuf_zero(ob, size);
+        }
+        return size;
     }
 
-    return mybuf;
+    if (bc->mult_int == 1 || bc->len == 0) {
+        bc_tobytes_copies(bc, yasm_outbuf_reserve(ob, size), 0,
+                          (unsigned long)bc->mult_int, d, output_value,
+                          output_reloc);
+        yasm_outbuf_commit(ob, size);
+        return size;
+    }
+
+    /* Generate the first copy, then repeat it if all copies are the same. */
+    info.d = d;
+    info.output_value = output_value;
+    info.output_reloc = output_reloc;
+    info.varies = 0;
+
+    yasm_outbuf_reserve(ob, bc->len);
+    start = ob->len;
+    bc_tobytes_copies(bc, ob->buf + start, 0, 1, &info, bc_repeat_output_value,
+                      output_reloc ? bc_repeat_output_reloc : NULL);
+    yasm_outbuf_commit(ob, bc->len);
+
+    if (!info.varies) {
+        yasm_outbuf_repeat(ob, bc->len, (unsigned long)bc->mult_int-1);
+        return size;
+    }
+
+    /* Generate the remaining copies contiguously after the first. */
+    outbuf_grow(ob, size - bc->len);
+    bc_tobytes_copies(bc, ob->buf + start, 1, (unsigned long)bc->mult_int-1,
+                      d, output_value, output_reloc);
+    yasm_outbuf_commit(ob, size - bc->len);
+    return size;
+}
+
+void
+yasm_outbuf_initialize(yasm_outbuf *ob, FILE *f)
+{
+    ob->f = f;
+    ob->buf = NULL;
+    ob->len = 0;
+    ob->alloc = 0;
+}
+
+unsigned char *
+yasm_outbuf_reserve(yasm_outbuf *ob, unsigned long size)
+{
+    if (ob->len + size > ob->alloc) {
+        if (ob->f)
+            yasm_outbuf_flush(ob);
+        outbuf_grow(ob, size);
+    }
+    return ob->buf + ob->len;
+}
+
+void
+yasm_outbuf_zero(yasm_outbuf *ob, unsigned long size)
+{
+    long skip;
+
+    /* Memory-only buffers need to hold the zeros, as do short runs. */
+    if (!ob->f || size <= OUTBUF_INITIAL_SIZE) {
+        memset(yasm_outbuf_reserve(ob, size), 0, size);
+        yasm_outbuf_commit(ob, size);
+        return;
+    }
+
+    /* Seek over all but the last byte, which is written to extend the file
+     * in case nothing follows.
+     */
+    yasm_outbuf_flush(ob);
+    size--;
+    while (size > 0) {
+        skip = size > 0x40000000UL ? 0x40000000L : (long)size;
+        if (fseek(ob->f, skip, SEEK_CUR) < 0)
+            yasm__fatal(N_("could not seek on output file"));
+        size -= (unsigned long)skip;
+    }
+    *yasm_outbuf_reserve(ob, 1) = 0;
+    yasm_outbuf_commit(ob, 1);
+}
+
+/* Fill buf[size, total) with copies of the pattern in buf[0, size). */
+static void
+outbuf_replicate(unsigned char *buf, unsigned long size, unsigned long total)
+{
+    unsigned long done = size, chunk;
+
+    while (done < total) {
+        chunk = done < total-done ? done : total-done;
+        memcpy(buf+done, buf, chunk);
+        done += chunk;
+    }
+}
+
+void
+yasm_outbuf_repeat(yasm_outbuf *ob, unsigned long size, unsigned long count)
+{
+    unsigned char *pat;
+    unsigned long i, n;
+
+    if (size == 0 || count == 0)
+        return;
+    if (size > ob->len)
+        yasm_internal_error(N_("repeated pattern not in output buffer"));
+
+    pat = ob->buf + ob->len - size;
+    for (i=0; i<size && pat[i] == 0; i++)
+        ;
+    if (i == size) {
+        yasm_outbuf_zero(ob, size*count);
+        return;
+    }
+
+    if (!ob->f) {
+        outbuf_grow(ob, size*count);
+        outbuf_replicate(ob->buf + ob->len - size, size, size*(count+1));
+        yasm_outbuf_commit(ob, size*count);
+        return;
+    }
+
+    /* Move the pattern to the start of the buffer and fill the buffer with
+     * as many copies as fit (n, including the original), then write the
+     * buffer out as many times as needed.  What's left over stays pending.
+     */
+    if (ob->len > size) {
+        fwrite(ob->buf, (size_t)(ob->len - size), 1, ob->f);
+        memmove(ob->buf, ob->buf + ob->len - size, size);
+        ob->len = size;
+    }
+    n = OUTBUF_INITIAL_SIZE/size;
+    if (n < 1)
+        n = 1;
+    if (n > count+1)
+        n = count+1;
+    outbuf_grow(ob, size*(n-1));
+    outbuf_replicate(ob->buf, size, size*n);
+    count = count+1-n;      /* copies still to be appended */
+    ob->len = size*n;
+    if (count == 0)
+        return;
+    yasm_outbuf_flush(ob);
+    while (count >= n) {
+        fwrite(ob->buf, (size_t)(size*n), 1, ob->f);
+        count -= n;
+    }
+    ob->len = size*count;
+}
+
+void
+yasm_outbuf_flush(yasm_outbuf *ob)
+{
+    if (!ob->f)
+        return;
+    if (ob->len > 0)
+        fwrite(ob->buf, (size_t)ob->len, 1, ob->f);
+    ob->len = 0;
+}
+
+void
+yasm_outbuf_delete(yasm_outbuf *ob)
+{
+    yasm_outbuf_flush(ob);
+    if (ob->buf)
+        yasm_xfree(ob->buf);
+    ob->buf = NULL;
+    ob->len = 0;
+    ob->alloc = 0;
 }
 
 int
@@ -384,3 +672,19 @@ yasm_bc_get_insn(yasm_bytecode *bc)
         return NULL;
     return (yasm_insn *)bc->contents;
 }
+
+/* Function versions of the output buffer macros in bytecode.h */
+
+#undef yasm_outbuf_commit
+void
+yasm_outbuf_commit(yasm_outbuf *ob, unsigned long size)
+{
+    ob->len += size;
+}
+
+#undef yasm_outbuf_reset
+void
+yasm_outbuf_reset(yasm_outbuf *ob)
+{
+    ob->len = 0;
+}
@@ -34,6 +34,9 @@
 #define YASM_LIB_DECL
 #endif
 
+/** An output buffer (see #yasm_outbuf). */
+typedef struct yasm_outbuf yasm_outbuf;
+
 /** A data value (opaque type). */
 typedef struct yasm_dataval yasm_dataval;
 /** A list of data values. */
@@ -436,6 +439,20 @@ YASM_LIB_DECL
 /*@null@*/ /*@only@*/ yasm_intnum *yasm_calc_bc_dist
     (yasm_bytecode *precbc1, yasm_bytecode *precbc2);
 
+/** Determine the distance between the starting offsets of two bytecodes as
+ * a native integer, without allocating an intnum.  The result is the same
+ * as yasm_intnum_get_int() of the yasm_calc_bc_dist() result.
+ * \param precbc1       preceding bytecode to the first bytecode
+ * \param precbc2       preceding bytecode to the second bytecode
+ * \param dist          distance in bytes between the two bytecodes (bc2-bc1)
+ *                      (output)
+ * \return Nonzero if the distance was determined, 0 if it was indeterminate.
+ * \warning Only valid /after/ optimization.
+ */
+YASM_LIB_DECL
+int yasm_calc_bc_dist_long(yasm_bytecode *precbc1, yasm_bytecode *precbc2,
+                           /*@out@*/ long *dist);
+
 /** Get the offset of the next bytecode (the next bytecode doesn't have to
  * actually exist).
  * \param precbc        preceding bytecode
@@ -515,6 +532,122 @@ YASM_LIB_DECL
      /*@null@*/ yasm_output_reloc_func output_reloc)
     /*@sets *buf@*/;
 
+/** Output buffer.  A growable memory region that bytecodes are converted
+ * directly into by yasm_bc_tobytes_outbuf(), optionally backed by a file
+ * that pending contents are flushed to as the region fills.
+ */
+struct yasm_outbuf {
+    /** File pending contents are flushed to; NULL for a memory-only buffer
+     * (which then holds everything appended since the last reset).
+     */
+    /*@dependent@*/ /*@null@*/ FILE *f;
+
+    /*@only@*/ /*@null@*/ unsigned char *buf;   /**< Pending contents */
+    unsigned long len;      /**< Number of pending bytes in buf */
+    unsigned long alloc;    /**< Allocated size of buf */
+};
+
+/** Initialize an output buffer.
+ * \param ob    output buffer
+ * \param f     file to flush contents to (NULL for memory only)
+ */
+YASM_LIB_DECL
+void yasm_outbuf_initialize(/*@out@*/ yasm_outbuf *ob,
+                            /*@dependent@*/ /*@null@*/ FILE *f);
+
+/** Make room for appending data to an output buffer.  For file-backed
+ * buffers, this may flush pending contents to the file first.
+ * \param ob    output buffer
+ * \param size  number of bytes to make room for
+ * \return Pointer to where the next size bytes are to be written.  The
+ *         bytes only become part of the contents after yasm_outbuf_commit().
+ */
+YASM_LIB_DECL
+unsigned char *yasm_outbuf_reserve(yasm_outbuf *ob, unsigned long size);
+
+/** Commit bytes written into space returned by yasm_outbuf_reserve().
+ * \param ob    output buffer
+ * \param size  number of bytes written
+ */
+YASM_LIB_DECL
+void yasm_outbuf_commit(yasm_outbuf *ob, unsigned long size);
+#ifndef YASM_DOXYGEN
+#define yasm_outbuf_commit(ob, size)    ((ob)->len += (size))
+#endif
+
+/** Append zero bytes to an output buffer.  For file-backed buffers, large
+ * runs are skipped over with a seek (leaving a hole in the file where the
+ * filesystem supports it) rather than written, so the file must not already
+ * contain data in that range.
+ * \param ob    output buffer
+ * \param size  number of zero bytes
+ */
+YASM_LIB_DECL
+void yasm_outbuf_zero(yasm_outbuf *ob, unsigned long size);
+
+/** Append further copies of the most recently appended bytes of an output
+ * buffer.  The pattern is replicated by doubling copies within the buffer;
+ * file-backed buffers write it out a buffer's worth at a time, so memory use
+ * does not depend on count.  An all-zero pattern is appended as by
+ * yasm_outbuf_zero().
+ * \param ob    output buffer
+ * \param size  pattern size; the last size bytes of the pending contents
+ * \param count number of additional copies to append
+ */
+YASM_LIB_DECL
+void yasm_outbuf_repeat(yasm_outbuf *ob, unsigned long size,
+                        unsigned long count);
+
+/** Write pending contents of a file-backed output buffer to its file.
+ * Does nothing for memory-only buffers.
+ * \param ob    output buffer
+ */
+YASM_LIB_DECL
+void yasm_outbuf_flush(yasm_outbuf *ob);
+
+/** Discard pending contents of an output buffer without writing them.
+ * \param ob    output buffer
+ */
+YASM_LIB_DECL
+void yasm_outbuf_reset(yasm_outbuf *ob);
+#ifndef YASM_DOXYGEN
+#define yasm_outbuf_reset(ob)           ((ob)->len = 0)
+#endif
+
+/** Flush an output buffer and free its memory.  The buffer may be reused
+ * after a further yasm_outbuf_initialize().
+ * \param ob    output buffer
+ */
+YASM_LIB_DECL
+void yasm_outbuf_delete(yasm_outbuf *ob);
+
+/** Convert a bytecode into its byte representation, appending it directly
+ * to an output buffer.  Unlike yasm_bc_tobytes(), no intermediate buffer
+ * is needed regardless of the bytecode size.  Reserved (gap) space is
+ * appended as zeros.  If the bytecode has a multiple and its first copy
+ * does not reference any symbols (so every copy is identical), only that
+ * copy is generated and the rest are appended with yasm_outbuf_repeat().
+ * \param bc            bytecode
+ * \param ob            output buffer
+ * \param gap           if nonzero, indicates the data does not really need to
+ *                      exist in the object file (it has been zero-filled)
+ *                      [output]
+ * \param d             data to pass to each call to output_value/output_reloc
+ * \param output_value  function to call to convert values into their byte
+ *                      representation
+ * \param output_reloc  function to call to output relocation entries
+ *                      for a single sym
+ * \return Number of bytes appended; 0 if the bytecode is empty or its
+ *         multiple could not be determined.  Errors converting values are
+ *         set with yasm_error_set() and do not change the size: all of the
+ *         bytecode's bytes are still appended.
+ */
+YASM_LIB_DECL
+unsigned long yasm_bc_tobytes_outbuf
+    (yasm_bytecode *bc, yasm_outbuf *ob, /*@out@*/ int *gap, void *d,
+     yasm_output_value_func output_value,
+     /*@null@*/ yasm_output_reloc_func output_reloc);
+
 /** Get the bytecode multiple value as an integer.
  * \param bc            bytecode
  * \param multiple      multiple value (output)
@@ -622,6 +755,24 @@ YASM_LIB_DECL
 /*@null@*/ yasm_dataval *yasm_dvs_append
     (yasm_datavalhead *headp, /*@returned@*/ /*@null@*/ yasm_dataval *dv);
 
+/** Add a data value for an expression to the end of a list of data values.
+ * Unlike appending yasm_dv_create_expr(e), constant integer expressions are
+ * immediately converted to bytes and packed into a trailing raw data value,
+ * so large tables of constants don't need a data value and expression per
+ * item.  Constants that don't fit in size bytes are kept as expressions, so
+ * yasm_bc_create_data() warns about them as before.  The list must be passed
+ * to yasm_bc_create_data() with the same size and arch, and append_zero=0.
+ * \param headp         data value list
+ * \param e             expression
+ * \param size          size of each data element (in bytes); 0 disables
+ *                      packing
+ * \param arch          architecture used to convert constants; if NULL,
+ *                      only 1-byte elements are packed
+ */
+YASM_LIB_DECL
+void yasm_dvs_append_expr(yasm_datavalhead *headp, /*@only@*/ yasm_expr *e,
+                          unsigned int size, /*@null@*/ yasm_arch *arch);
+
 /** Print a data value list.  For debugging purposes.
  * \param f             file
  * \param indent_level  indentation level
@@ -89,6 +89,11 @@ typedef struct yasm_assoc_data_callback {
  */
 typedef struct yasm_errwarns yasm_errwarns;
 
+/** Error and warning indicators saved from one thread (opaque type).
+ * \see errwarn.h for details.
+ */
+typedef struct yasm_errwarn_saved yasm_errwarn_saved;
+
 /** Bytecode.  \see bytecode.h for details and related functions. */
 typedef struct yasm_bytecode yasm_bytecode;
 
@@ -191,6 +196,16 @@ typedef struct yasm_value {
  */
 typedef struct yasm_linemap yasm_linemap;
 
+/** Optimizer size hints (opaque type).  \see sizehints.h for related
+ * functions.
+ */
+typedef struct yasm_size_hints yasm_size_hints;
+
+/** Object file string table (opaque type).  \see strtab.h for related
+ * functions.
+ */
+typedef struct yasm_strtab yasm_strtab;
+
 /** Value/parameter pair (opaque type).
  * \see valparam.h for related functions.
  */
@@ -295,6 +310,16 @@ typedef int (*yasm_output_reloc_func)
     (yasm_symrec *sym, yasm_bytecode *bc, unsigned char *buf,
      unsigned int destsize, unsigned int valsize, int warn, void *d);
 
+/** Register an associated data callback.  Data associated using a
+ * registered callback is kept in a slot of its own and found without
+ * searching.  Should be called when the module using the callback is
+ * initialized, before any data is associated with it; further calls do
+ * nothing.  Callbacks that are never registered still work.
+ * \param callback  callback
+ */
+YASM_LIB_DECL
+void yasm_assoc_data_register(const yasm_assoc_data_callback *callback);
+
 /** Sort an array using merge sort algorithm.
  * \internal
  * \param base      base of array
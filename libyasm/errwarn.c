@@ -33,6 +33,7 @@
 
 #include "linemap.h"
 #include "errwarn.h"
+#include "preproc.h"
 
 
 #define MSG_MAXSIZE     1024
@@ -54,12 +55,13 @@ static const char *def_gettext_hook(const char *msgid);
 /*@exits@*/ void (*yasm_fatal) (const char *message, va_list va) = def_fatal;
 const char * (*yasm_gettext_hook) (const char *msgid) = def_gettext_hook;
 
-/* Error indicator */
-/* yasm_eclass is not static so that yasm_error_occurred macro can access it */
-yasm_error_class yasm_eclass;
-static /*@only@*/ /*@null@*/ char *yasm_estr;
-static unsigned long yasm_exrefline;
-static /*@only@*/ /*@null@*/ char *yasm_exrefstr;
+/* Error indicator.  The error and warning indicators are kept per thread,
+ * so bytecodes finalized on different threads don't mix their errors.
+ */
+static YASM_THREAD_LOCAL yasm_error_class yasm_eclass;
+static YASM_THREAD_LOCAL /*@only@*/ /*@null@*/ char *yasm_estr;
+static YASM_THREAD_LOCAL unsigned long yasm_exrefline;
+static YASM_THREAD_LOCAL /*@only@*/ /*@null@*/ char *yasm_exrefstr;
 
 /* Warning indicator */
 typedef struct warn {
@@ -68,24 +70,48 @@ typedef struct warn {
     yasm_warn_class wclass;
     /*@owned@*/ /*@null@*/ char *wstr;
 } warn;
-static STAILQ_HEAD(warn_head, warn) yasm_warns;
+/* Only initialized by yasm_errwarn_initialize() on the thread calling it;
+ * yasm_warn_set_va() initializes it when empty for any other thread.
+ */
+static YASM_THREAD_LOCAL STAILQ_HEAD(warn_head, warn) yasm_warns;
+
+/* Error and warning indicators moved off a thread by yasm_errwarn_save() */
+struct yasm_errwarn_saved {
+    yasm_error_class eclass;
+    /*@only@*/ /*@null@*/ char *estr;
+    unsigned long exrefline;
+    /*@only@*/ /*@null@*/ char *exrefstr;
+
+    /*@reldef@*/ STAILQ_HEAD(saved_warn_head, warn) warns;
+};
 
 /* Enabled warnings.  See errwarn.h for a list. */
 static unsigned long warn_class_enabled;
 
 typedef struct errwarn_data {
-    /*@reldef@*/ SLIST_ENTRY(errwarn_data) link;
-
     enum { WE_UNKNOWN, WE_ERROR, WE_WARNING, WE_PARSERERROR } type;
 
     unsigned long line;
     unsigned long xrefline;
     /*@owned@*/ char *msg;
-    /*@owned@*/ char *xrefmsg;
+    /*@owned@*/ /*@null@*/ char *xrefmsg;
 } errwarn_data;
 
 struct yasm_errwarns {
-    /*@reldef@*/ SLIST_HEAD(errwarn_head, errwarn_data) errwarns;
+    /* Errors/warnings in the order they were propagated.  Sorted by line
+     * (stable, so the propagation order within a line is kept) only when
+     * they are output; passes after the parser report in bytecode or span
+     * order, so keeping the set sorted on insertion would be quadratic.
+     */
+    /*@only@*/ /*@null@*/ errwarn_data *we;
+    size_t num_we;
+    size_t max_we;
+
+    /* Nonzero if we[] is known to be sorted by line. */
+    int sorted;
+
+    /* Number of WE_PARSERERROR entries in we[]. */
+    unsigned long num_parsererrors;
 
     /* Total error count */
     unsigned int ecount;
@@ -93,8 +119,8 @@ struct yasm_errwarns {
     /* Total warning count */
     unsigned int wcount;
 
-    /* Last inserted error/warning.  Used to speed up insertions. */
-    /*@null@*/ errwarn_data *previous_we;
+    /* Maximum number of errors/warnings to output (0=unlimited). */
+    unsigned long max_output;
 };
 
 /* Static buffer for use by conv_unprint(). */
@@ -183,67 +209,104 @@ def_fatal(const char *fmt, va_list va)
     exit(EXIT_FAILURE);
 }
 
-/* Create an errwarn structure in the correct linked list location.
- * If replace_parser_error is nonzero, overwrites the last error if its
- * type is WE_PARSERERROR.
+/* Append an errwarn structure to the set.
+ * If replace_parser_error is nonzero, overwrites the last error on the same
+ * line if its type is WE_PARSERERROR.
  */
 static errwarn_data *
 errwarn_data_new(yasm_errwarns *errwarns, unsigned long line,
                  int replace_parser_error)
 {
-    errwarn_data *first, *next, *ins_we, *we;
-    enum { INS_NONE, INS_HEAD, INS_AFTER } action = INS_NONE;
+    errwarn_data *we;
 
-    /* Find the entry with either line=line or the last one with line<line.
-     * Start with the last entry added to speed the search.
-     */
-    ins_we = errwarns->previous_we;
-    first = SLIST_FIRST(&errwarns->errwarns);
-    if (!ins_we || !first)
-        action = INS_HEAD;
-    while (action == INS_NONE) {
-        next = SLIST_NEXT(ins_we, link);
-        if (line < ins_we->line) {
-            if (ins_we == first)
-                action = INS_HEAD;
-            else
-                ins_we = first;
-        } else if (!next)
-            action = INS_AFTER;
-        else if (line >= ins_we->line && line < next->line)
-            action = INS_AFTER;
-        else
-            ins_we = next;
+    if (replace_parser_error && errwarns->num_parsererrors > 0) {
+        /* Parser errors are only generated while parsing, which propagates
+         * in line order, so this is nearly always the last entry.
+         */
+        size_t i = errwarns->num_we;
+        while (i > 0) {
+            we = &errwarns->we[--i];
+            if (we->line == line) {
+                if (we->type != WE_PARSERERROR)
+                    break;
+                /* overwrite last error */
+                errwarns->num_parsererrors--;
+                yasm_xfree(we->msg);
+                if (we->xrefmsg)
+                    yasm_xfree(we->xrefmsg);
+                we->type = WE_UNKNOWN;
+                we->xrefline = 0;
+                we->msg = NULL;
+                we->xrefmsg = NULL;
+                return we;
+            }
+            if (errwarns->sorted && we->line < line)
+                break;
+        }
     }
 
-    if (replace_parser_error && ins_we && ins_we->type == WE_PARSERERROR) {
-        /* overwrite last error */      
-        we = ins_we;
-    } else {
-        /* add a new error */
-        we = yasm_xmalloc(sizeof(errwarn_data));
-
-        we->type = WE_UNKNOWN;
-        we->line = line;
-        we->xrefline = 0;
-        we->msg = NULL;
-        we->xrefmsg = NULL;
-
-        if (action == INS_HEAD)
-            SLIST_INSERT_HEAD(&errwarns->errwarns, we, link);
-        else if (action == INS_AFTER) {
-            assert(ins_we != NULL);
-            SLIST_INSERT_AFTER(ins_we, we, link);
-        } else
-            yasm_internal_error(N_("Unexpected errwarn insert action"));
+    /* add a new error */
+    if (errwarns->num_we >= errwarns->max_we) {
+        errwarns->max_we = errwarns->max_we ? errwarns->max_we*2 : 16;
+        errwarns->we = yasm_xrealloc(errwarns->we,
+                                     errwarns->max_we*sizeof(errwarn_data));
     }
+    if (errwarns->num_we > 0 && line < errwarns->we[errwarns->num_we-1].line)
+        errwarns->sorted = 0;
+    we = &errwarns->we[errwarns->num_we++];
 
-    /* Remember previous err/warn */
-    errwarns->previous_we = we;
+    we->type = WE_UNKNOWN;
+    we->line = line;
+    we->xrefline = 0;
+    we->msg = NULL;
+    we->xrefmsg = NULL;
 
     return we;
 }
 
+/* Compare two errwarns by line only; used with a stable sort. */
+static int
+errwarn_data_compare(const void *a, const void *b)
+{
+    const errwarn_data *we1 = a, *we2 = b;
+
+    if (we1->line < we2->line)
+        return -1;
+    if (we1->line > we2->line)
+        return 1;
+    return 0;
+}
+
+/* Nonzero if two errwarns would print identically. */
+static int
+errwarn_data_same(const errwarn_data *we1, const errwarn_data *we2)
+{
+    int err1 = we1->type != WE_WARNING, err2 = we2->type != WE_WARNING;
+
+    if (err1 != err2 || we1->line != we2->line ||
+        we1->xrefline != we2->xrefline || strcmp(we1->msg, we2->msg) != 0)
+        return 0;
+    if (!we1->xrefmsg || !we2->xrefmsg)
+        return we1->xrefmsg == we2->xrefmsg;
+    return strcmp(we1->xrefmsg, we2->xrefmsg) == 0;
+}
+
+/* Format a message into a newly allocated string of just the needed size;
+ * a set can hold a great many of these until it is output.
+ */
+static /*@only@*/ char *
+errwarn_format(const char *format, va_list va)
+{
+    char buf[MSG_MAXSIZE+1];
+
+#ifdef HAVE_VSNPRINTF
+    vsnprintf(buf, MSG_MAXSIZE, yasm_gettext_hook(format), va);
+#else
+    vsprintf(buf, yasm_gettext_hook(format), va);
+#endif
+    return yasm__xstrdup(buf);
+}
+
 void
 yasm_error_clear(void)
 {
@@ -267,6 +330,12 @@ yasm_error_matches(yasm_error_class eclass)
     return (yasm_eclass & eclass) == eclass;
 }
 
+yasm_error_class
+yasm_error_occurred(void)
+{
+    return yasm_eclass;
+}
+
 void
 yasm_error_set_va(yasm_error_class eclass, const char *format, va_list va)
 {
@@ -274,12 +343,7 @@ yasm_error_set_va(yasm_error_class eclass, const char *format, va_list va)
         return;
 
     yasm_eclass = eclass;
-    yasm_estr = yasm_xmalloc(MSG_MAXSIZE+1);
-#ifdef HAVE_VSNPRINTF
-    vsnprintf(yasm_estr, MSG_MAXSIZE, yasm_gettext_hook(format), va);
-#else
-    vsprintf(yasm_estr, yasm_gettext_hook(format), va);
-#endif
+    yasm_estr = errwarn_format(format, va);
 }
 
 void
@@ -299,12 +363,7 @@ yasm_error_set_xref_va(unsigned long xrefline, const char *format, va_list va)
 
     yasm_exrefline = xrefline;
 
-    yasm_exrefstr = yasm_xmalloc(MSG_MAXSIZE+1);
-#ifdef HAVE_VSNPRINTF
-    vsnprintf(yasm_exrefstr, MSG_MAXSIZE, yasm_gettext_hook(format), va);
-#else
-    vsprintf(yasm_exrefstr, yasm_gettext_hook(format), va);
-#endif
+    yasm_exrefstr = errwarn_format(format, va);
 }
 
 void
@@ -362,12 +421,9 @@ yasm_warn_set_va(yasm_warn_class wclass, const char *format, va_list va)
 
     w = yasm_xmalloc(sizeof(warn));
     w->wclass = wclass;
-    w->wstr = yasm_xmalloc(MSG_MAXSIZE+1);
-#ifdef HAVE_VSNPRINTF
-    vsnprintf(w->wstr, MSG_MAXSIZE, yasm_gettext_hook(format), va);
-#else
-    vsprintf(w->wstr, yasm_gettext_hook(format), va);
-#endif
+    w->wstr = errwarn_format(format, va);
+    if (STAILQ_EMPTY(&yasm_warns))
+        STAILQ_INIT(&yasm_warns);
     STAILQ_INSERT_TAIL(&yasm_warns, w, link);
 }
 
@@ -398,6 +454,51 @@ yasm_warn_fetch(yasm_warn_class *wclass, char **str)
     yasm_xfree(w);
 }
 
+yasm_errwarn_saved *
+yasm_errwarn_save(void)
+{
+    yasm_errwarn_saved *saved;
+
+    if (yasm_eclass == YASM_ERROR_NONE && STAILQ_EMPTY(&yasm_warns))
+        return NULL;
+
+    saved = yasm_xmalloc(sizeof(yasm_errwarn_saved));
+    yasm_error_fetch(&saved->eclass, &saved->estr, &saved->exrefline,
+                     &saved->exrefstr);
+    STAILQ_INIT(&saved->warns);
+    while (!STAILQ_EMPTY(&yasm_warns)) {
+        warn *w = STAILQ_FIRST(&yasm_warns);
+        STAILQ_REMOVE_HEAD(&yasm_warns, link);
+        STAILQ_INSERT_TAIL(&saved->warns, w, link);
+    }
+    return saved;
+}
+
+void
+yasm_errwarn_restore(yasm_errwarn_saved *saved)
+{
+    if (yasm_eclass == YASM_ERROR_NONE && saved->eclass != YASM_ERROR_NONE) {
+        yasm_eclass = saved->eclass;
+        yasm_estr = saved->estr;
+        yasm_exrefline = saved->exrefline;
+        yasm_exrefstr = saved->exrefstr;
+    } else {
+        if (saved->estr)
+            yasm_xfree(saved->estr);
+        if (saved->exrefstr)
+            yasm_xfree(saved->exrefstr);
+    }
+
+    if (STAILQ_EMPTY(&yasm_warns))
+        STAILQ_INIT(&yasm_warns);
+    while (!STAILQ_EMPTY(&saved->warns)) {
+        warn *w = STAILQ_FIRST(&saved->warns);
+        STAILQ_REMOVE_HEAD(&saved->warns, link);
+        STAILQ_INSERT_TAIL(&yasm_warns, w, link);
+    }
+    yasm_xfree(saved);
+}
+
 void
 yasm_warn_enable(yasm_warn_class num)
 {
@@ -420,45 +521,58 @@ yasm_errwarns *
 yasm_errwarns_create(void)
 {
     yasm_errwarns *errwarns = yasm_xmalloc(sizeof(yasm_errwarns));
-    SLIST_INIT(&errwarns->errwarns);
+    errwarns->we = NULL;
+    errwarns->num_we = 0;
+    errwarns->max_we = 0;
+    errwarns->sorted = 1;
+    errwarns->num_parsererrors = 0;
     errwarns->ecount = 0;
     errwarns->wcount = 0;
-    errwarns->previous_we = NULL;
+    errwarns->max_output = 0;
     return errwarns;
 }
 
 void
 yasm_errwarns_destroy(yasm_errwarns *errwarns)
 {
-    errwarn_data *we;
+    size_t i;
 
     /* Delete all error/warnings */
-    while (!SLIST_EMPTY(&errwarns->errwarns)) {
-        we = SLIST_FIRST(&errwarns->errwarns);
+    for (i=0; i<errwarns->num_we; i++) {
+        errwarn_data *we = &errwarns->we[i];
         if (we->msg)
             yasm_xfree(we->msg);
         if (we->xrefmsg)
             yasm_xfree(we->xrefmsg);
-
-        SLIST_REMOVE_HEAD(&errwarns->errwarns, link);
-        yasm_xfree(we);
     }
+    if (errwarns->we)
+        yasm_xfree(errwarns->we);
 
     yasm_xfree(errwarns);
 }
 
+void
+yasm_errwarns_set_max_output(yasm_errwarns *errwarns, unsigned long max)
+{
+    errwarns->max_output = max;
+}
+
 void
 yasm_errwarn_propagate(yasm_errwarns *errwarns, unsigned long line)
 {
+    if (yasm_eclass != YASM_ERROR_NONE || !STAILQ_EMPTY(&yasm_warns))
+        yasm__preproc_pipe_sync();
+
     if (yasm_eclass != YASM_ERROR_NONE) {
         errwarn_data *we = errwarn_data_new(errwarns, line, 1);
         yasm_error_class eclass;
 
         yasm_error_fetch(&eclass, &we->msg, &we->xrefline, &we->xrefmsg);
         if (eclass != YASM_ERROR_GENERAL
-            && (eclass & YASM_ERROR_PARSE) == YASM_ERROR_PARSE)
+            && (eclass & YASM_ERROR_PARSE) == YASM_ERROR_PARSE) {
             we->type = WE_PARSERERROR;
-        else
+            errwarns->num_parsererrors++;
+        } else
             we->type = WE_ERROR;
         errwarns->ecount++;
     }
@@ -482,7 +596,7 @@ yasm_errwarns_num_errors(yasm_errwarns *errwarns, int warning_as_error)
         return errwarns->ecount;
 }
 
-void
+unsigned long
 yasm_errwarns_output_all(yasm_errwarns *errwarns, yasm_linemap *lm,
                          int warning_as_error,
                          yasm_print_error_func print_error,
@@ -491,6 +605,7 @@ yasm_errwarns_output_all(yasm_errwarns *errwarns, yasm_linemap *lm,
     errwarn_data *we;
     const char *filename, *xref_filename;
     unsigned long line, xref_line;
+    size_t i, j, line_start, num;
 
     /* If we're treating warnings as errors, tell the user about it. */
     if (warning_as_error && warning_as_error != 2) {
@@ -500,8 +615,49 @@ yasm_errwarns_output_all(yasm_errwarns *errwarns, yasm_linemap *lm,
         warning_as_error = 2;
     }
 
+    if (!errwarns->sorted) {
+        yasm__mergesort(errwarns->we, errwarns->num_we, sizeof(errwarn_data),
+                        errwarn_data_compare);
+        errwarns->sorted = 1;
+    }
+
+    /* Drop duplicates of an earlier error/warning on the same line (e.g. a
+     * value checked in more than one pass), and take them out of the counts
+     * too.  Lines rarely have more than a handful of entries, so just
+     * compare against the ones already kept.
+     */
+    num = 0;
+    line_start = 0;
+    for (i=0; i<errwarns->num_we; i++) {
+        we = &errwarns->we[i];
+        if (num > 0 && errwarns->we[num-1].line != we->line)
+            line_start = num;
+        for (j=line_start; j<num; j++) {
+            if (errwarn_data_same(&errwarns->we[j], we))
+                break;
+        }
+        if (j < num) {
+            if (we->type == WE_WARNING)
+                errwarns->wcount--;
+            else
+                errwarns->ecount--;
+            if (we->type == WE_PARSERERROR)
+                errwarns->num_parsererrors--;
+            yasm_xfree(we->msg);
+            if (we->xrefmsg)
+                yasm_xfree(we->xrefmsg);
+            continue;
+        }
+        errwarns->we[num++] = *we;
+    }
+    errwarns->num_we = num;
+
+    if (errwarns->max_output > 0 && num > errwarns->max_output)
+        num = errwarns->max_output;
+
     /* Output error/warnings. */
-    SLIST_FOREACH(we, &errwarns->errwarns, link) {
+    for (i=0; i<num; i++) {
+        we = &errwarns->we[i];
         /* Output error/warning */
         yasm_linemap_lookup(lm, we->line, &filename, &line);
         if (we->xrefline)
@@ -516,6 +672,8 @@ yasm_errwarns_output_all(yasm_errwarns *errwarns, yasm_linemap *lm,
         else
             print_warning(filename, line, we->msg);
     }
+
+    return (unsigned long)(errwarns->num_we - num);
 }
 
 void
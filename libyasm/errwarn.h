@@ -124,7 +124,9 @@ void yasm_error_clear(void);
  * been set.  Note that as YASM_ERROR_NONE is 0, the return value can also
  * be treated as a boolean value.
  * \return Current error indicator.
+ * \note The error and warning indicators are kept separately by each thread.
  */
+YASM_LIB_DECL
 yasm_error_class yasm_error_occurred(void);
 
 /** Check the error indicator against an error class.  To check if any error
@@ -137,12 +139,6 @@ yasm_error_class yasm_error_occurred(void);
 YASM_LIB_DECL
 int yasm_error_matches(yasm_error_class eclass);
 
-#ifndef YASM_DOXYGEN
-YASM_LIB_DECL
-extern yasm_error_class yasm_eclass;
-#define yasm_error_occurred()       yasm_eclass
-#endif
-
 /** Set the error indicator (va_list version).  Has no effect if the error
  * indicator is already set.
  * \param eclass    error class
@@ -247,6 +243,23 @@ YASM_LIB_DECL
 void yasm_warn_fetch(/*@out@*/ yasm_warn_class *wclass,
                      /*@out@*/ /*@only@*/ char **str);
 
+/** Move the error and warning indicators of the calling thread into a new
+ * object, clearing them.  Used to report errors and warnings set on one
+ * thread from another; see yasm_errwarn_restore().
+ * \return Saved indicators, or NULL if no indicator was set.
+ */
+YASM_LIB_DECL
+/*@null@*/ /*@only@*/ yasm_errwarn_saved *yasm_errwarn_save(void);
+
+/** Set the error and warning indicators of the calling thread to ones saved
+ * by yasm_errwarn_save(), and delete the saved object.  As with
+ * yasm_error_set(), the saved error is dropped if an error is already set;
+ * the saved warnings are added after any already set.
+ * \param saved     saved indicators
+ */
+YASM_LIB_DECL
+void yasm_errwarn_restore(/*@only@*/ yasm_errwarn_saved *saved);
+
 /** Enable a class of warnings.
  * \param wclass    warning class
  */
@@ -318,15 +331,29 @@ typedef void (*yasm_print_error_func)
 typedef void (*yasm_print_warning_func)
     (const char *fn, unsigned long line, const char *msg);
 
+/** Limit the number of errors/warnings output by yasm_errwarns_output_all().
+ * Errors and warnings beyond the limit are still counted, but not printed;
+ * yasm_errwarns_output_all() returns how many were left out.
+ * \param errwarns  error/warning set
+ * \param max       maximum number to output (0=unlimited, the default)
+ */
+YASM_LIB_DECL
+void yasm_errwarns_set_max_output(yasm_errwarns *errwarns, unsigned long max);
+
 /** Outputs error/warning set in sorted order (sorted by virtual line number).
+ * Errors/warnings on the same line are output in the order they were
+ * propagated; exact duplicates on the same line are only output once, and
+ * are removed from the error and warning counts.
  * \param errwarns          error/warning set
  * \param lm    line map (to convert virtual lines into filename/line pairs)
  * \param warning_as_error  if nonzero, treat warnings as errors.
  * \param print_error       function called to print out errors
  * \param print_warning     function called to print out warnings
+ * \return Number of errors/warnings not output because of the limit set with
+ *         yasm_errwarns_set_max_output().
  */
 YASM_LIB_DECL
-void yasm_errwarns_output_all
+unsigned long yasm_errwarns_output_all
     (yasm_errwarns *errwarns, yasm_linemap *lm, int warning_as_error,
      yasm_print_error_func print_error, yasm_print_warning_func print_warning);
 
@@ -50,12 +50,23 @@ static int expr_traverse_nodes_post(/*@null@*/ yasm_expr *e,
                                     int (*func) (/*@null@*/ yasm_expr *e,
                                                  /*@null@*/ void *d));
 static void expr_delete_term(yasm_expr__item *term, int recurse);
+static yasm_expr *expr_level_tree(yasm_expr *e, int fold_const,
+                                  int simplify_ident, int simplify_reg_mul,
+                                  int calc_bc_dist,
+                                  yasm_expr_xform_func expr_xform_extra,
+                                  void *expr_xform_extra_data);
 
 /* Bitmap of used items.  We should really never need more than 2 at a time,
- * so 31 is pretty much overkill.
+ * so 31 is pretty much overkill.  Kept per thread, as are the counts.
  */
-static unsigned long itempool_used = 0;
-static yasm_expr__item itempool[31];
+static YASM_THREAD_LOCAL unsigned long itempool_used = 0;
+static YASM_THREAD_LOCAL yasm_expr__item itempool[31];
+
+/* Number of expression nodes allocated (for statistics) */
+static YASM_THREAD_LOCAL unsigned long expr_num_created = 0;
+
+/* Nonzero if folded EQU values are cached in their symbols */
+static int equ_caching = 1;
 
 /* allocate a new expression node, with children as defined.
  * If it's a unary operator, put the element in left and set right=NULL. */
@@ -67,6 +78,7 @@ yasm_expr_create(yasm_expr_op op, yasm_expr__item *left,
     yasm_expr *ptr, *sube;
     unsigned long z;
     ptr = yasm_xmalloc(sizeof(yasm_expr));
+    expr_num_created++;
 
     ptr->op = op;
     ptr->numterms = 0;
@@ -364,6 +376,8 @@ expr_xform_neg_item(yasm_expr *e, yasm_expr__item *ei)
 {
     yasm_expr *sube = yasm_xmalloc(sizeof(yasm_expr));
 
+    expr_num_created++;
+
     /* Build -1*ei subexpression */
     sube->op = YASM_EXPR_MUL;
     sube->line = e->line;
@@ -436,6 +450,7 @@ expr_xform_neg_helper(/*@returned@*/ /*@only@*/ yasm_expr *e)
              * Make a new expr (to replace e) with -1*e.
              */
             ne = yasm_xmalloc(sizeof(yasm_expr));
+            expr_num_created++;
             ne->op = YASM_EXPR_MUL;
             ne->line = e->line;
             ne->numterms = 2;
@@ -806,8 +821,31 @@ typedef struct yasm__exprentry {
     /*@null@*/ const yasm_expr *e;
 } yasm__exprentry;
 
+/* Returns nonzero if all leaves of e are integers. */
+static int
+expr_is_int_tree(const yasm_expr *e)
+{
+    int i;
+
+    for (i=0; i<e->numterms; i++) {
+        if (e->terms[i].type == YASM_EXPR_EXPR) {
+            if (!expr_is_int_tree(e->terms[i].data.expn))
+                return 0;
+        } else if (e->terms[i].type != YASM_EXPR_INT)
+            return 0;
+    }
+    return 1;
+}
+
+/* If fold is nonzero (the tree is going to be leveled with constant folding
+ * and identity simplification), equ's that expand to integer constants are
+ * folded here and their values cached in the symrec, so later uses just
+ * copy the cached value instead of copying and re-simplifying the equ
+ * expression.
+ */
 static yasm_expr *
-expr_expand_equ(yasm_expr *e, yasm__exprhead *eh)
+expr_expand_equ(yasm_expr *e, yasm__exprhead *eh, int fold,
+                int simplify_reg_mul)
 {
     int i;
     yasm__exprentry ee;
@@ -819,7 +857,17 @@ expr_expand_equ(yasm_expr *e, yasm__exprhead *eh)
         /* Expand equ's. */
         if (e->terms[i].type == YASM_EXPR_SYM &&
             (equ_expr = yasm_symrec_get_equ(e->terms[i].data.sym))) {
+            yasm_symrec *sym = e->terms[i].data.sym;
+            const yasm_intnum *equ_val;
             yasm__exprentry *np;
+            yasm_expr *sube;
+            int clean;
+
+            if (fold && (equ_val = yasm_symrec_get_equ_value(sym))) {
+                e->terms[i].type = YASM_EXPR_INT;
+                e->terms[i].data.intn = yasm_intnum_copy(equ_val);
+                continue;
+            }
 
             /* Check for circular reference */
             SLIST_FOREACH(np, eh, next) {
@@ -836,11 +884,31 @@ expr_expand_equ(yasm_expr *e, yasm__exprhead *eh)
             /* Remember we saw this equ and recurse */
             ee.e = equ_expr;
             SLIST_INSERT_HEAD(eh, &ee, next);
-            e->terms[i].data.expn = expr_expand_equ(e->terms[i].data.expn, eh);
+            e->terms[i].data.expn = expr_expand_equ(e->terms[i].data.expn, eh,
+                                                    fold, simplify_reg_mul);
             SLIST_REMOVE_HEAD(eh, next);
+
+            if (!fold || !expr_is_int_tree(e->terms[i].data.expn))
+                continue;
+
+            /* Fold the constant now.  Only cache the result if no error or
+             * warning is pending, as it might have come from this fold and
+             * would be lost for later uses of the cached value.
+             */
+            clean = !yasm_error_occurred() && !yasm_warn_occurred();
+            sube = expr_level_tree(e->terms[i].data.expn, 1, 1,
+                                   simplify_reg_mul, 0, NULL, NULL);
+            e->terms[i].data.expn = sube;
+            if (equ_caching && clean && !yasm_error_occurred() &&
+                !yasm_warn_occurred() &&
+                sube->op == YASM_EXPR_IDENT &&
+                sube->terms[0].type == YASM_EXPR_INT)
+                yasm_symrec_set_equ_value(sym,
+                    yasm_intnum_copy(sube->terms[0].data.intn));
         } else if (e->terms[i].type == YASM_EXPR_EXPR)
             /* Recurse */
-            e->terms[i].data.expn = expr_expand_equ(e->terms[i].data.expn, eh);
+            e->terms[i].data.expn = expr_expand_equ(e->terms[i].data.expn, eh,
+                                                    fold, simplify_reg_mul);
     }
 
     return e;
@@ -902,7 +970,8 @@ yasm_expr__level_tree(yasm_expr *e, int fold_const, int simplify_ident,
     if (!e)
         return 0;
 
-    e = expr_expand_equ(e, &eh);
+    e = expr_expand_equ(e, &eh, fold_const && simplify_ident,
+                        simplify_reg_mul);
     e = expr_level_tree(e, fold_const, simplify_ident, simplify_reg_mul,
                         calc_bc_dist, expr_xform_extra, expr_xform_extra_data);
 
@@ -997,6 +1066,7 @@ yasm_expr__copy_except(const yasm_expr *e, int except)
     
     n = yasm_xmalloc(sizeof(yasm_expr) +
                      sizeof(yasm_expr__item)*(e->numterms<2?0:e->numterms-2));
+    expr_num_created++;
 
     n->op = e->op;
     n->line = e->line;
@@ -1213,6 +1283,7 @@ yasm_expr_extract_segoff(yasm_expr **ep)
     else {
         /* Need to build IDENT expression to hold non-expression contents */
         retval = yasm_xmalloc(sizeof(yasm_expr));
+        expr_num_created++;
         retval->op = YASM_EXPR_IDENT;
         retval->numterms = 1;
         retval->terms[0] = e->terms[0]; /* structure copy */
@@ -1242,6 +1313,7 @@ yasm_expr_extract_wrt(yasm_expr **ep)
     else {
         /* Need to build IDENT expression to hold non-expression contents */
         retval = yasm_xmalloc(sizeof(yasm_expr));
+        expr_num_created++;
         retval->op = YASM_EXPR_IDENT;
         retval->numterms = 1;
         retval->terms[0] = e->terms[1]; /* structure copy */
@@ -1484,6 +1556,26 @@ yasm_expr_size(const yasm_expr *e)
     return size;
 }
 
+unsigned long
+yasm_expr_get_num_created(void)
+{
+    return expr_num_created;
+}
+
+void
+yasm_expr_add_num_created(unsigned long num)
+{
+    expr_num_created += num;
+}
+
+int
+yasm_expr_set_equ_caching(int enable)
+{
+    int old = equ_caching;
+    equ_caching = enable;
+    return old;
+}
+
 const char *
 yasm_expr_segment(const yasm_expr *e)
 {
@@ -303,6 +303,30 @@ unsigned int yasm_expr_size(const yasm_expr *e);
  */
 const char *yasm_expr_segment(const yasm_expr *e);
 
+/** Get the number of expression nodes allocated so far (including copies
+ * and nodes created during simplification) by the calling thread, plus any
+ * added with yasm_expr_add_num_created().  For statistics purposes.
+ * \return Number of expression nodes allocated.
+ */
+YASM_LIB_DECL
+unsigned long yasm_expr_get_num_created(void);
+
+/** Add expression nodes allocated by another thread to the count returned
+ * by yasm_expr_get_num_created() on the calling thread.
+ * \param num       number of expression nodes
+ */
+YASM_LIB_DECL
+void yasm_expr_add_num_created(unsigned long num);
+
+/** Enable or disable caching of folded EQU values in their symbols
+ * (enabled by default).  The cache is updated without locking, so it must be
+ * disabled while expressions are simplified on more than one thread.
+ * \param enable    nonzero to enable
+ * \return Previous setting.
+ */
+YASM_LIB_DECL
+int yasm_expr_set_equ_caching(int enable);
+
 /** Traverse over expression tree in order (const version).
  * Calls func for each leaf (non-operation).
  * \param e     expression
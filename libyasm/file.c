@@ -73,6 +73,17 @@ yasm_scanner_delete(yasm_scanner *s)
     }
 }
 
+void
+yasm_scanner_set_line(yasm_scanner *s, unsigned char *line, size_t len)
+{
+    s->bot = line;
+    s->tok = line;
+    s->ptr = line;
+    s->cur = line;
+    s->lim = line + len + 1;
+    s->top = s->lim;
+}
+
 int
 yasm_fill_helper(yasm_scanner *s, unsigned char **cursor,
                  size_t (*input_func) (void *d, unsigned char *buf,
@@ -57,6 +57,19 @@ void yasm_scanner_initialize(yasm_scanner *scanner);
 YASM_LIB_DECL
 void yasm_scanner_delete(yasm_scanner *scanner);
 
+/** Point a scanner state directly at a single line of input, without
+ * copying it.  Used by line-oriented scanners, which take each line from
+ * the preprocessor and scan it in place.
+ * \param scanner   Re2c scanner state
+ * \param line      line of input; line[len] must be a NUL sentinel, which
+ *                  the scanner must treat as end of input (YYFILL should be
+ *                  a no-op).  The scanner does not take ownership of line.
+ * \param len       length of line, not including the sentinel
+ */
+YASM_LIB_DECL
+void yasm_scanner_set_line(yasm_scanner *scanner, unsigned char *line,
+                           size_t len);
+
 /** Fill a scanner state structure with data coming from an input function.
  * \param scanner       Re2c scanner state
  * \param cursor        Re2c scan cursor
@@ -135,6 +135,16 @@ static POT_Entry_Source POT_TableP_Source[] = {
     {{0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x80},0x7fff}, /* 1e+0 */
 };
 
+/* Static bitvects used by floatnum_mul() for the (unsigned) operands and
+ * the double-width product, so multiplies don't allocate.  Per thread.
+ */
+static YASM_THREAD_LOCAL /*@only@*/ wordptr mul_op1, mul_op2, mul_product;
+
+/* While the digits are being parsed, the mantissa is accumulated as
+ * MANT_LIMBS 16-bit limbs (least significant first) in unsigned longs,
+ * which is much cheaper than the equivalent BitVector shifts and adds.
+ */
+#define MANT_LIMBS      (MANT_BITS/16)
 
 static void
 POT_Table_Init_Entry(/*@out@*/ POT_Entry *e, POT_Entry_Source *s, int dec_exp)
@@ -160,7 +170,7 @@ POT_Table_Init_Entry(/*@out@*/ POT_Entry *e, POT_Entry_Source *s, int dec_exp)
 void
 yasm_floatnum_initialize(void)
 /*@globals undef POT_TableN, undef POT_TableP, POT_TableP_Source,
-   POT_TableN_Source @*/
+   POT_TableN_Source, undef mul_op1, undef mul_op2, undef mul_product @*/
 {
     int dec_exp = 1;
     int i;
@@ -185,9 +195,30 @@ yasm_floatnum_initialize(void)
 
     /* Offset POT_TableP so that [0] becomes [-1] */
     POT_TableP++;
+
+    yasm_floatnum_thread_initialize();
 }
 /*@=compdef@*/
 
+void
+yasm_floatnum_thread_initialize(void)
+{
+    /* Allocate 1-bit-longer fields to force the multiply operands to be
+     * unsigned.
+     */
+    mul_op1 = BitVector_Create((N_int)(MANT_BITS+1), FALSE);
+    mul_op2 = BitVector_Create((N_int)(MANT_BITS+1), FALSE);
+    mul_product = BitVector_Create((N_int)((MANT_BITS+1)*2), FALSE);
+}
+
+void
+yasm_floatnum_thread_cleanup(void)
+{
+    BitVector_Destroy(mul_op1);
+    BitVector_Destroy(mul_op2);
+    BitVector_Destroy(mul_product);
+}
+
 /*@-globstate@*/
 void
 yasm_floatnum_cleanup(void)
@@ -203,6 +234,8 @@ yasm_floatnum_cleanup(void)
     }
     BitVector_Destroy(POT_TableP[14].f.mantissa);
 
+    yasm_floatnum_thread_cleanup();
+
     yasm_xfree(POT_TableN);
     yasm_xfree(POT_TableP);
 }
@@ -232,7 +265,6 @@ static void
 floatnum_mul(yasm_floatnum *acc, const yasm_floatnum *op)
 {
     long expon;
-    wordptr product, op1, op2;
     long norm_amt;
 
     /* Compute the new sign */
@@ -263,21 +295,14 @@ floatnum_mul(yasm_floatnum *acc, const yasm_floatnum *op)
     /* Add one to the final exponent, as the multiply shifts one extra time. */
     acc->exponent = (unsigned short)(expon+1);
 
-    /* Allocate space for the multiply result */
-    product = BitVector_Create((N_int)((MANT_BITS+1)*2), FALSE);
-
-    /* Allocate 1-bit-longer fields to force the operands to be unsigned */
-    op1 = BitVector_Create((N_int)(MANT_BITS+1), FALSE);
-    op2 = BitVector_Create((N_int)(MANT_BITS+1), FALSE);
-
     /* Make the operands unsigned after copying from original operands */
-    BitVector_Copy(op1, acc->mantissa);
-    BitVector_MSB(op1, 0);
-    BitVector_Copy(op2, op->mantissa);
-    BitVector_MSB(op2, 0);
+    BitVector_Copy(mul_op1, acc->mantissa);
+    BitVector_MSB(mul_op1, 0);
+    BitVector_Copy(mul_op2, op->mantissa);
+    BitVector_MSB(mul_op2, 0);
 
     /* Compute the product of the mantissas */
-    BitVector_Multiply(product, op1, op2);
+    BitVector_Multiply(mul_product, mul_op1, mul_op2);
 
     /* Normalize the product.  Note: we know the product is non-zero because
      * both of the original operands were non-zero.
@@ -285,19 +310,32 @@ floatnum_mul(yasm_floatnum *acc, const yasm_floatnum *op)
      * Look for the highest set bit, shift to make it the MSB, and adjust
      * exponent.  Don't let exponent go negative.
      */
-    norm_amt = (MANT_BITS*2-1)-Set_Max(product);
+    norm_amt = (MANT_BITS*2-1)-Set_Max(mul_product);
     if (norm_amt > (long)acc->exponent)
         norm_amt = (long)acc->exponent;
-    BitVector_Move_Left(product, (N_int)norm_amt);
+    BitVector_Move_Left(mul_product, (N_int)norm_amt);
     acc->exponent -= (unsigned short)norm_amt;
 
     /* Store the highest bits of the result */
-    BitVector_Interval_Copy(acc->mantissa, product, 0, MANT_BITS, MANT_BITS);
+    BitVector_Interval_Copy(acc->mantissa, mul_product, 0, MANT_BITS,
+                            MANT_BITS);
+}
+
+/* limb = limb*mul + add, where mul and add are less than 2^14.  Returns the
+ * carry out of the most significant limb (nonzero on overflow).
+ */
+static unsigned long
+floatnum_limbs_muladd(unsigned long *limb, unsigned long mul,
+                      unsigned long add)
+{
+    int i;
 
-    /* Free allocated variables */
-    BitVector_Destroy(product);
-    BitVector_Destroy(op1);
-    BitVector_Destroy(op2);
+    for (i=0; i<MANT_LIMBS; i++) {
+        add += limb[i]*mul;
+        limb[i] = add & 0xFFFF;
+        add >>= 16;
+    }
+    return add;
 }
 
 yasm_floatnum *
@@ -306,18 +344,18 @@ yasm_floatnum_create(const char *str)
     yasm_floatnum *flt;
     int dec_exponent, dec_exp_add;      /* decimal (powers of 10) exponent */
     int POT_index;
-    wordptr operand[2];
+    unsigned long limb[MANT_LIMBS], scaled[MANT_LIMBS];
     int sig_digits;
     int decimal_pt;
-    boolean carry;
+    int i;
 
     flt = yasm_xmalloc(sizeof(yasm_floatnum));
 
     flt->mantissa = BitVector_Create(MANT_BITS, TRUE);
 
-    /* allocate and initialize calculation variables */
-    operand[0] = BitVector_Create(MANT_BITS, TRUE);
-    operand[1] = BitVector_Create(MANT_BITS, TRUE);
+    /* initialize calculation variables */
+    for (i=0; i<MANT_LIMBS; i++)
+        limb[i] = 0;
     dec_exponent = 0;
     sig_digits = 0;
     decimal_pt = 1;
@@ -355,18 +393,9 @@ yasm_floatnum_create(const char *str)
         while (isdigit(*str)) {
             /* See if we've processed more than the max significant digits: */
             if (sig_digits < MANT_SIGDIGITS) {
-                /* Multiply mantissa by 10 [x = (x<<1)+(x<<3)] */
-                BitVector_shift_left(flt->mantissa, 0);
-                BitVector_Copy(operand[0], flt->mantissa);
-                BitVector_Move_Left(flt->mantissa, 2);
-                carry = 0;
-                BitVector_add(operand[1], operand[0], flt->mantissa, &carry);
-
-                /* Add in current digit */
-                BitVector_Empty(operand[0]);
-                BitVector_Chunk_Store(operand[0], 4, 0, (N_long)(*str-'0'));
-                carry = 0;
-                BitVector_add(flt->mantissa, operand[1], operand[0], &carry);
+                /* Multiply mantissa by 10 and add in current digit (this
+                 * can't overflow MANT_BITS bits) */
+                floatnum_limbs_muladd(limb, 10, (unsigned long)(*str-'0'));
             } else {
                 /* Can't integrate more digits with mantissa, so instead just
                  * raise by a power of ten.
@@ -391,18 +420,9 @@ yasm_floatnum_create(const char *str)
                 /* Raise by a power of ten */
                 dec_exponent--;
 
-                /* Multiply mantissa by 10 [x = (x<<1)+(x<<3)] */
-                BitVector_shift_left(flt->mantissa, 0);
-                BitVector_Copy(operand[0], flt->mantissa);
-                BitVector_Move_Left(flt->mantissa, 2);
-                carry = 0;
-                BitVector_add(operand[1], operand[0], flt->mantissa, &carry);
-
-                /* Add in current digit */
-                BitVector_Empty(operand[0]);
-                BitVector_Chunk_Store(operand[0], 4, 0, (N_long)(*str-'0'));
-                carry = 0;
-                BitVector_add(flt->mantissa, operand[1], operand[0], &carry);
+                /* Multiply mantissa by 10 and add in current digit (this
+                 * can't overflow MANT_BITS bits) */
+                floatnum_limbs_muladd(limb, 10, (unsigned long)(*str-'0'));
             }
             sig_digits++;
             str++;
@@ -419,9 +439,28 @@ yasm_floatnum_create(const char *str)
         dec_exponent += dec_exp_add;
     }
 
-    /* Free calculation variables. */
-    BitVector_Destroy(operand[1]);
-    BitVector_Destroy(operand[0]);
+    /* If the result is an integer small enough to be exactly representable
+     * in the mantissa, scale by the power of ten directly.  The power of ten
+     * multiplies below are all exact in this case, so this gives the same
+     * result without doing them.
+     */
+    if (dec_exponent > 0 && dec_exponent <= MANT_SIGDIGITS) {
+        for (i=0; i<MANT_LIMBS; i++)
+            scaled[i] = limb[i];
+        for (i=0; i<dec_exponent; i++) {
+            if (floatnum_limbs_muladd(scaled, 10, 0) != 0)
+                break;
+        }
+        if (i == dec_exponent) {
+            for (i=0; i<MANT_LIMBS; i++)
+                limb[i] = scaled[i];
+            dec_exponent = 0;
+        }
+    }
+
+    for (i=0; i<MANT_LIMBS; i++)
+        BitVector_Chunk_Store(flt->mantissa, 16, (N_int)(i*16),
+                              (N_long)limb[i]);
 
     /* Normalize the number, checking for 0 first. */
     if (BitVector_is_empty(flt->mantissa)) {
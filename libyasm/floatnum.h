@@ -44,6 +44,16 @@ void yasm_floatnum_initialize(void);
 YASM_LIB_DECL
 void yasm_floatnum_cleanup(void);
 
+/** Initialize the floatnum data structures kept per thread, for a thread
+ * other than the one that called yasm_floatnum_initialize().
+ */
+YASM_LIB_DECL
+void yasm_floatnum_thread_initialize(void);
+
+/** Clean up the allocations of yasm_floatnum_thread_initialize(). */
+YASM_LIB_DECL
+void yasm_floatnum_thread_cleanup(void);
+
 /** Create a new floatnum from a decimal string.  The input string must be in
  * standard C representation ([+-]123.456e[-+]789).
  * \param str   floating point decimal string
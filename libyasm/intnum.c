@@ -48,17 +48,37 @@ struct yasm_intnum {
     enum { INTNUM_L, INTNUM_BV } type;
 };
 
-/* static bitvect used for conversions */
-static /*@only@*/ wordptr conv_bv;
+/* static bitvect used for conversions (this and the others are per thread) */
+static YASM_THREAD_LOCAL /*@only@*/ wordptr conv_bv;
 
 /* static bitvects used for computation */
-static /*@only@*/ wordptr result, spare, op1static, op2static;
+static YASM_THREAD_LOCAL /*@only@*/ wordptr result, spare, op1static,
+    op2static;
 
-static /*@only@*/ BitVector_from_Dec_static_data *from_dec_data;
+static YASM_THREAD_LOCAL /*@only@*/ BitVector_from_Dec_static_data
+    *from_dec_data;
 
+/* Nonzero if intn is stored as a long that intnum_tobv() converts exactly
+ * (32 bits with sign), so it can be worked on without a bitvect.
+ */
+#define INTNUM_IS_L32(intn) \
+    ((intn)->type == INTNUM_L && (intn)->val.l >= -0x7FFFFFFFL-1 && \
+     (intn)->val.l <= 0x7FFFFFFFL)
 
 void
 yasm_intnum_initialize(void)
+{
+    yasm_intnum_thread_initialize();
+}
+
+void
+yasm_intnum_cleanup(void)
+{
+    yasm_intnum_thread_cleanup();
+}
+
+void
+yasm_intnum_thread_initialize(void)
 {
     conv_bv = BitVector_Create(BITVECT_NATIVE_SIZE, FALSE);
     result = BitVector_Create(BITVECT_NATIVE_SIZE, FALSE);
@@ -69,7 +89,7 @@ yasm_intnum_initialize(void)
 }
 
 void
-yasm_intnum_cleanup(void)
+yasm_intnum_thread_cleanup(void)
 {
     BitVector_from_Dec_static_Shutdown(from_dec_data);
     BitVector_Destroy(op2static);
@@ -128,10 +148,69 @@ intnum_tobv(/*@returned@*/ wordptr bv, const yasm_intnum *intn)
     return bv;
 }
 
+/* Fast path for literals whose value fits into an unsigned long.  Returns 1
+ * and sets *val if str is a non-empty string of digits valid in radix (with
+ * '_' separators allowed except in decimal, as the BitVector conversions
+ * do) and the value doesn't overflow.  Otherwise returns 0 and the caller
+ * falls back to the BitVector conversion, which also reports errors.
+ */
+static int
+intnum_parse_ulong(const char *str, unsigned int radix,
+                   /*@out@*/ unsigned long *val)
+{
+    unsigned long v = 0;
+    unsigned int digit;
+
+    if (*str == '\0')
+        return 0;
+    for (; *str != '\0'; str++) {
+        if (*str >= '0' && *str <= '9')
+            digit = (unsigned int)(*str - '0');
+        else if (*str >= 'a' && *str <= 'f')
+            digit = (unsigned int)(*str - 'a' + 10);
+        else if (*str >= 'A' && *str <= 'F')
+            digit = (unsigned int)(*str - 'A' + 10);
+        else if (*str == '_' && radix != 10)
+            continue;
+        else
+            return 0;
+        if (digit >= radix || v > (ULONG_MAX - digit) / radix)
+            return 0;
+        v = v * radix + digit;
+    }
+    *val = v;
+    return 1;
+}
+
+/* Store a non-negative value into intnum storage (same representation
+ * intnum_frombv() would choose).
+ */
+static void
+intnum_set_ulong(/*@out@*/ yasm_intnum *intn, unsigned long val)
+{
+    if (val <= 0x7FFFFFFFUL) {
+        intn->type = INTNUM_L;
+        intn->val.l = (long)val;
+        return;
+    }
+    BitVector_Empty(conv_bv);
+    BitVector_Chunk_Store(conv_bv, 32, 0, val & 0xFFFFFFFFUL);
+    /* upper half, if unsigned long is wider than 32 bits */
+    BitVector_Chunk_Store(conv_bv, 32, 32, (val >> 16) >> 16);
+    intn->type = INTNUM_BV;
+    intn->val.bv = BitVector_Clone(conv_bv);
+}
+
 yasm_intnum *
 yasm_intnum_create_dec(char *str)
 {
     yasm_intnum *intn = yasm_xmalloc(sizeof(yasm_intnum));
+    unsigned long val;
+
+    if (intnum_parse_ulong(str, 10, &val)) {
+        intnum_set_ulong(intn, val);
+        return intn;
+    }
 
     switch (BitVector_from_Dec_static(from_dec_data, conv_bv,
                                       (unsigned char *)str)) {
@@ -153,6 +232,12 @@ yasm_intnum *
 yasm_intnum_create_bin(char *str)
 {
     yasm_intnum *intn = yasm_xmalloc(sizeof(yasm_intnum));
+    unsigned long val;
+
+    if (intnum_parse_ulong(str, 2, &val)) {
+        intnum_set_ulong(intn, val);
+        return intn;
+    }
 
     switch (BitVector_from_Bin(conv_bv, (unsigned char *)str)) {
         case ErrCode_Pars:
@@ -173,6 +258,12 @@ yasm_intnum *
 yasm_intnum_create_oct(char *str)
 {
     yasm_intnum *intn = yasm_xmalloc(sizeof(yasm_intnum));
+    unsigned long val;
+
+    if (intnum_parse_ulong(str, 8, &val)) {
+        intnum_set_ulong(intn, val);
+        return intn;
+    }
 
     switch (BitVector_from_Oct(conv_bv, (unsigned char *)str)) {
         case ErrCode_Pars:
@@ -193,6 +284,12 @@ yasm_intnum *
 yasm_intnum_create_hex(char *str)
 {
     yasm_intnum *intn = yasm_xmalloc(sizeof(yasm_intnum));
+    unsigned long val;
+
+    if (intnum_parse_ulong(str, 16, &val)) {
+        intnum_set_ulong(intn, val);
+        return intn;
+    }
 
     switch (BitVector_from_Hex(conv_bv, (unsigned char *)str)) {
         case ErrCode_Pars:
@@ -795,6 +892,20 @@ yasm_intnum_get_sized(const yasm_intnum *intn, unsigned char *ptr,
         yasm_warn_set(YASM_WARN_GENERAL,
                       N_("value does not fit in %d bit field"), valsize);
 
+    /* Whole bytes of a small value (the usual immediate or displacement)
+     * replace the destination entirely, so just write them out.
+     */
+    if (!bigendian && shift == 0 && valsize == destsize*8 &&
+        INTNUM_IS_L32(intn)) {
+        unsigned long ul = (unsigned long)intn->val.l;
+        unsigned char fill = intn->val.l < 0 ? 0xFF : 0;
+        size_t i;
+
+        for (i=0; i<destsize; i++)
+            ptr[i] = i < 4 ? (unsigned char)((ul >> (8*i)) & 0xFF) : fill;
+        return;
+    }
+
     /* Read the original data into a bitvect */
     if (bigendian) {
         /* TODO */
@@ -842,6 +953,21 @@ yasm_intnum_check_size(const yasm_intnum *intn, size_t size, size_t rshift,
 {
     wordptr val;
 
+    /* Small values are checked without converting to a bitvect */
+    if (rshift == 0 && size > 0 && size < BITVECT_NATIVE_SIZE &&
+        INTNUM_IS_L32(intn)) {
+        long l = intn->val.l;
+
+        if (l < 0) {
+            /* -l-1 must fit in size-1 bits */
+            return rangetype > 0 &&
+                (size > 32 || (unsigned long)(-(l+1)) < (1UL << (size-1)));
+        }
+        if (rangetype == 1)
+            size--;
+        return size >= 32 || (unsigned long)l < (1UL << size);
+    }
+
     /* If not already a bitvect, convert value to a bitvect */
     if (intn->type == INTNUM_BV) {
         if (rshift > 0) {
@@ -42,6 +42,16 @@ void yasm_intnum_initialize(void);
 YASM_LIB_DECL
 void yasm_intnum_cleanup(void);
 
+/** Initialize the intnum data structures kept per thread, for a thread
+ * other than the one that called yasm_intnum_initialize().
+ */
+YASM_LIB_DECL
+void yasm_intnum_thread_initialize(void);
+
+/** Clean up the allocations of yasm_intnum_thread_initialize(). */
+YASM_LIB_DECL
+void yasm_intnum_thread_cleanup(void);
+
 /** Create a new intnum from a decimal string.
  * \param str       decimal string
  * \return Newly allocated intnum.
@@ -31,6 +31,7 @@
 
 #include "errwarn.h"
 #include "linemap.h"
+#include "preproc.h"
 
 
 typedef struct line_mapping {
@@ -87,6 +88,8 @@ yasm_linemap_set(yasm_linemap *linemap, const char *filename,
     int replace = 0;
     line_mapping *mapping = NULL;
 
+    yasm__preproc_pipe_sync();
+
     if (virtual_line == 0) {
         virtual_line = linemap->current;
     }
@@ -144,6 +147,8 @@ yasm_linemap_poke(yasm_linemap *linemap, const char *filename,
     unsigned long line;
     line_mapping *mapping;
 
+    yasm__preproc_pipe_sync();
+
     linemap->current++;
     yasm_linemap_set(linemap, filename, 0, file_line, 0);
 
@@ -208,15 +213,25 @@ yasm_linemap_destroy(yasm_linemap *linemap)
 unsigned long
 yasm_linemap_get_current(yasm_linemap *linemap)
 {
+    yasm__preproc_pipe_sync();
     return linemap->current;
 }
 
 void
 yasm_linemap_add_source(yasm_linemap *linemap, yasm_bytecode *bc,
                         const char *source)
+{
+    yasm_linemap_add_source_owned(linemap, bc, yasm__xstrdup(source));
+}
+
+void
+yasm_linemap_add_source_owned(yasm_linemap *linemap, yasm_bytecode *bc,
+                              char *source)
 {
     size_t i;
 
+    yasm__preproc_pipe_sync();
+
     while (linemap->current > linemap->source_info_size) {
         /* allocate another size bins when full for 2x space */
         linemap->source_info = yasm_xrealloc(linemap->source_info,
@@ -233,12 +248,13 @@ yasm_linemap_add_source(yasm_linemap *linemap, yasm_bytecode *bc,
         yasm_xfree(linemap->source_info[linemap->current-1].source);
 
     linemap->source_info[linemap->current-1].bc = bc;
-    linemap->source_info[linemap->current-1].source = yasm__xstrdup(source);
+    linemap->source_info[linemap->current-1].source = source;
 }
 
 unsigned long
 yasm_linemap_goto_next(yasm_linemap *linemap)
 {
+    yasm__preproc_pipe_sync();
     return ++(linemap->current);
 }
 
@@ -249,6 +265,8 @@ yasm_linemap_lookup(yasm_linemap *linemap, unsigned long line,
     line_mapping *mapping;
     unsigned long vindex, step;
 
+    yasm__preproc_pipe_sync();
+
     assert(line <= linemap->current);
 
     /* Binary search through map to find highest line_index <= index */
@@ -273,6 +291,7 @@ int
 yasm_linemap_traverse_filenames(yasm_linemap *linemap, /*@null@*/ void *d,
                                 int (*func) (const char *filename, void *d))
 {
+    yasm__preproc_pipe_sync();
     return HAMT_traverse(linemap->filenames, d, (int (*) (void *, void *))func);
 }
 
@@ -280,6 +299,7 @@ int
 yasm_linemap_get_source(yasm_linemap *linemap, unsigned long line,
                         yasm_bytecode **bcp, const char **sourcep)
 {
+    yasm__preproc_pipe_sync();
     if (line > linemap->source_info_size) {
         *bcp = NULL;
         *sourcep = NULL;
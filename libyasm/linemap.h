@@ -80,6 +80,20 @@ void yasm_linemap_add_source(yasm_linemap *linemap,
                              /*@null@*/ yasm_bytecode *bc,
                              const char *source);
 
+/** Add bytecode and source line information to the current virtual line,
+ * taking ownership of the source line rather than copying it.
+ * \attention Deletes any existing bytecode and source line information for
+ *            the current virtual line.
+ * \param linemap       line mapping repository
+ * \param bc            bytecode (if any)
+ * \param source        source code line (allocated with yasm_xmalloc();
+ *                      freed by the line mapping repository)
+ */
+YASM_LIB_DECL
+void yasm_linemap_add_source_owned(yasm_linemap *linemap,
+                                   /*@null@*/ yasm_bytecode *bc,
+                                   /*@only@*/ char *source);
+
 /** Go to the next line (increments the current virtual line).
  * \param linemap       line mapping repository
  * \return The current (new) virtual line.
@@ -0,0 +1,367 @@
+/*
+ * Preprocessor pipe
+ *
+ *  Copyright (C) 2026  Yasm developers
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR AND OTHER CONTRIBUTORS ``AS IS''
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE AUTHOR OR OTHER CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+#include "util.h"
+
+#ifdef YASM_THREADS
+#include <pthread.h>
+#endif
+
+#include "coretype.h"
+#include "errwarn.h"
+#include "intnum.h"
+#include "floatnum.h"
+#include "expr.h"
+#include "preproc.h"
+
+#ifdef YASM_THREADS
+
+/* Number of lines the preprocessor can get ahead by; a power of two */
+#define PIPE_SIZE       256
+
+/* Lines (or free slots) to collect before waking a thread waiting for them,
+ * rather than switching threads for each
+ */
+#define PIPE_BATCH      64
+
+/* A line, with the errors and warnings left for the caller to propagate */
+typedef struct pipe_line {
+    /*@owned@*/ /*@null@*/ char *line;      /* NULL at the end */
+    /*@owned@*/ /*@null@*/ yasm_errwarn_saved *saved;
+} pipe_line;
+
+/* The ring of lines is lock-free while it is neither empty nor full: only
+ * the thread advances tail and only the caller advances head.  The mutex
+ * and condition variables are only used to wait for the other side.
+ */
+typedef struct preproc_pipe {
+    yasm_preproc_base preproc;      /* base structure */
+
+    /* Module of the source preprocessor, with our functions */
+    yasm_preproc_module module;
+
+    /*@only@*/ yasm_preproc *source;
+    pthread_t thread;
+    int started;        /* 1 once the thread is started, -1 if it can't be */
+    int done;           /* nonzero once the end was taken */
+
+    pipe_line lines[PIPE_SIZE];
+    volatile unsigned long head;    /* next line to take */
+    volatile unsigned long tail;    /* next line to put */
+
+    pthread_mutex_t mutex;
+    pthread_cond_t reader_cond;     /* signaled when a line is put */
+    pthread_cond_t writer_cond;     /* signaled when a line is taken, the
+                                     * caller waits, or on stop */
+    volatile int reader_waiting;    /* caller waiting for a line */
+    volatile int writer_waiting;    /* thread waiting for the caller */
+    volatile int stop;              /* nonzero if the caller is done */
+
+    int synced;     /* the caller has waited since the last line was put */
+
+    /* Expression nodes created by the thread (for statistics) */
+    unsigned long num_exprs;
+} preproc_pipe;
+
+static /*@exits@*/ void (*pipe_orig_fatal) (const char *message, va_list va);
+
+/* Pipe whose thread this is, if any */
+static YASM_THREAD_LOCAL /*@null@*/ preproc_pipe *pipe_current;
+
+void
+yasm__preproc_pipe_sync(void)
+{
+    preproc_pipe *pipe = pipe_current;
+
+    if (!pipe || pipe->synced)
+        return;
+
+    /* Once the caller waits with all lines taken, it can't do anything
+     * until the next line is put: until then, this thread can act for it.
+     */
+    pthread_mutex_lock(&pipe->mutex);
+    pipe->writer_waiting = 1;
+    if (pipe->reader_waiting)
+        pthread_cond_signal(&pipe->reader_cond);    /* take the rest */
+    while (!(pipe->reader_waiting && pipe->head == pipe->tail) && !pipe->stop)
+        pthread_cond_wait(&pipe->writer_cond, &pipe->mutex);
+    pipe->writer_waiting = 0;
+    pthread_mutex_unlock(&pipe->mutex);
+    pipe->synced = 1;
+}
+
+static /*@exits@*/ void
+pipe_fatal(const char *message, va_list va)
+{
+    yasm__preproc_pipe_sync();
+    pipe_orig_fatal(message, va);
+}
+
+/* Put a line (NULL at the end) for the caller, along with the errors and
+ * warnings left.  Returns zero, without putting the line, if the caller is
+ * done.
+ */
+static int
+pipe_put(preproc_pipe *pipe, /*@null@*/ char *line)
+{
+    pipe_line *pl;
+    unsigned long tail = pipe->tail;
+
+    if (tail - pipe->head == PIPE_SIZE || pipe->stop) {
+        pthread_mutex_lock(&pipe->mutex);
+        pipe->writer_waiting = 1;
+        YASM_MEMORY_BARRIER();
+        while (tail - pipe->head == PIPE_SIZE && !pipe->stop)
+            pthread_cond_wait(&pipe->writer_cond, &pipe->mutex);
+        pipe->writer_waiting = 0;
+        pthread_mutex_unlock(&pipe->mutex);
+        if (pipe->stop)
+            return 0;
+    }
+
+    pl = &pipe->lines[tail & (PIPE_SIZE-1)];
+    pl->line = line;
+    pl->saved = yasm_errwarn_save();
+    YASM_MEMORY_BARRIER();
+    pipe->tail = tail+1;
+    pipe->synced = 0;
+    YASM_MEMORY_BARRIER();
+    if (pipe->reader_waiting && (tail+1-pipe->head >= PIPE_BATCH || !line)) {
+        pthread_mutex_lock(&pipe->mutex);
+        pthread_cond_signal(&pipe->reader_cond);
+        pthread_mutex_unlock(&pipe->mutex);
+    }
+    return 1;
+}
+
+static /*@null@*/ void *
+pipe_thread(void *d)
+{
+    preproc_pipe *pipe = d;
+
+    pipe_current = pipe;
+    yasm_intnum_thread_initialize();
+    yasm_floatnum_thread_initialize();
+    for (;;) {
+        char *line = yasm_preproc_get_line(pipe->source);
+        if (!line)
+            pipe->num_exprs = yasm_expr_get_num_created();
+        if (!pipe_put(pipe, line)) {
+            if (line)
+                yasm_xfree(line);
+            break;
+        }
+        if (!line)
+            break;
+    }
+    yasm_floatnum_thread_cleanup();
+    yasm_intnum_thread_cleanup();
+    return NULL;
+}
+
+static char *
+pipe_get_line(yasm_preproc *preproc)
+{
+    preproc_pipe *pipe = (preproc_pipe *)preproc;
+    unsigned long head = pipe->head;
+    pipe_line *pl;
+    char *line;
+
+    if (pipe->done)
+        return NULL;
+
+    if (pipe->started == 0) {
+        if (pthread_create(&pipe->thread, NULL, pipe_thread, pipe) == 0)
+            pipe->started = 1;
+        else
+            pipe->started = -1;     /* go on without the thread */
+    }
+    if (pipe->started < 0)
+        return yasm_preproc_get_line(pipe->source);
+
+    if (head == pipe->tail) {
+        pthread_mutex_lock(&pipe->mutex);
+        pipe->reader_waiting = 1;
+        YASM_MEMORY_BARRIER();
+        if (pipe->writer_waiting && head == pipe->tail)
+            pthread_cond_signal(&pipe->writer_cond);
+        while (head == pipe->tail)
+            pthread_cond_wait(&pipe->reader_cond, &pipe->mutex);
+        pipe->reader_waiting = 0;
+        pthread_mutex_unlock(&pipe->mutex);
+    }
+
+    YASM_MEMORY_BARRIER();
+    pl = &pipe->lines[head & (PIPE_SIZE-1)];
+    line = pl->line;
+    if (pl->saved)
+        yasm_errwarn_restore(pl->saved);
+    YASM_MEMORY_BARRIER();
+    pipe->head = head+1;
+    YASM_MEMORY_BARRIER();
+    if (pipe->writer_waiting && pipe->tail-(head+1) <= PIPE_SIZE-PIPE_BATCH) {
+        pthread_mutex_lock(&pipe->mutex);
+        pthread_cond_signal(&pipe->writer_cond);
+        pthread_mutex_unlock(&pipe->mutex);
+    }
+
+    if (!line) {
+        pthread_join(pipe->thread, NULL);
+        yasm_expr_add_num_created(pipe->num_exprs);
+        pipe->done = 1;
+    }
+    return line;
+}
+
+static void
+pipe_destroy(/*@only@*/ yasm_preproc *preproc)
+{
+    preproc_pipe *pipe = (preproc_pipe *)preproc;
+
+    if (pipe->started > 0 && !pipe->done) {
+        /* While this waits for the thread, the thread can act for it */
+        pthread_mutex_lock(&pipe->mutex);
+        pipe->stop = 1;
+        pthread_cond_signal(&pipe->writer_cond);
+        pthread_mutex_unlock(&pipe->mutex);
+        pthread_join(pipe->thread, NULL);
+        while (pipe->head != pipe->tail) {
+            pipe_line *pl = &pipe->lines[pipe->head & (PIPE_SIZE-1)];
+            if (pl->line)
+                yasm_xfree(pl->line);
+            if (pl->saved) {
+                yasm_errwarn_restore(pl->saved);
+                yasm_error_clear();
+                yasm_warn_clear();
+            }
+            pipe->head++;
+        }
+    }
+    pthread_cond_destroy(&pipe->writer_cond);
+    pthread_cond_destroy(&pipe->reader_cond);
+    pthread_mutex_destroy(&pipe->mutex);
+
+    if (yasm_fatal == pipe_fatal)
+        yasm_fatal = pipe_orig_fatal;
+    yasm_preproc_destroy(pipe->source);
+    yasm_xfree(pipe);
+}
+
+static size_t
+pipe_get_included_file(yasm_preproc *preproc, /*@out@*/ char *buf,
+                       size_t max_size)
+{
+    preproc_pipe *pipe = (preproc_pipe *)preproc;
+    return yasm_preproc_get_included_file(pipe->source, buf, max_size);
+}
+
+static void
+pipe_add_include_file(yasm_preproc *preproc, const char *filename)
+{
+    preproc_pipe *pipe = (preproc_pipe *)preproc;
+    yasm_preproc_add_include_file(pipe->source, filename);
+}
+
+static void
+pipe_predefine_macro(yasm_preproc *preproc, const char *macronameval)
+{
+    preproc_pipe *pipe = (preproc_pipe *)preproc;
+    yasm_preproc_predefine_macro(pipe->source, macronameval);
+}
+
+static void
+pipe_undefine_macro(yasm_preproc *preproc, const char *macroname)
+{
+    preproc_pipe *pipe = (preproc_pipe *)preproc;
+    yasm_preproc_undefine_macro(pipe->source, macroname);
+}
+
+static void
+pipe_define_builtin(yasm_preproc *preproc, const char *macronameval)
+{
+    preproc_pipe *pipe = (preproc_pipe *)preproc;
+    yasm_preproc_define_builtin(pipe->source, macronameval);
+}
+
+static void
+pipe_add_standard(yasm_preproc *preproc, const char **macros)
+{
+    preproc_pipe *pipe = (preproc_pipe *)preproc;
+    yasm_preproc_add_standard(pipe->source, macros);
+}
+
+yasm_preproc *
+yasm_preproc_pipe_create(yasm_preproc *preproc)
+{
+    preproc_pipe *pipe = yasm_xmalloc(sizeof(preproc_pipe));
+
+    /* Keep the name and keyword, as parsers may look at them */
+    pipe->module = *((yasm_preproc_base *)preproc)->module;
+    pipe->module.destroy = pipe_destroy;
+    pipe->module.get_line = pipe_get_line;
+    pipe->module.get_included_file = pipe_get_included_file;
+    pipe->module.add_include_file = pipe_add_include_file;
+    pipe->module.predefine_macro = pipe_predefine_macro;
+    pipe->module.undefine_macro = pipe_undefine_macro;
+    pipe->module.define_builtin = pipe_define_builtin;
+    pipe->module.add_standard = pipe_add_standard;
+    pipe->preproc.module = &pipe->module;
+
+    pipe->source = preproc;
+    pipe->started = 0;
+    pipe->done = 0;
+    pipe->head = 0;
+    pipe->tail = 0;
+    pthread_mutex_init(&pipe->mutex, NULL);
+    pthread_cond_init(&pipe->reader_cond, NULL);
+    pthread_cond_init(&pipe->writer_cond, NULL);
+    pipe->reader_waiting = 0;
+    pipe->writer_waiting = 0;
+    pipe->stop = 0;
+    pipe->synced = 0;
+    pipe->num_exprs = 0;
+
+    if (yasm_fatal != pipe_fatal) {
+        pipe_orig_fatal = yasm_fatal;
+        yasm_fatal = pipe_fatal;
+    }
+    return (yasm_preproc *)pipe;
+}
+
+#else
+
+void
+yasm__preproc_pipe_sync(void)
+{
+}
+
+yasm_preproc *
+yasm_preproc_pipe_create(yasm_preproc *preproc)
+{
+    return preproc;
+}
+
+#endif
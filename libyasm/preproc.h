@@ -30,6 +30,10 @@
 #ifndef YASM_PREPROC_H
 #define YASM_PREPROC_H
 
+#ifndef YASM_LIB_DECL
+#define YASM_LIB_DECL
+#endif
+
 #ifndef YASM_DOXYGEN
 /** Base #yasm_preproc structure.  Must be present as the first element in any
  * #yasm_preproc implementation.
@@ -178,6 +182,29 @@ void yasm_preproc_define_builtin(yasm_preproc *preproc,
 void yasm_preproc_add_standard(yasm_preproc *preproc,
                                const char **macros);
 
+/** Create a preprocessor that runs another one ahead of its caller, on a
+ * thread of its own, and passes its lines on through a bounded buffer.
+ * Before the preprocessor uses a symbol table, line map or error list (or
+ * reports a fatal error), its thread waits for the caller to take every
+ * line so far and ask for the next one, so the result is the same as
+ * calling the preprocessor directly.  The thread is started by the first
+ * yasm_preproc_get_line(); call the other preprocessor functions before
+ * that.  Without thread support, the preprocessor is returned as is.
+ * \param preproc       preprocessor
+ * \return Preprocessor; destroying it also destroys preproc.
+ */
+YASM_LIB_DECL
+/*@only@*/ yasm_preproc *yasm_preproc_pipe_create
+    (/*@only@*/ yasm_preproc *preproc);
+
+/** Called by functions that use a symbol table, line map or error list:
+ * if called from the thread of a preprocessor pipe (see
+ * yasm_preproc_pipe_create()), wait until that is safe.
+ * \internal
+ */
+YASM_LIB_DECL
+void yasm__preproc_pipe_sync(void);
+
 #ifndef YASM_DOXYGEN
 
 /* Inline macro implementations for preproc functions */
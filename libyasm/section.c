@@ -27,6 +27,9 @@
 #include "util.h"
 
 #include <limits.h>
+#ifdef YASM_THREADS
+#include <pthread.h>
+#endif
 
 #include "libyasm-stdint.h"
 #include "coretype.h"
@@ -37,6 +40,7 @@
 #include "linemap.h"
 #include "errwarn.h"
 #include "intnum.h"
+#include "floatnum.h"
 #include "expr.h"
 #include "value.h"
 #include "symrec.h"
@@ -49,6 +53,7 @@
 #include "objfmt.h"
 
 #include "inttree.h"
+#include "sizehints.h"
 
 
 struct yasm_section {
@@ -209,6 +214,12 @@ directives_add(yasm_object *object, /*@null@*/ const yasm_directive *dir)
     }
 }
 
+static void
+section_name_delete(/*@only@*/ void *data)
+{
+    /* Sections are owned by the sections list, not the name index */
+}
+
 /*@-compdestroy@*/
 yasm_object *
 yasm_object_create(const char *src_filename, const char *obj_filename,
@@ -226,11 +237,22 @@ yasm_object_create(const char *src_filename, const char *obj_filename,
     object->global_prefix = yasm__xstrdup("");
     object->global_suffix = yasm__xstrdup("");
 
+    /* Write sections incrementally by default */
+    object->presize_output = 0;
+
+    /* Finalize on the calling thread only by default */
+    object->finalize_threads = 1;
+
+    /* No statistics or size hints */
+    object->optimize_stats = NULL;
+    object->size_hints = NULL;
+
     /* Create empty symbol table */
     object->symtab = yasm_symtab_create();
 
-    /* Initialize sections linked list */
+    /* Initialize sections linked list and name index */
     STAILQ_INIT(&object->sections);
+    object->section_names = HAMT_create(0, yasm_internal_error_);
 
     /* Create directives HAMT */
     object->directives = HAMT_create(1, yasm_internal_error_);
@@ -310,15 +332,13 @@ yasm_object_get_general(yasm_object *object, const char *name,
 {
     yasm_section *s;
     yasm_bytecode *bc;
+    int replace = 0;
 
-    /* Search through current sections to see if we already have one with
-     * that name.
-     */
-    STAILQ_FOREACH(s, &object->sections, link) {
-        if (strcmp(s->name, name) == 0) {
-            *isnew = 0;
-            return s;
-        }
+    /* See if we already have a section with that name. */
+    s = HAMT_search(object->section_names, name);
+    if (s) {
+        *isnew = 0;
+        return s;
     }
 
     /* No: we have to allocate and create a new one. */
@@ -329,6 +349,8 @@ yasm_object_get_general(yasm_object *object, const char *name,
 
     s->object = object;
     s->name = yasm__xstrdup(name);
+    HAMT_insert(object->section_names, s->name, s, &replace,
+                section_name_delete);
     s->assoc_data = NULL;
     s->align = align;
 
@@ -400,6 +422,31 @@ yasm_object_set_global_suffix(yasm_object *object, const char *suffix)
     object->global_suffix = yasm__xstrdup(suffix);
 }
 
+void
+yasm_object_set_presize_output(yasm_object *object, int enable)
+{
+    object->presize_output = enable;
+}
+
+void
+yasm_object_set_finalize_threads(yasm_object *object,
+                                 unsigned int num_threads)
+{
+    object->finalize_threads = num_threads;
+}
+
+void
+yasm_object_set_optimize_stats(yasm_object *object, yasm_optimize_stats *stats)
+{
+    object->optimize_stats = stats;
+}
+
+void
+yasm_object_set_size_hints(yasm_object *object, yasm_size_hints *hints)
+{
+    object->size_hints = hints;
+}
+
 int
 yasm_section_is_code(yasm_section *sect)
 {
@@ -463,7 +510,10 @@ yasm_object_destroy(yasm_object *object)
     if (object->dbgfmt)
         yasm_dbgfmt_destroy(object->dbgfmt);
 
-    /* Delete sections */
+    /* Delete section name index (it doesn't own the sections), then
+     * sections
+     */
+    HAMT_destroy(object->section_names, section_name_delete);
     cur = STAILQ_FIRST(&object->sections);
     while (cur) {
         next = STAILQ_NEXT(cur, link);
@@ -508,11 +558,282 @@ yasm_object_print(const yasm_object *object, FILE *f, int indent_level)
     }
 }
 
+#ifdef YASM_THREADS
+/* Number of bytecodes handed to a finalize thread at a time */
+#define FINALIZE_CHUNK_SIZE     64
+
+/* A bytecode the serial pass of object_finalize_threads() has to visit. */
+typedef struct finalize_item {
+    /*@dependent@*/ yasm_bytecode *bc;
+
+    /* Preceding bytecode if bc is left to the serial pass to finalize, NULL
+     * if it was finalized by a thread and left error or warning indicators.
+     */
+    /*@dependent@*/ /*@null@*/ yasm_bytecode *prev;
+    /*@only@*/ /*@null@*/ yasm_errwarn_saved *saved;
+} finalize_item;
+
+/* A run of bytecodes in one section.  Runs with instructions in them are
+ * finalized by a single thread; the others are left to the serial pass.
+ */
+typedef struct finalize_chunk {
+    /*@owned@*/ /*@null@*/ struct finalize_chunk *next;
+    /*@dependent@*/ /*@null@*/ struct finalize_chunk *next_queued;
+
+    /*@dependent@*/ yasm_bytecode *prev;    /* bytecode before the first */
+    unsigned int num_bcs;
+    int queued;                     /* nonzero if given to the threads */
+
+    /* Filled in by the thread, in bytecode order */
+    /*@only@*/ /*@null@*/ finalize_item *items;
+    unsigned int num_items;
+} finalize_chunk;
+
+typedef struct finalize_pool {
+    pthread_mutex_t mutex;          /* protects the rest */
+    pthread_cond_t cond;            /* signaled when a chunk is queued */
+
+    /* First queued chunk not yet taken by a thread */
+    /*@dependent@*/ /*@null@*/ finalize_chunk *next_chunk;
+    int all_queued;                 /* nonzero once all chunks are queued */
+    unsigned int num_waiting;       /* threads waiting for a chunk */
+
+    /* Expression nodes created by the threads started (for statistics) */
+    unsigned long num_exprs;
+} finalize_pool;
+
+/* Nonzero if a bytecode can be finalized by any thread.  This is the case
+ * for instructions: finalizing one only reads shared data, except for
+ * symbols it may create, and symbol table locks those.  Everything else,
+ * including instructions with a TIMES multiple, is left to the serial pass.
+ */
+static int
+finalize_on_any_thread(const yasm_bytecode *bc)
+{
+    return bc->callback && bc->callback->special == YASM_BC_SPECIAL_INSN &&
+        !bc->multiple;
+}
+
+/* Take chunks as they are queued, and finalize the bytecodes in them that
+ * can be, until all chunks are taken.
+ */
+static void
+finalize_pool_run(finalize_pool *pool)
+{
+    finalize_item items[FINALIZE_CHUNK_SIZE];
+
+    for (;;) {
+        finalize_chunk *chunk;
+        yasm_bytecode *prev, *cur;
+        unsigned int i, num_items = 0;
+
+        pthread_mutex_lock(&pool->mutex);
+        while (!pool->next_chunk && !pool->all_queued) {
+            pool->num_waiting++;
+            pthread_cond_wait(&pool->cond, &pool->mutex);
+            pool->num_waiting--;
+        }
+        chunk = pool->next_chunk;
+        if (chunk)
+            pool->next_chunk = chunk->next_queued;
+        pthread_mutex_unlock(&pool->mutex);
+        if (!chunk)
+            return;
+
+        prev = chunk->prev;
+        cur = STAILQ_NEXT(prev, link);
+        for (i=0; i<chunk->num_bcs; i++) {
+            finalize_item *item = &items[num_items];
+
+            if (!finalize_on_any_thread(cur)) {
+                item->bc = cur;
+                item->prev = prev;
+                item->saved = NULL;
+                num_items++;
+            } else {
+                yasm_bc_finalize(cur, prev);
+                item->saved = yasm_errwarn_save();
+                if (item->saved) {
+                    item->bc = cur;
+                    item->prev = NULL;
+                    num_items++;
+                }
+            }
+            prev = cur;
+            cur = STAILQ_NEXT(cur, link);
+        }
+
+        if (num_items > 0) {
+            chunk->items = yasm_xmalloc(num_items*sizeof(finalize_item));
+            memcpy(chunk->items, items, num_items*sizeof(finalize_item));
+        }
+        chunk->num_items = num_items;
+    }
+}
+
+static /*@null@*/ void *
+finalize_thread(void *d)
+{
+    finalize_pool *pool = d;
+
+    yasm_intnum_thread_initialize();
+    yasm_floatnum_thread_initialize();
+    finalize_pool_run(pool);
+    yasm_floatnum_thread_cleanup();
+    yasm_intnum_thread_cleanup();
+
+    pthread_mutex_lock(&pool->mutex);
+    pool->num_exprs += yasm_expr_get_num_created();
+    pthread_mutex_unlock(&pool->mutex);
+    return NULL;
+}
+
+/* Append a chunk of bytecodes to a list, and queue it for the threads of a
+ * pool if it has instructions.
+ */
+static void
+finalize_pool_add(finalize_pool *pool, finalize_chunk ***tail,
+                  finalize_chunk **last_queued, yasm_bytecode *prev,
+                  unsigned int num_bcs, int queue)
+{
+    finalize_chunk *chunk = yasm_xmalloc(sizeof(finalize_chunk));
+
+    chunk->next = NULL;
+    chunk->next_queued = NULL;
+    chunk->prev = prev;
+    chunk->num_bcs = num_bcs;
+    chunk->queued = queue;
+    chunk->items = NULL;
+    chunk->num_items = 0;
+    **tail = chunk;
+    *tail = &chunk->next;
+
+    if (queue) {
+        pthread_mutex_lock(&pool->mutex);
+        if (*last_queued)
+            (*last_queued)->next_queued = chunk;
+        if (!pool->next_chunk)
+            pool->next_chunk = chunk;
+        if (pool->num_waiting > 0)
+            pthread_cond_signal(&pool->cond);
+        pthread_mutex_unlock(&pool->mutex);
+        *last_queued = chunk;
+    }
+}
+
+/* Finalize the instructions on the threads of a pool while the bytecodes
+ * are split into chunks for them, then go through the bytecodes the threads
+ * left in order: finalize those not finalized yet, and propagate the errors
+ * and warnings of each as the serial loop would.
+ */
+static void
+object_finalize_threads(yasm_object *object, yasm_errwarns *errwarns)
+{
+    finalize_pool pool;
+    /*@only@*/ pthread_t *threads;
+    unsigned int num_started, i;
+    int equ_caching;
+    /*@null@*/ finalize_chunk *chunks = NULL, **tail = &chunks;
+    /*@null@*/ finalize_chunk *last_queued = NULL;
+    yasm_section *sect;
+
+    pool.next_chunk = NULL;
+    pool.all_queued = 0;
+    pool.num_waiting = 0;
+    pool.num_exprs = 0;
+    pthread_mutex_init(&pool.mutex, NULL);
+    pthread_cond_init(&pool.cond, NULL);
+
+    /* This thread takes chunks as well, once they are all queued.  If a
+     * thread can't be started, go on with the ones that were.
+     */
+    threads = yasm_xmalloc(object->finalize_threads*sizeof(pthread_t));
+    equ_caching = yasm_expr_set_equ_caching(0);
+    for (num_started=0; num_started+1<object->finalize_threads;
+         num_started++) {
+        if (pthread_create(&threads[num_started], NULL, finalize_thread,
+                           &pool) != 0)
+            break;
+    }
+
+    STAILQ_FOREACH(sect, &object->sections, link) {
+        yasm_bytecode *prev = STAILQ_FIRST(&sect->bcs);
+        yasm_bytecode *first = prev;
+        yasm_bytecode *cur = STAILQ_NEXT(prev, link);
+        unsigned int num_bcs = 0;
+        int queue = 0;
+
+        for (; cur; prev = cur, cur = STAILQ_NEXT(cur, link)) {
+            if (num_bcs == FINALIZE_CHUNK_SIZE) {
+                finalize_pool_add(&pool, &tail, &last_queued, first, num_bcs,
+                                  queue);
+                first = prev;
+                num_bcs = 0;
+                queue = 0;
+            }
+            num_bcs++;
+            queue |= finalize_on_any_thread(cur);
+        }
+        if (num_bcs > 0)
+            finalize_pool_add(&pool, &tail, &last_queued, first, num_bcs,
+                              queue);
+    }
+    pthread_mutex_lock(&pool.mutex);
+    pool.all_queued = 1;
+    pthread_cond_broadcast(&pool.cond);
+    pthread_mutex_unlock(&pool.mutex);
+
+    finalize_pool_run(&pool);
+    for (i=0; i<num_started; i++)
+        pthread_join(threads[i], NULL);
+    yasm_xfree(threads);
+    yasm_expr_set_equ_caching(equ_caching);
+    yasm_expr_add_num_created(pool.num_exprs);
+    pthread_cond_destroy(&pool.cond);
+    pthread_mutex_destroy(&pool.mutex);
+
+    while (chunks) {
+        finalize_chunk *chunk = chunks;
+
+        if (!chunk->queued) {
+            yasm_bytecode *prev = chunk->prev;
+            yasm_bytecode *cur = STAILQ_NEXT(prev, link);
+
+            for (i=0; i<chunk->num_bcs; i++) {
+                yasm_bc_finalize(cur, prev);
+                yasm_errwarn_propagate(errwarns, cur->line);
+                prev = cur;
+                cur = STAILQ_NEXT(cur, link);
+            }
+        }
+        for (i=0; i<chunk->num_items; i++) {
+            finalize_item *item = &chunk->items[i];
+            if (item->prev)
+                yasm_bc_finalize(item->bc, item->prev);
+            else
+                yasm_errwarn_restore(item->saved);
+            yasm_errwarn_propagate(errwarns, item->bc->line);
+        }
+        chunks = chunk->next;
+        if (chunk->items)
+            yasm_xfree(chunk->items);
+        yasm_xfree(chunk);
+    }
+}
+#endif
+
 void
 yasm_object_finalize(yasm_object *object, yasm_errwarns *errwarns)
 {
     yasm_section *sect;
 
+#ifdef YASM_THREADS
+    if (object->finalize_threads > 1) {
+        object_finalize_threads(object, errwarns);
+        return;
+    }
+#endif
+
     /* Iterate through sections */
     STAILQ_FOREACH(sect, &object->sections, link) {
         yasm_bytecode *cur = STAILQ_FIRST(&sect->bcs);
@@ -552,13 +873,7 @@ yasm_object_sections_traverse(yasm_object *object, /*@null@*/ void *d,
 yasm_section *
 yasm_object_find_general(yasm_object *object, const char *name)
 {
-    yasm_section *cur;
-
-    STAILQ_FOREACH(cur, &object->sections, link) {
-        if (strcmp(cur->name, name) == 0)
-            return cur;
-    }
-    return NULL;
+    return HAMT_search(object->section_names, name);
 }
 /*@=onlytrans@*/
 
@@ -644,6 +959,62 @@ yasm_section_bcs_traverse(yasm_section *sect,
     return 0;
 }
 
+unsigned long
+yasm_section_get_size(yasm_section *sect)
+{
+    return yasm_bc_next_offset(STAILQ_LAST(&sect->bcs, yasm_bytecode, link));
+}
+
+unsigned char *
+yasm_section_tobytes(yasm_section *sect, /*@null@*/ yasm_errwarns *errwarns,
+                     unsigned long *size, void *d,
+                     yasm_output_value_func output_value,
+                     /*@null@*/ yasm_output_reloc_func output_reloc)
+{
+    yasm_outbuf ob;
+    yasm_bytecode *cur = STAILQ_FIRST(&sect->bcs);
+    int gap;
+
+    *size = yasm_section_get_size(sect);
+    if (*size == 0)
+        return NULL;
+
+    /* Size the buffer up front so it never needs to grow */
+    yasm_outbuf_initialize(&ob, NULL);
+    yasm_outbuf_reserve(&ob, *size);
+
+    /* Skip our locally created empty bytecode first. */
+    cur = STAILQ_NEXT(cur, link);
+
+    /* Iterate through the remainder, if any. */
+    while (cur) {
+        yasm_bc_tobytes_outbuf(cur, &ob, &gap, d, output_value, output_reloc);
+        if (gap)
+            yasm_warn_set(YASM_WARN_UNINIT_CONTENTS,
+                N_("uninitialized space declared in code/data section: zeroing"));
+        if (errwarns)
+            yasm_errwarn_propagate(errwarns, cur->line);
+        cur = STAILQ_NEXT(cur, link);
+    }
+
+    if (ob.len > *size) {
+        /* Also possible if errors occurred (a multiple that turned out
+         * negative shortens the optimized length); output is discarded
+         * in that case.
+         */
+        if (!errwarns || yasm_errwarns_num_errors(errwarns, 0) == 0)
+            yasm_internal_error(
+                N_("section contents exceed optimized section length"));
+        ob.len = *size;
+    }
+
+    /* Only possible if errors occurred (a bytecode produced no output) */
+    if (ob.len < *size)
+        memset(ob.buf + ob.len, 0, *size - ob.len);
+
+    return ob.buf;
+}
+
 const char *
 yasm_section_get_name(const yasm_section *sect)
 {
@@ -876,6 +1247,53 @@ struct yasm_span {
     yasm_offset_setter *os;
 };
 
+/* Compact, bc_index-ordered copy of the bytecode fields the offset passes
+ * need.  Walking these arrays touches far less memory than chasing the
+ * bytecode lists (each yasm_bytecode is mostly fields the optimizer doesn't
+ * look at).  len and mult must be refreshed with optimize_layout_update()
+ * whenever a bytecode is expanded.
+ */
+typedef struct optimize_layout {
+    /*@only@*/ yasm_bytecode **bcs;
+    /*@only@*/ unsigned long *len;
+    /*@only@*/ long *mult;
+    /*@only@*/ unsigned char *special;  /* nonzero for offset-based bcs */
+    /* Set at the index of a section's first bytecode if the section has
+     * offset setters or bytecodes of general spans, or if a general span
+     * depends on the position of any of its bytecodes.
+     */
+    /*@only@*/ unsigned char *general;
+    unsigned long num, alloc;
+} optimize_layout;
+
+/* A span whose value is just the distance from its bytecode to a label in
+ * the same section (e.g. a relative jump).  In a section no general span
+ * depends on or changes and that has no offset setters, the distances of
+ * these only grow as bytecodes expand, so their final lengths don't depend
+ * on the order of expansion; they are relaxed by optimize_jumps() instead of
+ * going through the interval tree.  Jumps in other sections are turned back
+ * into general spans.
+ */
+typedef struct optimize_jump {
+    /*@dependent@*/ yasm_bytecode *bc;
+    /*@dependent@*/ yasm_bytecode *target;  /* bytecode preceding label */
+    /*@dependent@*/ yasm_symrec *sym;       /* label */
+
+    /* General span created just before this one (to keep span order if
+     * turned back into a general span), and following offset setter.
+     */
+    /*@dependent@*/ /*@null@*/ yasm_span *prev;
+    /*@dependent@*/ yasm_offset_setter *os;
+
+    long cur_val;
+    long neg_thres;
+    long pos_thres;
+    int id;
+
+    int active;     /* may still need expanding */
+    int queued;     /* in optimize_jumps() worklist */
+} optimize_jump;
+
 typedef struct optimize_data {
     /*@reldef@*/ TAILQ_HEAD(yasm_span_head, yasm_span) spans;
     /*@reldef@*/ STAILQ_HEAD(yasm_span_shead, yasm_span) QA, QB;
@@ -885,8 +1303,74 @@ typedef struct optimize_data {
     long len_diff;      /* used only for optimize_term_expand */
     yasm_span *span;    /* used only for check_cycle */
     yasm_offset_setter *os;
+    optimize_layout layout;
+
+    /*@only@*/ /*@null@*/ optimize_jump *jumps;
+    unsigned long num_jumps, alloc_jumps;
+    int all_general;    /* turn all jumps into general spans */
+    int times_spans;    /* any span-dependent TIMES (span ID 0) */
+    int equ_depth;      /* used only for optimize_mark_item */
+
+    /* Size hints (NULL if none), and the hint key of each bytecode with
+     * spans (by bc_index).
+     */
+    /*@null@*/ /*@dependent@*/ yasm_size_hints *hints;
+    /*@only@*/ /*@null@*/ unsigned long *hint_keys;
+    unsigned long alloc_hint_keys;
+
+    /* Statistics, copied out to stats (if non-NULL) at cleanup */
+    /*@null@*/ /*@dependent@*/ yasm_optimize_stats *stats;
+    unsigned long num_spans, num_itree_nodes, num_expansions, num_iterations;
+    unsigned long num_hinted;
 } optimize_data;
 
+/* Record an expansion in the size hints. */
+#define optimize_hint_record(optd, bc, id, val) do { \
+        if ((optd)->hints && (id) >= 0) \
+            yasm_size_hints_set((optd)->hints, \
+                                (optd)->hint_keys[(bc)->bc_index], id, val); \
+    } while (0)
+
+#define optimize_step(optd, name) do { \
+        if ((optd)->stats && (optd)->stats->step) \
+            (optd)->stats->step((optd)->stats->d, name); \
+    } while (0)
+
+static void
+optimize_layout_add(optimize_layout *layout, yasm_bytecode *bc)
+{
+    unsigned long i = bc->bc_index;
+
+    if (i >= layout->alloc) {
+        layout->alloc = layout->alloc ? layout->alloc*2 : 1024;
+        layout->bcs = yasm_xrealloc(layout->bcs,
+                                    layout->alloc*sizeof(yasm_bytecode *));
+        layout->len = yasm_xrealloc(layout->len,
+                                    layout->alloc*sizeof(unsigned long));
+        layout->mult = yasm_xrealloc(layout->mult,
+                                     layout->alloc*sizeof(long));
+        layout->special = yasm_xrealloc(layout->special, layout->alloc);
+        layout->general = yasm_xrealloc(layout->general, layout->alloc);
+    }
+    layout->bcs[i] = bc;
+    layout->len[i] = bc->len;
+    layout->mult[i] = bc->mult_int;
+    layout->special[i] =
+        (bc->callback && bc->callback->special == YASM_BC_SPECIAL_OFFSET);
+    layout->general[i] = 0;
+    layout->num = i+1;
+}
+
+#define optimize_mark_general(layout, sect) \
+    ((layout)->general[STAILQ_FIRST(&(sect)->bcs)->bc_index] = 1)
+#define optimize_is_general(layout, sect) \
+    ((layout)->general[STAILQ_FIRST(&(sect)->bcs)->bc_index])
+
+#define optimize_layout_update(layout, bc) do { \
+        (layout)->len[(bc)->bc_index] = (bc)->len; \
+        (layout)->mult[(bc)->bc_index] = (bc)->mult_int; \
+    } while (0)
+
 static yasm_span *
 create_span(yasm_bytecode *bc, int id, /*@null@*/ const yasm_value *value, 
             long neg_thres, long pos_thres, yasm_offset_setter *os)
@@ -921,6 +1405,38 @@ optimize_add_span(void *add_span_data, yasm_bytecode *bc, int id,
 {
     optimize_data *optd = (optimize_data *)add_span_data;
     yasm_span *span;
+    yasm_bytecode *target;
+
+    optd->num_spans++;
+    if (id <= 0)
+        optd->times_spans = 1;
+
+    if (id > 0 && value && !value->abs && value->rel && value->curpos_rel
+        && !value->wrt && !value->seg_of && !value->section_rel
+        && !value->rshift && !value->ip_rel
+        && yasm_symrec_get_label(value->rel, &target)
+        && target->section == bc->section) {
+        optimize_jump *jump;
+
+        if (optd->num_jumps >= optd->alloc_jumps) {
+            optd->alloc_jumps = optd->alloc_jumps ? optd->alloc_jumps*2 : 256;
+            optd->jumps =
+                yasm_xrealloc(optd->jumps,
+                              optd->alloc_jumps*sizeof(optimize_jump));
+        }
+        jump = &optd->jumps[optd->num_jumps++];
+        jump->bc = bc;
+        jump->target = target;
+        jump->sym = value->rel;
+        jump->prev = TAILQ_LAST(&optd->spans, yasm_span_head);
+        jump->os = optd->os;
+        jump->cur_val = 0;
+        jump->neg_thres = neg_thres;
+        jump->pos_thres = pos_thres;
+        jump->id = id;
+        return;
+    }
+
     span = create_span(bc, id, value, neg_thres, pos_thres, optd->os);
     TAILQ_INSERT_TAIL(&optd->spans, span, link);
 }
@@ -930,7 +1446,7 @@ add_span_term(unsigned int subst, yasm_bytecode *precbc,
               yasm_bytecode *precbc2, void *d)
 {
     yasm_span *span = d;
-    yasm_intnum *intn;
+    long dist;
 
     if (subst >= span->num_terms) {
         /* Linear expansion since total number is essentially always small */
@@ -943,12 +1459,10 @@ add_span_term(unsigned int subst, yasm_bytecode *precbc,
     span->terms[subst].span = span;
     span->terms[subst].subst = subst;
 
-    intn = yasm_calc_bc_dist(precbc, precbc2);
-    if (!intn)
+    if (!yasm_calc_bc_dist_long(precbc, precbc2, &dist))
         yasm_internal_error(N_("could not calculate bc distance"));
     span->terms[subst].cur_val = 0;
-    span->terms[subst].new_val = yasm_intnum_get_int(intn);
-    yasm_intnum_destroy(intn);
+    span->terms[subst].new_val = dist;
 }
 
 static void
@@ -1054,38 +1568,37 @@ recalc_normal_span(yasm_span *span)
  * to determine new length.
  */
 static int
-update_all_bc_offsets(yasm_object *object, yasm_errwarns *errwarns)
+update_all_bc_offsets(yasm_object *object, optimize_layout *layout,
+                      yasm_errwarns *errwarns)
 {
     yasm_section *sect;
     int saw_error = 0;
 
     STAILQ_FOREACH(sect, &object->sections, link) {
         unsigned long offset = 0;
+        unsigned long i = STAILQ_FIRST(&sect->bcs)->bc_index;
+        unsigned long end = yasm_section_bcs_last(sect)->bc_index;
 
-        yasm_bytecode *bc = STAILQ_FIRST(&sect->bcs);
-        yasm_bytecode *prevbc;
-
-        /* Skip our locally created empty bytecode first. */
-        prevbc = bc;
-        bc = STAILQ_NEXT(bc, link);
+        /* Skip our locally created empty bytecode first, and iterate
+         * through the remainder, if any.  The running offset is always the
+         * next offset of the previous bytecode.
+         */
+        for (i++; i <= end; i++) {
+            yasm_bytecode *bc = layout->bcs[i];
 
-        /* Iterate through the remainder, if any. */
-        while (bc) {
-            if (bc->callback->special == YASM_BC_SPECIAL_OFFSET) {
+            if (layout->special[i]) {
                 /* Recalculate/adjust len of offset-based bytecodes here */
                 long neg_thres = 0;
                 long pos_thres = (long)yasm_bc_next_offset(bc);
-                int retval = yasm_bc_expand(bc, 1, 0,
-                                            (long)yasm_bc_next_offset(prevbc),
+                int retval = yasm_bc_expand(bc, 1, 0, (long)offset,
                                             &neg_thres, &pos_thres);
                 yasm_errwarn_propagate(errwarns, bc->line);
                 if (retval < 0)
                     saw_error = 1;
+                optimize_layout_update(layout, bc);
             }
             bc->offset = offset;
-            offset += bc->len*bc->mult_int;
-            prevbc = bc;
-            bc = STAILQ_NEXT(bc, link);
+            offset += layout->len[i]*layout->mult[i];
         }
     }
     return saw_error;
@@ -1132,10 +1645,33 @@ optimize_cleanup(optimize_data *optd)
         yasm_xfree(os1);
         os1 = os2;
     }
+
+    if (optd->stats) {
+        optd->stats->bytecodes = optd->layout.num;
+        optd->stats->spans = optd->num_spans;
+        optd->stats->itree_nodes = optd->num_itree_nodes;
+        optd->stats->expansions = optd->num_expansions;
+        optd->stats->iterations = optd->num_iterations;
+        optd->stats->hinted = optd->num_hinted;
+    }
+    optimize_step(optd, NULL);
+
+    if (optd->layout.bcs) {
+        yasm_xfree(optd->layout.bcs);
+        yasm_xfree(optd->layout.len);
+        yasm_xfree(optd->layout.mult);
+        yasm_xfree(optd->layout.special);
+        yasm_xfree(optd->layout.general);
+    }
+    if (optd->jumps)
+        yasm_xfree(optd->jumps);
+    if (optd->hint_keys)
+        yasm_xfree(optd->hint_keys);
 }
 
 static void
-optimize_itree_add(IntervalTree *itree, yasm_span *span, yasm_span_term *term)
+optimize_itree_add(optimize_data *optd, yasm_span *span,
+                   yasm_span_term *term)
 {
     long precbc_index, precbc2_index;
     unsigned long low, high;
@@ -1160,7 +1696,8 @@ optimize_itree_add(IntervalTree *itree, yasm_span *span, yasm_span_term *term)
     } else
         return;     /* difference is same bc - always 0! */
 
-    IT_insert(itree, (long)low, (long)high, term);
+    IT_insert(optd->itree, (long)low, (long)high, term);
+    optd->num_itree_nodes++;
 }
 
 static void
@@ -1283,21 +1820,432 @@ optimize_term_expand(IntervalTreeNode *node, void *d)
     span->active = 2;       /* Mark as being in Q */
 }
 
-void
-yasm_object_optimize(yasm_object *object, yasm_errwarns *errwarns)
+static int
+optimize_mark_item(const yasm_expr__item *ei, void *d)
 {
-    yasm_section *sect;
-    unsigned long bc_index = 0;
+    optimize_data *optd = d;
+    yasm_bytecode *precbc;
+    const yasm_expr *equ;
+    int retval;
+
+    if (ei->type == YASM_EXPR_PRECBC)
+        optimize_mark_general(&optd->layout, ei->data.precbc->section);
+    else if (ei->type == YASM_EXPR_SYM) {
+        if (yasm_symrec_get_label(ei->data.sym, &precbc))
+            optimize_mark_general(&optd->layout, precbc->section);
+        else if ((equ = yasm_symrec_get_equ(ei->data.sym))) {
+            /* EQUs get expanded when span terms are created */
+            if (optd->equ_depth >= 16) {
+                optd->all_general = 1;
+                return 1;
+            }
+            optd->equ_depth++;
+            retval = yasm_expr__traverse_leaves_in_const(equ, d,
+                                                         optimize_mark_item);
+            optd->equ_depth--;
+            return retval;
+        }
+    }
+    return 0;
+}
+
+static void
+optimize_mark_sym(optimize_data *optd, /*@null@*/ yasm_symrec *sym)
+{
+    yasm_expr__item item;
+
+    if (!sym)
+        return;
+    item.type = YASM_EXPR_SYM;
+    item.data.sym = sym;
+    optimize_mark_item(&item, optd);
+}
+
+/* Find the sections whose bytecodes general spans and offset setters depend
+ * on or change, and turn the jumps in those back into general spans, in the
+ * order they were created.
+ */
+static void
+optimize_split_jumps(optimize_data *optd)
+{
+    yasm_span *span;
+    yasm_offset_setter *os;
+    optimize_jump *jump;
+    unsigned long i, num;
+
+    if (optd->num_jumps == 0)
+        return;
+
+    TAILQ_FOREACH(span, &optd->spans, link) {
+        optimize_mark_general(&optd->layout, span->bc->section);
+        optimize_mark_sym(optd, span->depval.rel);
+        optimize_mark_sym(optd, span->depval.wrt);
+        if (span->depval.abs)
+            yasm_expr__traverse_leaves_in_const(span->depval.abs, optd,
+                                                optimize_mark_item);
+    }
+    STAILQ_FOREACH(os, &optd->offset_setters, link) {
+        if (os->bc)
+            optimize_mark_general(&optd->layout, os->bc->section);
+    }
+
+    /* Later jumps with the same prev must be inserted first. */
+    i = optd->num_jumps;
+    while (i-- > 0) {
+        jump = &optd->jumps[i];
+        if (!optd->all_general &&
+            !optimize_is_general(&optd->layout, jump->bc->section))
+            continue;
+        span = create_span(jump->bc, jump->id, NULL, jump->neg_thres,
+                           jump->pos_thres, jump->os);
+        span->depval.rel = jump->sym;
+        span->depval.curpos_rel = 1;
+        if (jump->prev)
+            TAILQ_INSERT_AFTER(&optd->spans, jump->prev, span, link);
+        else
+            TAILQ_INSERT_HEAD(&optd->spans, span, link);
+        jump->bc = NULL;
+    }
+
+    num = 0;
+    for (i=0; i<optd->num_jumps; i++) {
+        if (optd->jumps[i].bc)
+            optd->jumps[num++] = optd->jumps[i];
+    }
+    optd->num_jumps = num;
+}
+
+/* Fenwick tree over total bytecode lengths (len*mult), by bc_index. */
+static long
+optimize_fenwick_sum(const long *fen, unsigned long i)
+{
+    long sum = 0;
+    while (i > 0) {
+        sum += fen[i];
+        i &= i-1;
+    }
+    return sum;
+}
+
+static void
+optimize_fenwick_add(long *fen, unsigned long num, unsigned long i,
+                     long diff)
+{
+    for (i++; i <= num; i += i & (0-i))
+        fen[i] += diff;
+}
+
+/* Worklist of jumps for optimize_jumps(): jumps still to be checked, in a
+ * circular buffer (each jump is in it at most once).
+ */
+typedef struct optimize_jump_queue {
+    /*@only@*/ optimize_jump **q;
+    unsigned long head, len, size;
+} optimize_jump_queue;
+
+static void
+optimize_jump_enqueue(IntervalTreeNode *node, void *d)
+{
+    optimize_jump_queue *queue = (optimize_jump_queue *)d;
+    optimize_jump *jump = node->data;
+
+    if (!jump->active || jump->queued)
+        return;
+    jump->queued = 1;
+    queue->q[(queue->head + queue->len++) % queue->size] = jump;
+}
+
+/* Expand jump while its distance (from the current lengths) is beyond its
+ * thresholds.  Returns how much the jump bytecode grew.
+ */
+static long
+optimize_jump_relax(optimize_data *optd, long *fen, optimize_jump *jump,
+                    yasm_errwarns *errwarns, int *saw_error)
+{
+    optimize_layout *layout = &optd->layout;
+    yasm_bytecode *bc = jump->bc;
+    long new_val, orig_len, len_diff, total_diff = 0;
+    int retval;
+
+    while (jump->active) {
+        new_val = optimize_fenwick_sum(fen, jump->target->bc_index+1) -
+            optimize_fenwick_sum(fen, bc->bc_index);
+        if (new_val >= jump->neg_thres && new_val <= jump->pos_thres)
+            break;
+
+        orig_len = (long)bc->len*bc->mult_int;
+        retval = yasm_bc_expand(bc, jump->id, jump->cur_val, new_val,
+                                &jump->neg_thres, &jump->pos_thres);
+        yasm_errwarn_propagate(errwarns, bc->line);
+        optimize_layout_update(layout, bc);
+        optimize_hint_record(optd, bc, jump->id, new_val);
+        optd->num_expansions++;
+        if (retval < 0)
+            *saw_error = 1;
+        if (retval > 0)
+            jump->cur_val = new_val;    /* another threshold, keep active */
+        else
+            jump->active = 0;
+
+        len_diff = (long)bc->len*bc->mult_int - orig_len;
+        if (len_diff != 0) {
+            optimize_fenwick_add(fen, layout->num, bc->bc_index, len_diff);
+            total_diff += len_diff;
+        }
+    }
+    return total_diff;
+}
+
+/* Full passes optimize_jumps() makes before it may switch to a worklist */
+#define OPTIMIZE_JUMPS_MIN_PASSES   8
+
+/* Relax the jumps left after optimize_split_jumps(): expand every jump whose
+ * distance (from the current lengths) is beyond its thresholds until none
+ * is.  Distances only grow, so each expansion is one the final layout needs
+ * and the result is the same as the general algorithm's, whatever the order.
+ *
+ * Passes over all jumps are made while each expands a good part of them,
+ * and at least OPTIMIZE_JUMPS_MIN_PASSES times (enough for most code).  After
+ * that, if a pass expands only a few (e.g. in a chain of jumps that each push
+ * the previous one out of range), only the jumps spanning a bytecode that
+ * grew are checked again, found with an interval tree.  Returns nonzero on
+ * error.
+ */
+static int
+optimize_jumps(optimize_data *optd, yasm_errwarns *errwarns)
+{
+    optimize_layout *layout = &optd->layout;
+    long *fen;
+    unsigned long i, j, num, checked, parent, num_grown, round_left = 0;
+    unsigned long passes = 0;
+    /*@only@*/ unsigned long *grown;
+    /*@only@*/ IntervalTree *itree;
+    optimize_jump_queue queue;
     int saw_error = 0;
-    optimize_data optd;
+
+    if (optd->num_jumps == 0)
+        return 0;
+
+    /* Build in linear time: push each node's sum up to its parent. */
+    fen = yasm_xmalloc((layout->num+1)*sizeof(long));
+    fen[0] = 0;
+    for (i=1; i<=layout->num; i++)
+        fen[i] = (long)layout->len[i-1]*layout->mult[i-1];
+    for (i=1; i<=layout->num; i++) {
+        parent = i + (i & (0-i));
+        if (parent <= layout->num)
+            fen[parent] += fen[i];
+    }
+
+    /* Full passes, dropping the jumps that can't expand any further and
+     * noting the bytecodes that grew in the last pass.
+     */
+    grown = yasm_xmalloc(optd->num_jumps*sizeof(unsigned long));
+    for (i=0; i<optd->num_jumps; i++)
+        optd->jumps[i].active = 1;
+    num = optd->num_jumps;
+    do {
+        num_grown = 0;
+        j = 0;
+        for (i=0; i<num; i++) {
+            optimize_jump *jump = &optd->jumps[i];
+
+            if (optimize_jump_relax(optd, fen, jump, errwarns,
+                                    &saw_error) != 0)
+                grown[num_grown++] = jump->bc->bc_index;
+            if (jump->active)
+                optd->jumps[j++] = *jump;
+        }
+        optd->num_iterations++;
+        passes++;
+        checked = num;
+        num = j;
+    } while (num_grown > 0 && num > 0 &&
+             (passes < OPTIMIZE_JUMPS_MIN_PASSES || num_grown >= checked/8));
+
+    if (num_grown == 0 || num == 0) {
+        yasm_xfree(grown);
+        yasm_xfree(fen);
+        return saw_error;
+    }
+
+    /* Recheck the jumps whose distance includes a grown bytecode: the
+     * bytecodes from the jump to its target (inclusive) for forward jumps,
+     * and those after the target up to the jump for backward ones.
+     */
+    itree = IT_create();
+    for (i=0; i<num; i++) {
+        optimize_jump *jump = &optd->jumps[i];
+        unsigned long jump_index = jump->bc->bc_index;
+        unsigned long target_index = jump->target->bc_index;
+
+        jump->queued = 0;
+        if (target_index >= jump_index)
+            IT_insert(itree, (long)jump_index, (long)target_index, jump);
+        else if (target_index+1 < jump_index)
+            IT_insert(itree, (long)target_index+1, (long)jump_index-1, jump);
+    }
+
+    queue.q = yasm_xmalloc(num*sizeof(optimize_jump *));
+    queue.head = 0;
+    queue.len = 0;
+    queue.size = num;
+    for (i=0; i<num_grown; i++)
+        IT_enumerate(itree, (long)grown[i], (long)grown[i], &queue,
+                     optimize_jump_enqueue);
+
+    while (queue.len > 0) {
+        optimize_jump *jump = queue.q[queue.head];
+        long len_diff;
+
+        /* Count the jumps queued by the previous round as one iteration */
+        if (round_left == 0) {
+            round_left = queue.len;
+            optd->num_iterations++;
+        }
+        round_left--;
+        queue.head = (queue.head+1) % queue.size;
+        queue.len--;
+        jump->queued = 0;
+
+        len_diff = optimize_jump_relax(optd, fen, jump, errwarns, &saw_error);
+        if (len_diff != 0)
+            IT_enumerate(itree, (long)jump->bc->bc_index,
+                         (long)jump->bc->bc_index, &queue,
+                         optimize_jump_enqueue);
+    }
+
+    yasm_xfree(queue.q);
+    IT_destroy(itree);
+    yasm_xfree(grown);
+    yasm_xfree(fen);
+    return saw_error;
+}
+
+/* Expand span id of bc as its size hint says, if there is one and it is out
+ * of the span's current thresholds.  Returns -1 if not expanded, otherwise
+ * whether the span is still needed (as yasm_bc_expand()).
+ */
+static int
+optimize_hint_expand(optimize_data *optd, yasm_bytecode *bc, int id,
+                     long *cur_val, long *neg_thres, long *pos_thres)
+{
+    unsigned long key = optd->hint_keys[bc->bc_index];
+    long val;
+    int retval;
+
+    if (!yasm_size_hints_get(optd->hints, key, id, &val)
+        || (val >= *neg_thres && val <= *pos_thres))
+        return -1;
+
+    retval = yasm_bc_expand(bc, id, *cur_val, val, neg_thres, pos_thres);
+    if (retval < 0) {
+        /* The hint is for something else (e.g. a jump since forced short);
+         * leave the span to the optimizer.  Expand functions don't change
+         * the bytecode when returning an error.
+         */
+        yasm_error_clear();
+        return -1;
+    }
+    optimize_layout_update(&optd->layout, bc);
+    yasm_size_hints_set(optd->hints, key, id, val);
+    optd->num_hinted++;
+    *cur_val = val;
+    return retval;
+}
+
+/* Give a bytecode just measured in step 1a its size hint key, if it added
+ * any spans.  first is the first general span it added (NULL if none) and
+ * first_jump the index of the first jump it added.
+ */
+static void
+optimize_hint_key(optimize_data *optd, yasm_bytecode *bc,
+                  /*@null@*/ yasm_span *first, unsigned long first_jump)
+{
+    if (!first && first_jump == optd->num_jumps)
+        return;
+
+    if (bc->bc_index >= optd->alloc_hint_keys) {
+        optd->alloc_hint_keys = optd->alloc_hint_keys ?
+            optd->alloc_hint_keys*2 : 1024;
+        if (optd->alloc_hint_keys <= bc->bc_index)
+            optd->alloc_hint_keys = bc->bc_index+1;
+        optd->hint_keys =
+            yasm_xrealloc(optd->hint_keys,
+                          optd->alloc_hint_keys*sizeof(unsigned long));
+    }
+    optd->hint_keys[bc->bc_index] = yasm_size_hints_key(optd->hints, bc->line);
+}
+
+/* Expand spans as their size hints say.  Done before step 1b, which then
+ * sees the same (minimum) offsets as without hints; hints from the same
+ * source name exactly the expansions the optimizer would end up with, so
+ * nothing else is expanded and the result is the same.  That doesn't hold
+ * with span-dependent TIMES, which can have more than one consistent
+ * length, the one found depending on the order of expansions; if there are
+ * any, only the hints for jumps in sections independent of the rest are
+ * used (their sizes don't depend on the order).  Hinted TIMES counts are
+ * only used by yasm_object_optimize_verify().
+ */
+static void
+optimize_apply_hints(optimize_data *optd)
+{
     yasm_span *span, *span_temp;
+    unsigned long i, j = 0;
+
+    for (i=0; i<optd->num_jumps; i++) {
+        optimize_jump *jump = &optd->jumps[i];
+        if (optimize_hint_expand(optd, jump->bc, jump->id, &jump->cur_val,
+                                 &jump->neg_thres, &jump->pos_thres) != 0)
+            optd->jumps[j++] = *jump;
+    }
+    optd->num_jumps = j;
+
+    if (optd->times_spans)
+        return;
+    TAILQ_FOREACH_SAFE(span, &optd->spans, link, span_temp) {
+        if (span->id > 0
+            && optimize_hint_expand(optd, span->bc, span->id, &span->cur_val,
+                                    &span->neg_thres, &span->pos_thres) == 0) {
+            TAILQ_REMOVE(&optd->spans, span, link);
+            span_destroy(span);
+        }
+    }
+}
+
+/* Set up optimizer data for object. */
+static void
+optimize_init(optimize_data *optd, yasm_object *object)
+{
     yasm_offset_setter *os;
-    int retval;
-    unsigned int i;
 
-    TAILQ_INIT(&optd.spans);
-    STAILQ_INIT(&optd.offset_setters);
-    optd.itree = IT_create();
+    TAILQ_INIT(&optd->spans);
+    STAILQ_INIT(&optd->offset_setters);
+    optd->itree = IT_create();
+    optd->layout.bcs = NULL;
+    optd->layout.len = NULL;
+    optd->layout.mult = NULL;
+    optd->layout.special = NULL;
+    optd->layout.general = NULL;
+    optd->layout.num = 0;
+    optd->layout.alloc = 0;
+    optd->stats = object->optimize_stats;
+    optd->num_spans = 0;
+    optd->num_itree_nodes = 0;
+    optd->num_expansions = 0;
+    optd->num_iterations = 0;
+    optd->jumps = NULL;
+    optd->num_jumps = 0;
+    optd->alloc_jumps = 0;
+    optd->all_general = 0;
+    optd->times_spans = 0;
+    optd->equ_depth = 0;
+    optd->hints = object->size_hints;
+    optd->hint_keys = NULL;
+    optd->alloc_hint_keys = 0;
+    optd->num_hinted = 0;
+    if (optd->hints)
+        yasm_size_hints_begin(optd->hints);
 
     /* Create an placeholder offset setter for spans to point to; this will
      * get updated if/when we actually run into one.
@@ -1307,10 +2255,24 @@ yasm_object_optimize(yasm_object *object, yasm_errwarns *errwarns)
     os->cur_val = 0;
     os->new_val = 0;
     os->thres = 0;
-    STAILQ_INSERT_TAIL(&optd.offset_setters, os, link);
-    optd.os = os;
+    STAILQ_INSERT_TAIL(&optd->offset_setters, os, link);
+    optd->os = os;
+}
 
-    /* Step 1a */
+/* Step 1a: number and measure all bytecodes, collecting their spans and the
+ * offset setters.  Returns nonzero if any bytecode had an error.
+ */
+static int
+optimize_measure(yasm_object *object, optimize_data *optd,
+                 yasm_errwarns *errwarns)
+{
+    yasm_section *sect;
+    unsigned long bc_index = 0;
+    int saw_error = 0;
+    yasm_offset_setter *os = optd->os;
+    int retval;
+
+    optimize_step(optd, "1a");
     STAILQ_FOREACH(sect, &object->sections, link) {
         unsigned long offset = 0;
 
@@ -1318,6 +2280,7 @@ yasm_object_optimize(yasm_object *object, yasm_errwarns *errwarns)
         yasm_bytecode *prevbc;
 
         bc->bc_index = bc_index++;
+        optimize_layout_add(&optd->layout, bc);
 
         /* Skip our locally created empty bytecode first. */
         prevbc = bc;
@@ -1325,14 +2288,22 @@ yasm_object_optimize(yasm_object *object, yasm_errwarns *errwarns)
 
         /* Iterate through the remainder, if any. */
         while (bc) {
+            yasm_span *last_span = TAILQ_LAST(&optd->spans, yasm_span_head);
+            unsigned long num_jumps = optd->num_jumps;
+
             bc->bc_index = bc_index++;
             bc->offset = offset;
 
-            retval = yasm_bc_calc_len(bc, optimize_add_span, &optd);
+            retval = yasm_bc_calc_len(bc, optimize_add_span, optd);
             yasm_errwarn_propagate(errwarns, bc->line);
             if (retval)
                 saw_error = 1;
             else {
+                if (optd->hints)
+                    optimize_hint_key(optd, bc, last_span ?
+                                      TAILQ_NEXT(last_span, link) :
+                                      TAILQ_FIRST(&optd->spans), num_jumps);
+
                 if (bc->callback->special == YASM_BC_SPECIAL_OFFSET) {
                     /* Remember it as offset setter */
                     os->bc = bc;
@@ -1344,8 +2315,8 @@ yasm_object_optimize(yasm_object *object, yasm_errwarns *errwarns)
                     os->cur_val = 0;
                     os->new_val = 0;
                     os->thres = 0;
-                    STAILQ_INSERT_TAIL(&optd.offset_setters, os, link);
-                    optd.os = os;
+                    STAILQ_INSERT_TAIL(&optd->offset_setters, os, link);
+                    optd->os = os;
 
                     if (bc->multiple) {
                         yasm_error_set(YASM_ERROR_VALUE,
@@ -1357,18 +2328,38 @@ yasm_object_optimize(yasm_object *object, yasm_errwarns *errwarns)
 
                 offset += bc->len*bc->mult_int;
             }
+            optimize_layout_add(&optd->layout, bc);
 
             prevbc = bc;
             bc = STAILQ_NEXT(bc, link);
         }
     }
+    return saw_error;
+}
 
-    if (saw_error) {
+void
+yasm_object_optimize(yasm_object *object, yasm_errwarns *errwarns)
+{
+    int saw_error = 0;
+    optimize_data optd;
+    yasm_span *span, *span_temp;
+    yasm_offset_setter *os;
+    int retval;
+    unsigned int i;
+
+    optimize_init(&optd, object);
+
+    /* Step 1a */
+    if (optimize_measure(object, &optd, errwarns)) {
         optimize_cleanup(&optd);
         return;
     }
 
     /* Step 1b */
+    optimize_step(&optd, "1b");
+    optimize_split_jumps(&optd);
+    if (optd.hints)
+        optimize_apply_hints(&optd);
     TAILQ_FOREACH_SAFE(span, &optd.spans, link, span_temp) {
         span_create_terms(span);
         if (yasm_error_occurred()) {
@@ -1379,6 +2370,9 @@ yasm_object_optimize(yasm_object *object, yasm_errwarns *errwarns)
                                     span->new_val, &span->neg_thres,
                                     &span->pos_thres);
             yasm_errwarn_propagate(errwarns, span->bc->line);
+            optimize_layout_update(&optd.layout, span->bc);
+            optimize_hint_record(&optd, span->bc, span->id, span->new_val);
+            optd.num_expansions++;
             if (retval < 0)
                 saw_error = 1;
             else if (retval > 0) {
@@ -1397,31 +2391,37 @@ yasm_object_optimize(yasm_object *object, yasm_errwarns *errwarns)
         span->cur_val = span->new_val;
     }
 
+    /* Jumps only depend on lengths in their own sections, which nothing
+     * above changed, so they can be finished here.
+     */
+    if (optimize_jumps(&optd, errwarns))
+        saw_error = 1;
+
     if (saw_error) {
         optimize_cleanup(&optd);
         return;
     }
 
     /* Step 1c */
-    if (update_all_bc_offsets(object, errwarns)) {
+    optimize_step(&optd, "1c");
+    if (update_all_bc_offsets(object, &optd.layout, errwarns)) {
         optimize_cleanup(&optd);
         return;
     }
 
     /* Step 1d */
+    optimize_step(&optd, "1d");
     STAILQ_INIT(&optd.QB);
     TAILQ_FOREACH(span, &optd.spans, link) {
-        yasm_intnum *intn;
+        long dist;
 
         /* Update span terms based on new bc offsets */
         for (i=0; i<span->num_terms; i++) {
-            intn = yasm_calc_bc_dist(span->terms[i].precbc,
-                                     span->terms[i].precbc2);
-            if (!intn)
+            if (!yasm_calc_bc_dist_long(span->terms[i].precbc,
+                                        span->terms[i].precbc2, &dist))
                 yasm_internal_error(N_("could not calculate bc distance"));
             span->terms[i].cur_val = span->terms[i].new_val;
-            span->terms[i].new_val = yasm_intnum_get_int(intn);
-            yasm_intnum_destroy(intn);
+            span->terms[i].new_val = dist;
         }
         if (span->rel_term) {
             span->rel_term->cur_val = span->rel_term->new_val;
@@ -1459,9 +2459,9 @@ yasm_object_optimize(yasm_object *object, yasm_errwarns *errwarns)
     /* Build up interval tree */
     TAILQ_FOREACH(span, &optd.spans, link) {
         for (i=0; i<span->num_terms; i++)
-            optimize_itree_add(optd.itree, span, &span->terms[i]);
+            optimize_itree_add(&optd, span, &span->terms[i]);
         if (span->rel_term)
-            optimize_itree_add(optd.itree, span, span->rel_term);
+            optimize_itree_add(&optd, span, span->rel_term);
     }
 
     /* Look for cycles in times expansion (span.id==0) */
@@ -1483,6 +2483,7 @@ yasm_object_optimize(yasm_object *object, yasm_errwarns *errwarns)
     }
 
     /* Step 2 */
+    optimize_step(&optd, "2");
     STAILQ_INIT(&optd.QA);
     while (!STAILQ_EMPTY(&optd.QA) || !(STAILQ_EMPTY(&optd.QB))) {
         unsigned long orig_len;
@@ -1499,6 +2500,7 @@ yasm_object_optimize(yasm_object *object, yasm_errwarns *errwarns)
             span = STAILQ_FIRST(&optd.QB);
             STAILQ_REMOVE_HEAD(&optd.QB, linkq);
         }
+        optd.num_iterations++;
 
         if (!span->active)
             continue;
@@ -1517,6 +2519,9 @@ yasm_object_optimize(yasm_object *object, yasm_errwarns *errwarns)
                                 span->new_val, &span->neg_thres,
                                 &span->pos_thres);
         yasm_errwarn_propagate(errwarns, span->bc->line);
+        optimize_layout_update(&optd.layout, span->bc);
+        optimize_hint_record(&optd, span->bc, span->id, span->new_val);
+        optd.num_expansions++;
 
         if (retval < 0) {
             /* error */
@@ -1561,6 +2566,8 @@ yasm_object_optimize(yasm_object *object, yasm_errwarns *errwarns)
                                     (long)os->new_val, &neg_thres_temp,
                                     (long *)&os->thres);
             yasm_errwarn_propagate(errwarns, os->bc->line);
+            optimize_layout_update(&optd.layout, os->bc);
+            optd.num_expansions++;
 
             offset_diff = os->new_val + os->bc->len - old_next_offset;
             optd.len_diff = os->bc->len - orig_len;
@@ -1579,6 +2586,114 @@ yasm_object_optimize(yasm_object *object, yasm_errwarns *errwarns)
     }
 
     /* Step 3 */
-    update_all_bc_offsets(object, errwarns);
+    optimize_step(&optd, "3");
+    update_all_bc_offsets(object, &optd.layout, errwarns);
+    optimize_cleanup(&optd);
+}
+
+/* Check a span value against the size chosen for it; used by
+ * yasm_object_optimize_verify().  Returns 1 (and sets an error) if it
+ * doesn't fit.
+ */
+static int
+optimize_verify_value(optimize_data *optd, yasm_bytecode *bc, int id,
+                      long val, long neg_thres, long pos_thres, long mult)
+{
+    long hint;
+
+    if (id <= 0) {
+        if (val == mult)
+            return 0;
+        yasm_error_set(YASM_ERROR_VALUE,
+                       N_("TIMES value %ld does not match laid out count %ld"),
+                       val, mult);
+        return 1;
+    }
+    if (val >= neg_thres && val <= pos_thres)
+        return 0;
+    if (optd->hints && yasm_size_hints_get(optd->hints,
+                                           optd->hint_keys[bc->bc_index], id,
+                                           &hint))
+        yasm_error_set(YASM_ERROR_VALUE,
+                       N_("value out of range for size from size hints"));
+    else
+        yasm_error_set(YASM_ERROR_VALUE,
+            N_("value out of range for shortest size (no size hint for it)"));
+    return 1;
+}
+
+int
+yasm_object_optimize_verify(yasm_object *object, yasm_errwarns *errwarns)
+{
+    optimize_data optd;
+    yasm_span *span, *span_temp;
+    unsigned long i, num_bad = 0;
+
+    optimize_init(&optd, object);
+    if (optimize_measure(object, &optd, errwarns)) {
+        optimize_cleanup(&optd);
+        return 0;
+    }
+
+    /* Take every size (including TIMES counts) from the hints; spans left
+     * without a hint stay in the shortest form step 1a gave them.
+     */
+    optimize_step(&optd, "verify");
+    if (optd.hints) {
+        for (i=0; i<optd.num_jumps; i++) {
+            optimize_jump *jump = &optd.jumps[i];
+            if (optimize_hint_expand(&optd, jump->bc, jump->id,
+                                     &jump->cur_val, &jump->neg_thres,
+                                     &jump->pos_thres) == 0)
+                jump->id = -1;  /* no longer has a span */
+        }
+        TAILQ_FOREACH_SAFE(span, &optd.spans, link, span_temp) {
+            if (optimize_hint_expand(&optd, span->bc, span->id,
+                                     &span->cur_val, &span->neg_thres,
+                                     &span->pos_thres) == 0) {
+                TAILQ_REMOVE(&optd.spans, span, link);
+                span_destroy(span);
+            }
+        }
+    }
+
+    /* Lay out once (align and org follow the offsets) and check each span
+     * once against the resulting offsets; nothing is expanded further.
+     */
+    if (update_all_bc_offsets(object, &optd.layout, errwarns)) {
+        optimize_cleanup(&optd);
+        return 0;
+    }
+
+    for (i=0; i<optd.num_jumps; i++) {
+        optimize_jump *jump = &optd.jumps[i];
+        if (jump->id < 0)
+            continue;
+        if (optimize_verify_value(&optd, jump->bc, jump->id,
+                                  (long)yasm_bc_next_offset(jump->target) -
+                                  (long)jump->bc->offset,
+                                  jump->neg_thres, jump->pos_thres, 0)) {
+            yasm_errwarn_propagate(errwarns, jump->bc->line);
+            num_bad++;
+        }
+    }
+
+    TAILQ_FOREACH(span, &optd.spans, link) {
+        span_create_terms(span);
+        if (yasm_error_occurred()) {
+            yasm_errwarn_propagate(errwarns, span->bc->line);
+            num_bad++;
+            continue;
+        }
+        recalc_normal_span(span);
+        if (optimize_verify_value(&optd, span->bc, span->id, span->new_val,
+                                  span->neg_thres, span->pos_thres,
+                                  span->bc->mult_int)) {
+            yasm_errwarn_propagate(errwarns, span->bc->line);
+            num_bad++;
+        }
+    }
+
     optimize_cleanup(&optd);
+    return (int)num_bad;
 }
@@ -34,6 +34,27 @@
 #define YASM_LIB_DECL
 #endif
 
+/** Optimizer statistics, filled in by yasm_object_optimize() (or
+ * yasm_object_optimize_verify()) when requested with
+ * yasm_object_set_optimize_stats().
+ */
+typedef struct yasm_optimize_stats {
+    /** Called (if non-NULL) at the start of each optimizer step with the
+     * step name ("1a", "1b", "1c", "1d", "2", "3", or "verify"), and with
+     * NULL when the optimizer returns.  Lets the caller time individual
+     * steps.
+     */
+    /*@null@*/ void (*step) (void *d, /*@null@*/ const char *name);
+    /*@null@*/ void *d;             /**< Data passed to step() */
+
+    unsigned long bytecodes;        /**< Bytecodes laid out */
+    unsigned long spans;            /**< Spans created */
+    unsigned long itree_nodes;      /**< Span terms added to interval tree */
+    unsigned long expansions;       /**< Span/org/align bytecode expansions */
+    unsigned long iterations;       /**< Step 2 span queue iterations */
+    unsigned long hinted;           /**< Expansions taken from size hints */
+} yasm_optimize_stats;
+
 /** Basic YASM relocation.  Object formats will need to extend this
  * structure with additional fields for relocation type, etc.
  */
@@ -63,6 +84,9 @@ struct yasm_object {
     /** Linked list of sections. */
     /*@reldef@*/ STAILQ_HEAD(yasm_sectionhead, yasm_section) sections;
 
+    /** Sections indexed by name (case-sensitive). */
+    /*@owned@*/ struct HAMT *section_names;
+
     /** Directives, organized as two level HAMT; first level is parser,
      * second level is directive name.
      */
@@ -73,6 +97,25 @@ struct yasm_object {
 
     /** Suffix appended to externally-visible symbols (empty string if none) */
     /*@owned@*/ char *global_suffix;
+
+    /** Nonzero if object formats that support it should serialize each
+     * section into memory and compute file offsets before writing, rather
+     * than writing bytecodes one at a time and querying the file position.
+     */
+    int presize_output;
+
+    /** Maximum number of threads yasm_object_finalize() finalizes
+     * bytecodes on (1 to finalize them all on the calling thread).
+     */
+    unsigned int finalize_threads;
+
+    /** Where yasm_object_optimize() stores its statistics (NULL if none). */
+    /*@null@*/ /*@dependent@*/ yasm_optimize_stats *optimize_stats;
+
+    /** Size hints used and updated by yasm_object_optimize() (NULL if
+     * none).
+     */
+    /*@null@*/ /*@dependent@*/ yasm_size_hints *size_hints;
 };
 
 /** Create a new object.  A default section is created as the first section.
@@ -142,7 +185,10 @@ void yasm_object_destroy(/*@only@*/ yasm_object *object);
 YASM_LIB_DECL
 void yasm_object_print(const yasm_object *object, FILE *f, int indent_level);
 
-/** Finalize an object after parsing.
+/** Finalize an object after parsing.  Instructions are finalized on up to
+ * the number of threads set with yasm_object_set_finalize_threads(); the
+ * result, including errors and warnings, is the same as finalizing them one
+ * by one on the calling thread.
  * \param object        object
  * \param errwarns      error/warning set
  * \note Errors/warnings are stored into errwarns.
@@ -192,6 +238,43 @@ void yasm_object_set_global_prefix(yasm_object *object, const char *prefix);
 YASM_LIB_DECL
 void yasm_object_set_global_suffix(yasm_object *object, const char *suffix);
 
+/** Enable or disable presized (layout-first) section output.
+ * \param object        object
+ * \param enable        nonzero to enable
+ */
+YASM_LIB_DECL
+void yasm_object_set_presize_output(yasm_object *object, int enable);
+
+/** Set the maximum number of threads yasm_object_finalize() uses (1 by
+ * default).  Ignored if libyasm was built without thread support.
+ * \param object        object
+ * \param num_threads   number of threads (including the calling thread)
+ */
+YASM_LIB_DECL
+void yasm_object_set_finalize_threads(yasm_object *object,
+                                      unsigned int num_threads);
+
+/** Request optimizer statistics.  Counts in stats are overwritten, and its
+ * step callback is called, by each subsequent yasm_object_optimize().
+ * \param object        object
+ * \param stats         statistics structure (NULL to disable); must remain
+ *                      valid while statistics are enabled
+ */
+YASM_LIB_DECL
+void yasm_object_set_optimize_stats(yasm_object *object,
+                                    /*@null@*/ yasm_optimize_stats *stats);
+
+/** Use size hints in the optimizer.  Each subsequent yasm_object_optimize()
+ * starts from the expansions given by hints read into it, and replaces the
+ * expansions recorded in it with the ones it makes.
+ * \param object        object
+ * \param hints         size hints (NULL to disable); must remain valid while
+ *                      enabled
+ */
+YASM_LIB_DECL
+void yasm_object_set_size_hints(yasm_object *object,
+                                /*@null@*/ yasm_size_hints *hints);
+
 /** Optimize an object.  Takes the unoptimized object and optimizes it.
  * If successful, the object is ready for output to an object file.
  * \param object        object
@@ -201,6 +284,22 @@ void yasm_object_set_global_suffix(yasm_object *object, const char *suffix);
 YASM_LIB_DECL
 void yasm_object_optimize(yasm_object *object, yasm_errwarns *errwarns);
 
+/** Lay out an object from its size hints (see yasm_object_set_size_hints())
+ * and check the layout instead of optimizing.  Every span is given the size
+ * (or TIMES count) its hint says, or its shortest form if it has none;
+ * offsets are computed once and each span is checked once against them.
+ * Nothing is expanded beyond the hints, so this takes time linear in the
+ * size of the object.  If no span is out of range, the object is ready for
+ * output exactly as if yasm_object_optimize() had found the same layout.
+ * \param object        object
+ * \param errwarns      error/warning set
+ * \return Number of spans out of range for the layout.
+ * \note Each span out of range is stored into errwarns as an error, as are
+ *       errors that keep the layout from being checked.
+ */
+YASM_LIB_DECL
+int yasm_object_optimize_verify(yasm_object *object, yasm_errwarns *errwarns);
+
 /** Determine if a section is flagged to contain code.
  * \param sect      section
  * \return Nonzero if section is flagged to contain code.
@@ -347,6 +446,45 @@ int yasm_section_bcs_traverse
     (yasm_section *sect, /*@null@*/ yasm_errwarns *errwarns,
      /*@null@*/ void *d, int (*func) (yasm_bytecode *bc, /*@null@*/ void *d));
 
+/** Get the total length of a section's contents.
+ * \param sect      section
+ * \return Length in bytes.
+ * \warning Only valid /after/ optimization.
+ */
+YASM_LIB_DECL
+unsigned long yasm_section_get_size(yasm_section *sect);
+
+/** Largest section, in bytes, that object formats convert with
+ * yasm_section_tobytes() or otherwise hold in memory.  Larger sections
+ * (typically large reserved or repeated areas) should be output bytecode by
+ * bytecode to a file-backed #yasm_outbuf, which seeks over zero runs.
+ */
+#define YASM_SECTION_TOBYTES_MAX    (16UL*1024*1024)
+
+/** Convert all bytecodes in a section into their byte representation,
+ * placing them into a single buffer sized from the optimized section length.
+ * Reserved (uninitialized) space is zeroed with a warning.  The buffer holds
+ * the whole section, so callers should only use this for sections no larger
+ * than #YASM_SECTION_TOBYTES_MAX.
+ * \param sect          section
+ * \param errwarns      error/warning set; yasm_errwarn_propagate() is called
+ *                      after each bytecode (with the bytecode's line number)
+ * \param size          size of the returned buffer (output)
+ * \param d             data to pass to each call to output_value/output_reloc
+ * \param output_value  function to call to convert values into their byte
+ *                      representation
+ * \param output_reloc  function to call to output relocation entries
+ *                      for a single sym
+ * \return Newly allocated buffer, or NULL if the section is empty.
+ * \warning Only valid /after/ optimization.
+ */
+YASM_LIB_DECL
+/*@null@*/ /*@only@*/ unsigned char *yasm_section_tobytes
+    (yasm_section *sect, /*@null@*/ yasm_errwarns *errwarns,
+     /*@out@*/ unsigned long *size, void *d,
+     yasm_output_value_func output_value,
+     /*@null@*/ yasm_output_reloc_func output_reloc);
+
 /** Get name of a section.
  * \param   sect    section
  * \return Section name.
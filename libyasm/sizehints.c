@@ -0,0 +1,475 @@
+/*
+ * Optimizer size hints
+ *
+ *  Copyright (C) 2026  Yasm developers
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR AND OTHER CONTRIBUTORS ``AS IS''
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE AUTHOR OR OTHER CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+#include "util.h"
+
+#include "coretype.h"
+#include "intnum.h"
+#include "linemap.h"
+#include "sizehints.h"
+
+/* File format (all numbers LEB128):
+ *   "yasmhint" magic, format version (1), number of files, then per file:
+ *     name length, name, number of hints, then per hint (sorted by line,
+ *     ordinal, and span ID):
+ *       line (difference from previous hint's line), ordinal, span ID,
+ *       value (signed)
+ */
+static const char hints_magic[8] = { 'y','a','s','m','h','i','n','t' };
+#define HINTS_VERSION   1
+
+typedef struct sizehint {
+    unsigned long file;         /* index into files */
+    unsigned long line;
+    unsigned long ord;
+    int id;
+    long val;
+} sizehint;
+
+/* Number of keys given out for a line; 0 if the entry is unused */
+typedef struct sizehint_line {
+    unsigned long line;
+    unsigned long count;
+} sizehint_line;
+
+/* Lines are kept in an open-addressed hash table (at most half full) rather
+ * than indexed directly, as %line can make them arbitrarily large.
+ */
+#define SIZEHINT_LINE_HASH(line)    ((line)*2654435761UL)
+
+typedef struct sizehint_file {
+    /*@owned@*/ char *name;
+    /*@owned@*/ /*@null@*/ sizehint_line *lines;
+    unsigned long num_lines, alloc_lines;   /* alloc_lines is a power of 2 */
+} sizehint_file;
+
+struct yasm_size_hints {
+    /*@dependent@*/ yasm_linemap *linemap;
+
+    /*@only@*/ /*@null@*/ sizehint_file *files;
+    unsigned long num_files;
+
+    /* Most recently looked up filename (owned by linemap) and its index */
+    /*@dependent@*/ /*@null@*/ const char *last_name;
+    unsigned long last_file;
+
+    /* Keys handed out by yasm_size_hints_key(); only file, line and ord
+     * are used.
+     */
+    /*@only@*/ /*@null@*/ sizehint *keys;
+    unsigned long num_keys, alloc_keys;
+
+    /* Hints read, sorted */
+    /*@only@*/ /*@null@*/ sizehint *in;
+    unsigned long num_in;
+
+    /* Expansions recorded, in order made */
+    /*@only@*/ /*@null@*/ sizehint *out;
+    unsigned long num_out, alloc_out;
+};
+
+yasm_size_hints *
+yasm_size_hints_create(yasm_linemap *linemap)
+{
+    yasm_size_hints *hints = yasm_xmalloc(sizeof(yasm_size_hints));
+
+    hints->linemap = linemap;
+    hints->files = NULL;
+    hints->num_files = 0;
+    hints->last_name = NULL;
+    hints->last_file = 0;
+    hints->keys = NULL;
+    hints->num_keys = 0;
+    hints->alloc_keys = 0;
+    hints->in = NULL;
+    hints->num_in = 0;
+    hints->out = NULL;
+    hints->num_out = 0;
+    hints->alloc_out = 0;
+    return hints;
+}
+
+void
+yasm_size_hints_destroy(yasm_size_hints *hints)
+{
+    unsigned long i;
+
+    for (i=0; i<hints->num_files; i++) {
+        yasm_xfree(hints->files[i].name);
+        if (hints->files[i].lines)
+            yasm_xfree(hints->files[i].lines);
+    }
+    if (hints->files)
+        yasm_xfree(hints->files);
+    if (hints->keys)
+        yasm_xfree(hints->keys);
+    if (hints->in)
+        yasm_xfree(hints->in);
+    if (hints->out)
+        yasm_xfree(hints->out);
+    yasm_xfree(hints);
+}
+
+static unsigned long
+sizehints_file(yasm_size_hints *hints, const char *name)
+{
+    unsigned long i;
+
+    for (i=0; i<hints->num_files; i++) {
+        if (strcmp(hints->files[i].name, name) == 0)
+            return i;
+    }
+
+    /* Few files, so grow one at a time */
+    hints->files = yasm_xrealloc(hints->files,
+                                 (i+1)*sizeof(sizehint_file));
+    hints->files[i].name = yasm__xstrdup(name);
+    hints->files[i].lines = NULL;
+    hints->files[i].num_lines = 0;
+    hints->files[i].alloc_lines = 0;
+    hints->num_files = i+1;
+    return i;
+}
+
+/* Returns the number of keys already given out for line in hf, and counts
+ * one more.
+ */
+static unsigned long
+sizehints_next_ord(sizehint_file *hf, unsigned long line)
+{
+    unsigned long mask, i, j;
+
+    if (2*(hf->num_lines+1) > hf->alloc_lines) {
+        sizehint_line *old = hf->lines;
+        unsigned long old_alloc = hf->alloc_lines;
+
+        hf->alloc_lines = old_alloc ? old_alloc*2 : 1024;
+        hf->lines = yasm_xmalloc(hf->alloc_lines*sizeof(sizehint_line));
+        memset(hf->lines, 0, hf->alloc_lines*sizeof(sizehint_line));
+        mask = hf->alloc_lines-1;
+        for (j=0; j<old_alloc; j++) {
+            if (old[j].count == 0)
+                continue;
+            i = SIZEHINT_LINE_HASH(old[j].line) & mask;
+            while (hf->lines[i].count != 0)
+                i = (i+1) & mask;
+            hf->lines[i] = old[j];
+        }
+        if (old)
+            yasm_xfree(old);
+    }
+
+    mask = hf->alloc_lines-1;
+    i = SIZEHINT_LINE_HASH(line) & mask;
+    while (hf->lines[i].count != 0) {
+        if (hf->lines[i].line == line)
+            return hf->lines[i].count++;
+        i = (i+1) & mask;
+    }
+    hf->lines[i].line = line;
+    hf->lines[i].count = 1;
+    hf->num_lines++;
+    return 0;
+}
+
+static int
+sizehint_compare(const void *a, const void *b)
+{
+    const sizehint *x = a, *y = b;
+
+    if (x->file != y->file)
+        return x->file < y->file ? -1 : 1;
+    if (x->line != y->line)
+        return x->line < y->line ? -1 : 1;
+    if (x->ord != y->ord)
+        return x->ord < y->ord ? -1 : 1;
+    if (x->id != y->id)
+        return x->id < y->id ? -1 : 1;
+    return 0;
+}
+
+static int
+hints_read_uleb128(FILE *f, /*@out@*/ unsigned long *v)
+{
+    unsigned int shift = 0;
+    int c;
+
+    *v = 0;
+    do {
+        c = fgetc(f);
+        if (c == EOF || shift >= sizeof(unsigned long)*8)
+            return 1;
+        *v |= (unsigned long)(c & 0x7f) << shift;
+        shift += 7;
+    } while (c & 0x80);
+    return 0;
+}
+
+static int
+hints_read_sleb128(FILE *f, /*@out@*/ long *v)
+{
+    unsigned long uv = 0;
+    unsigned int shift = 0;
+    int c;
+
+    do {
+        c = fgetc(f);
+        if (c == EOF || shift >= sizeof(unsigned long)*8)
+            return 1;
+        uv |= (unsigned long)(c & 0x7f) << shift;
+        shift += 7;
+    } while (c & 0x80);
+    if ((c & 0x40) && shift < sizeof(unsigned long)*8)
+        uv |= ~0UL << shift;    /* sign extend */
+    *v = (long)uv;
+    return 0;
+}
+
+static void
+hints_write_uleb128(FILE *f, unsigned long v)
+{
+    unsigned char buf[(sizeof(unsigned long)*8+6)/7];
+
+    fwrite(buf, yasm_get_uleb128(v, buf), 1, f);
+}
+
+static void
+hints_write_sleb128(FILE *f, long v)
+{
+    unsigned char buf[(sizeof(long)*8+6)/7];
+
+    fwrite(buf, yasm_get_sleb128(v, buf), 1, f);
+}
+
+int
+yasm_size_hints_read(yasm_size_hints *hints, FILE *f)
+{
+    char magic[sizeof(hints_magic)];
+    unsigned long version, num_files, i;
+    /*@only@*/ sizehint *in = NULL;
+    unsigned long num_in = 0, alloc_in = 0;
+    /*@only@*/ /*@null@*/ char *name = NULL;
+
+    if (fread(magic, sizeof(magic), 1, f) != 1
+        || memcmp(magic, hints_magic, sizeof(magic)) != 0
+        || hints_read_uleb128(f, &version) || version != HINTS_VERSION
+        || hints_read_uleb128(f, &num_files))
+        return 1;
+
+    for (i=0; i<num_files; i++) {
+        unsigned long len, num, file, line = 0, j;
+
+        if (hints_read_uleb128(f, &len) || len > 65536)
+            goto bad;
+        name = yasm_xmalloc(len+1);
+        if (fread(name, 1, len, f) != len)
+            goto bad;
+        name[len] = '\0';
+        file = sizehints_file(hints, name);
+        yasm_xfree(name);
+        name = NULL;
+
+        if (hints_read_uleb128(f, &num))
+            goto bad;
+        for (j=0; j<num; j++) {
+            unsigned long line_diff, ord, id;
+            long val;
+
+            if (hints_read_uleb128(f, &line_diff)
+                || hints_read_uleb128(f, &ord)
+                || hints_read_uleb128(f, &id) || id > 255
+                || hints_read_sleb128(f, &val))
+                goto bad;
+            line += line_diff;
+            if (num_in >= alloc_in) {
+                alloc_in = alloc_in ? alloc_in*2 : 256;
+                in = yasm_xrealloc(in, alloc_in*sizeof(sizehint));
+            }
+            in[num_in].file = file;
+            in[num_in].line = line;
+            in[num_in].ord = ord;
+            in[num_in].id = (int)id;
+            in[num_in].val = val;
+            num_in++;
+        }
+    }
+
+    /* Written sorted, but file indexes may differ from ours (and a file
+     * may be listed twice if hand-edited).
+     */
+    yasm__mergesort(in, num_in, sizeof(sizehint), sizehint_compare);
+
+    if (hints->in)
+        yasm_xfree(hints->in);
+    hints->in = in;
+    hints->num_in = num_in;
+    return 0;
+
+bad:
+    if (name)
+        yasm_xfree(name);
+    if (in)
+        yasm_xfree(in);
+    return 1;
+}
+
+int
+yasm_size_hints_write(yasm_size_hints *hints, FILE *f)
+{
+    sizehint *out = hints->out;
+    unsigned long num = 0, i, j, file, num_files = 0;
+
+    /* Sort (stably, so the last expansion of a span is last among its
+     * equals) and keep only the last expansion of each span.
+     */
+    if (hints->num_out > 0)
+        yasm__mergesort(out, hints->num_out, sizeof(sizehint),
+                        sizehint_compare);
+    for (i=0; i<hints->num_out; i++) {
+        if (i+1 < hints->num_out && sizehint_compare(&out[i], &out[i+1]) == 0)
+            continue;
+        out[num++] = out[i];
+    }
+    hints->num_out = num;
+
+    for (i=0; i<num; i++) {
+        if (i == 0 || out[i].file != out[i-1].file)
+            num_files++;
+    }
+
+    fwrite(hints_magic, sizeof(hints_magic), 1, f);
+    hints_write_uleb128(f, HINTS_VERSION);
+    hints_write_uleb128(f, num_files);
+    for (i=0; i<num; i=j) {
+        const char *name;
+        unsigned long line = 0;
+
+        file = out[i].file;
+        for (j=i; j<num && out[j].file == file; j++)
+            ;
+        name = hints->files[file].name;
+        hints_write_uleb128(f, (unsigned long)strlen(name));
+        fwrite(name, strlen(name), 1, f);
+        hints_write_uleb128(f, j-i);
+        for (; i<j; i++) {
+            hints_write_uleb128(f, out[i].line - line);
+            line = out[i].line;
+            hints_write_uleb128(f, out[i].ord);
+            hints_write_uleb128(f, (unsigned long)out[i].id);
+            hints_write_sleb128(f, out[i].val);
+        }
+    }
+    return ferror(f) ? 1 : 0;
+}
+
+void
+yasm_size_hints_begin(yasm_size_hints *hints)
+{
+    unsigned long i;
+
+    for (i=0; i<hints->num_files; i++) {
+        if (hints->files[i].lines)
+            memset(hints->files[i].lines, 0,
+                   hints->files[i].alloc_lines*sizeof(sizehint_line));
+        hints->files[i].num_lines = 0;
+    }
+    hints->last_name = NULL;
+    hints->num_keys = 0;
+    hints->num_out = 0;
+}
+
+unsigned long
+yasm_size_hints_key(yasm_size_hints *hints, unsigned long line)
+{
+    const char *name;
+    unsigned long file_line, file;
+    sizehint_file *hf;
+    sizehint *key;
+
+    yasm_linemap_lookup(hints->linemap, line, &name, &file_line);
+    if (name == hints->last_name)
+        file = hints->last_file;
+    else {
+        file = sizehints_file(hints, name);
+        hints->last_name = name;
+        hints->last_file = file;
+    }
+
+    hf = &hints->files[file];
+
+    if (hints->num_keys >= hints->alloc_keys) {
+        hints->alloc_keys = hints->alloc_keys ? hints->alloc_keys*2 : 1024;
+        hints->keys = yasm_xrealloc(hints->keys,
+                                    hints->alloc_keys*sizeof(sizehint));
+    }
+    key = &hints->keys[hints->num_keys];
+    key->file = file;
+    key->line = file_line;
+    key->ord = sizehints_next_ord(hf, file_line);
+    return hints->num_keys++;
+}
+
+int
+yasm_size_hints_get(const yasm_size_hints *hints, unsigned long key, int id,
+                    long *val)
+{
+    sizehint find;
+    unsigned long lo = 0, hi = hints->num_in;
+
+    find = hints->keys[key];
+    find.id = id;
+
+    while (lo < hi) {
+        unsigned long mid = lo + (hi-lo)/2;
+        int cmp = sizehint_compare(&hints->in[mid], &find);
+        if (cmp == 0) {
+            *val = hints->in[mid].val;
+            return 1;
+        }
+        if (cmp < 0)
+            lo = mid+1;
+        else
+            hi = mid;
+    }
+    return 0;
+}
+
+void
+yasm_size_hints_set(yasm_size_hints *hints, unsigned long key, int id,
+                    long val)
+{
+    sizehint *hint;
+
+    if (hints->num_out >= hints->alloc_out) {
+        hints->alloc_out = hints->alloc_out ? hints->alloc_out*2 : 256;
+        hints->out = yasm_xrealloc(hints->out,
+                                   hints->alloc_out*sizeof(sizehint));
+    }
+    hint = &hints->out[hints->num_out++];
+    *hint = hints->keys[key];
+    hint->id = id;
+    hint->val = val;
+}
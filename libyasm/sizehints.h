@@ -0,0 +1,128 @@
+/**
+ * \file libyasm/sizehints.h
+ * \brief YASM optimizer size hints interface.
+ *
+ * \license
+ *  Copyright (C) 2026  Yasm developers
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR AND OTHER CONTRIBUTORS ``AS IS''
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE AUTHOR OR OTHER CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ * \endlicense
+ *
+ * Size hints remember which spans yasm_object_optimize() had to expand (the
+ * jumps it made near, the displacements and immediates it made word-sized)
+ * and the span values that caused it, as well as the counts it gave TIMES
+ * that depend on offsets.  Each is keyed by source file, line, the
+ * bytecode's ordinal among the bytecodes with spans on that line, and span
+ * ID.  When hints saved by one run are given to the next, the optimizer
+ * expands those spans up front and only has to find the expansions that
+ * changed since.  yasm_object_optimize_verify() instead takes all sizes
+ * from the hints and only checks them.
+ *
+ * Hints from the same source reproduce the same output.  Hints that no
+ * longer match a span are ignored, but a stale hint that expands a span
+ * that no longer needs it is kept, so edited sources may assemble to larger
+ * (still correct) code until the hints are saved again.
+ */
+#ifndef YASM_SIZEHINTS_H
+#define YASM_SIZEHINTS_H
+
+#ifndef YASM_LIB_DECL
+#define YASM_LIB_DECL
+#endif
+
+/** Create a new, empty set of size hints.
+ * \param linemap       line mapping repository used to map bytecode lines
+ *                      to source file and line; must remain valid while
+ *                      the hints are used by yasm_object_optimize()
+ * \return New size hints.
+ */
+YASM_LIB_DECL
+/*@only@*/ yasm_size_hints *yasm_size_hints_create(yasm_linemap *linemap);
+
+/** Clean up any memory allocated for size hints.
+ * \param hints         size hints
+ */
+YASM_LIB_DECL
+void yasm_size_hints_destroy(/*@only@*/ yasm_size_hints *hints);
+
+/** Read hints saved by yasm_size_hints_write().  They are used by
+ * subsequent yasm_object_optimize() calls.
+ * \param hints         size hints
+ * \param f             file (opened in binary mode)
+ * \return Nonzero if the file is not a valid size hints file (no hints are
+ *         read in that case), otherwise 0.
+ */
+YASM_LIB_DECL
+int yasm_size_hints_read(yasm_size_hints *hints, FILE *f);
+
+/** Write the expansions made by the last yasm_object_optimize() as hints.
+ * \param hints         size hints
+ * \param f             file (opened in binary mode)
+ * \return Nonzero on write error, otherwise 0.
+ */
+YASM_LIB_DECL
+int yasm_size_hints_write(yasm_size_hints *hints, FILE *f);
+
+/** Forget the expansions recorded by a previous optimization and restart
+ * ordinal numbering.  Called by yasm_object_optimize() before laying out
+ * bytecodes.
+ * \internal
+ * \param hints         size hints
+ */
+YASM_LIB_DECL
+void yasm_size_hints_begin(yasm_size_hints *hints);
+
+/** Get the key of the next bytecode with spans.  Must be called once for
+ * each such bytecode, in bytecode order.
+ * \internal
+ * \param hints         size hints
+ * \param line          virtual line of the bytecode
+ * \return Key for yasm_size_hints_get() and yasm_size_hints_set().
+ */
+YASM_LIB_DECL
+unsigned long yasm_size_hints_key(yasm_size_hints *hints, unsigned long line);
+
+/** Look up the hinted value of a span.
+ * \internal
+ * \param hints         size hints
+ * \param key           bytecode key
+ * \param id            span ID
+ * \param val           hinted span value (output)
+ * \return Nonzero if there is a hint for the span, otherwise 0.
+ */
+YASM_LIB_DECL
+int yasm_size_hints_get(const yasm_size_hints *hints, unsigned long key,
+                        int id, /*@out@*/ long *val);
+
+/** Record an expansion of a span (for span ID 0, the TIMES count).  If a
+ * span is expanded more than once, the last value recorded is written.
+ * \internal
+ * \param hints         size hints
+ * \param key           bytecode key
+ * \param id            span ID
+ * \param val           span value that caused the expansion
+ */
+YASM_LIB_DECL
+void yasm_size_hints_set(yasm_size_hints *hints, unsigned long key, int id,
+                         long val);
+
+#endif
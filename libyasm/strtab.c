@@ -0,0 +1,293 @@
+/*
+ * Object file string table builder
+ *
+ *  Copyright (C) 2026  Yasm developers
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR AND OTHER CONTRIBUTORS ``AS IS''
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE AUTHOR OR OTHER CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+#include "util.h"
+
+#include "coretype.h"
+#include "errwarn.h"
+#include "phash.h"
+#include "strtab.h"
+
+typedef struct strtab_str {
+    unsigned long pos;          /* position in buf */
+    unsigned long len;          /* length, excluding terminating NUL */
+    unsigned long hash;
+    unsigned long offset;       /* offset in laid out table */
+    unsigned long parent;       /* index of string this is the end of, or
+                                 * own index if not merged */
+} strtab_str;
+
+struct yasm_strtab {
+    unsigned long base;
+    int merge_tails;
+    int finalized;
+
+    /* Distinct strings, each NUL-terminated, in the order added.  Without
+     * tail merging this is also the laid out table.
+     */
+    /*@only@*/ /*@null@*/ char *buf;
+    unsigned long len, alloc;
+
+    /*@only@*/ /*@null@*/ strtab_str *strs;
+    unsigned long num_strs, alloc_strs;
+
+    /* Open-addressed hash of string index+1 (0 = empty slot) */
+    /*@only@*/ unsigned long *slots;
+    unsigned long num_slots;    /* power of 2 */
+
+    /* Laid out table with tail merging */
+    /*@only@*/ /*@null@*/ char *out;
+    unsigned long out_len;
+};
+
+/* Sort key used to find strings that end other strings */
+typedef struct strtab_tail {
+    /*@dependent@*/ const char *str;
+    unsigned long len;
+    unsigned long index;
+} strtab_tail;
+
+#define STRTAB_INITIAL_SLOTS    64
+
+yasm_strtab *
+yasm_strtab_create(unsigned long base, int merge_tails)
+{
+    yasm_strtab *strtab = yasm_xmalloc(sizeof(yasm_strtab));
+
+    strtab->base = base;
+    strtab->merge_tails = merge_tails;
+    strtab->finalized = 0;
+    strtab->buf = NULL;
+    strtab->len = 0;
+    strtab->alloc = 0;
+    strtab->strs = NULL;
+    strtab->num_strs = 0;
+    strtab->alloc_strs = 0;
+    strtab->num_slots = STRTAB_INITIAL_SLOTS;
+    strtab->slots = yasm_xcalloc(strtab->num_slots, sizeof(unsigned long));
+    strtab->out = NULL;
+    strtab->out_len = 0;
+    return strtab;
+}
+
+void
+yasm_strtab_destroy(yasm_strtab *strtab)
+{
+    if (strtab->buf)
+        yasm_xfree(strtab->buf);
+    if (strtab->strs)
+        yasm_xfree(strtab->strs);
+    yasm_xfree(strtab->slots);
+    if (strtab->out)
+        yasm_xfree(strtab->out);
+    yasm_xfree(strtab);
+}
+
+static void
+strtab_rehash(yasm_strtab *strtab)
+{
+    unsigned long i, mask;
+
+    yasm_xfree(strtab->slots);
+    strtab->num_slots *= 2;
+    strtab->slots = yasm_xcalloc(strtab->num_slots, sizeof(unsigned long));
+    mask = strtab->num_slots - 1;
+    for (i=0; i<strtab->num_strs; i++) {
+        unsigned long s = strtab->strs[i].hash & mask;
+        while (strtab->slots[s] != 0)
+            s = (s+1) & mask;
+        strtab->slots[s] = i+1;
+    }
+}
+
+unsigned long
+yasm_strtab_add(yasm_strtab *strtab, const char *str)
+{
+    size_t len = strlen(str);
+    unsigned long hash = phash_lookup(str, len, 0);
+    unsigned long mask = strtab->num_slots - 1;
+    unsigned long s = hash & mask;
+    strtab_str *ss;
+
+    if (strtab->finalized)
+        yasm_internal_error(N_("string added to finalized string table"));
+
+    /* Look for an equal string */
+    while (strtab->slots[s] != 0) {
+        ss = &strtab->strs[strtab->slots[s]-1];
+        if (ss->hash == hash && ss->len == len &&
+            memcmp(&strtab->buf[ss->pos], str, len) == 0)
+            return strtab->slots[s]-1;
+        s = (s+1) & mask;
+    }
+
+    /* Not found; append to the buffer */
+    if (strtab->len + len + 1 > strtab->alloc) {
+        do {
+            strtab->alloc = strtab->alloc ? strtab->alloc*2 : 256;
+        } while (strtab->len + len + 1 > strtab->alloc);
+        strtab->buf = yasm_xrealloc(strtab->buf, strtab->alloc);
+    }
+    memcpy(&strtab->buf[strtab->len], str, len+1);
+
+    if (strtab->num_strs >= strtab->alloc_strs) {
+        strtab->alloc_strs = strtab->alloc_strs ? strtab->alloc_strs*2 : 16;
+        strtab->strs = yasm_xrealloc(strtab->strs,
+                                     strtab->alloc_strs*sizeof(strtab_str));
+    }
+    ss = &strtab->strs[strtab->num_strs];
+    ss->pos = strtab->len;
+    ss->len = (unsigned long)len;
+    ss->hash = hash;
+    ss->offset = strtab->base + strtab->len;
+    ss->parent = strtab->num_strs;
+    strtab->len += (unsigned long)len+1;
+    strtab->slots[s] = ++strtab->num_strs;
+
+    /* Keep the hash table at most half full */
+    if (strtab->num_strs*2 > strtab->num_slots)
+        strtab_rehash(strtab);
+
+    return strtab->num_strs-1;
+}
+
+/* Order strings by their reversed contents, so that a string is followed by
+ * all strings that end with it.
+ */
+static int
+strtab_tail_compare(const void *a, const void *b)
+{
+    const strtab_tail *ta = (const strtab_tail *)a;
+    const strtab_tail *tb = (const strtab_tail *)b;
+    unsigned long la = ta->len, lb = tb->len;
+
+    while (la > 0 && lb > 0) {
+        unsigned char ca = (unsigned char)ta->str[--la];
+        unsigned char cb = (unsigned char)tb->str[--lb];
+        if (ca != cb)
+            return (ca < cb) ? -1 : 1;
+    }
+    if (ta->len != tb->len)
+        return (ta->len < tb->len) ? -1 : 1;
+    return 0;
+}
+
+unsigned long
+yasm_strtab_finalize(yasm_strtab *strtab)
+{
+    strtab_tail *tails;
+    unsigned long i, n, prev;
+
+    if (strtab->finalized)
+        return strtab->merge_tails ? strtab->out_len : strtab->len;
+    strtab->finalized = 1;
+    if (!strtab->merge_tails || strtab->num_strs == 0)
+        return strtab->len;
+
+    /* Sort the nonempty strings; scanning from the last, each string is
+     * either the end of the last string not merged or not the end of any.
+     */
+    tails = yasm_xmalloc(strtab->num_strs*sizeof(strtab_tail));
+    n = 0;
+    for (i=0; i<strtab->num_strs; i++) {
+        if (strtab->strs[i].len == 0)
+            continue;
+        tails[n].str = &strtab->buf[strtab->strs[i].pos];
+        tails[n].len = strtab->strs[i].len;
+        tails[n].index = i;
+        n++;
+    }
+    qsort(tails, n, sizeof(strtab_tail), strtab_tail_compare);
+
+    prev = 0;
+    for (i=n; i>0; i--) {
+        strtab_tail *t = &tails[i-1];
+        if (i < n) {
+            const strtab_str *p = &strtab->strs[prev];
+            if (t->len <= p->len &&
+                memcmp(&strtab->buf[p->pos + p->len - t->len], t->str,
+                       t->len) == 0) {
+                strtab->strs[t->index].parent = prev;
+                continue;
+            }
+        }
+        prev = t->index;
+    }
+    yasm_xfree(tails);
+
+    /* Lay out the strings not merged in the order added, then point the
+     * merged strings into them.
+     */
+    strtab->out = yasm_xmalloc(strtab->len ? strtab->len : 1);
+    strtab->out_len = 0;
+    for (i=0; i<strtab->num_strs; i++) {
+        strtab_str *ss = &strtab->strs[i];
+        if (ss->parent != i)
+            continue;
+        memcpy(&strtab->out[strtab->out_len], &strtab->buf[ss->pos],
+               ss->len+1);
+        ss->offset = strtab->base + strtab->out_len;
+        strtab->out_len += ss->len+1;
+    }
+    for (i=0; i<strtab->num_strs; i++) {
+        strtab_str *ss = &strtab->strs[i];
+        if (ss->parent != i) {
+            const strtab_str *p = &strtab->strs[ss->parent];
+            ss->offset = p->offset + p->len - ss->len;
+        }
+    }
+    return strtab->out_len;
+}
+
+unsigned long
+yasm_strtab_get_offset(const yasm_strtab *strtab, unsigned long index)
+{
+    if (index >= strtab->num_strs)
+        yasm_internal_error(N_("invalid string table index"));
+    if (strtab->merge_tails && !strtab->finalized)
+        yasm_internal_error(N_("string table offset used before layout"));
+    return strtab->strs[index].offset;
+}
+
+unsigned long
+yasm_strtab_output(yasm_strtab *strtab, FILE *f)
+{
+    const char *buf;
+    unsigned long len;
+
+    if (!strtab->finalized)
+        yasm_internal_error(N_("string table output before layout"));
+    if (strtab->merge_tails) {
+        buf = strtab->out;
+        len = strtab->out_len;
+    } else {
+        buf = strtab->buf;
+        len = strtab->len;
+    }
+    if (len > 0)
+        fwrite(buf, (size_t)len, 1, f);
+    return len;
+}
@@ -0,0 +1,102 @@
+/**
+ * \file libyasm/strtab.h
+ * \brief YASM object file string table builder interface.
+ *
+ * \license
+ *  Copyright (C) 2026  Yasm developers
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR AND OTHER CONTRIBUTORS ``AS IS''
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE AUTHOR OR OTHER CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ * \endlicense
+ *
+ * A string table holds the NUL-terminated strings that object file symbol
+ * and section entries refer to by offset.  Each distinct string is stored
+ * once; adding a string that is already present returns the existing one.
+ * A table created with tail merging also stores no string that is the end
+ * of another (".text" is found at the end of ".rela.text"); offsets in such
+ * a table are only known after yasm_strtab_finalize().
+ */
+#ifndef YASM_STRTAB_H
+#define YASM_STRTAB_H
+
+#ifndef YASM_LIB_DECL
+#define YASM_LIB_DECL
+#endif
+
+/** Create a new, empty string table.
+ * \param base          offset of the first string in the table (the size
+ *                      of any header the object format writes before it)
+ * \param merge_tails   if nonzero, store strings that are the end of
+ *                      another string as part of that string
+ * \return New string table.
+ */
+YASM_LIB_DECL
+/*@only@*/ yasm_strtab *yasm_strtab_create(unsigned long base,
+                                          int merge_tails);
+
+/** Clean up any memory allocated for a string table.
+ * \param strtab        string table
+ */
+YASM_LIB_DECL
+void yasm_strtab_destroy(/*@only@*/ yasm_strtab *strtab);
+
+/** Add a string to a string table.  Must not be called after
+ * yasm_strtab_finalize().
+ * \param strtab        string table
+ * \param str           string (copied)
+ * \return Index of the string, the same for equal strings, for use with
+ *         yasm_strtab_get_offset().  Indices count up from 0 in the order
+ *         distinct strings are added.
+ */
+YASM_LIB_DECL
+unsigned long yasm_strtab_add(yasm_strtab *strtab, const char *str);
+
+/** Lay out a string table.  Needed before yasm_strtab_get_offset() for a
+ * table with tail merging, and before yasm_strtab_output() for any table.
+ * Strings that are not merged into others are laid out in the order they
+ * were first added.
+ * \param strtab        string table
+ * \return Size of the table in bytes, excluding the base offset.
+ */
+YASM_LIB_DECL
+unsigned long yasm_strtab_finalize(yasm_strtab *strtab);
+
+/** Get the offset of a string in a string table.  For tables without tail
+ * merging, the offset is known as soon as the string is added.
+ * \param strtab        string table
+ * \param index         string index returned by yasm_strtab_add()
+ * \return Offset of the string (including the base offset).
+ */
+YASM_LIB_DECL
+unsigned long yasm_strtab_get_offset(const yasm_strtab *strtab,
+                                     unsigned long index);
+
+/** Write the strings of a finalized string table to a file with a single
+ * write.  The header before the base offset is not written.
+ * \param strtab        string table
+ * \param f             file
+ * \return Number of bytes written (the size returned by
+ *         yasm_strtab_finalize()).
+ */
+YASM_LIB_DECL
+unsigned long yasm_strtab_output(yasm_strtab *strtab, FILE *f);
+
+#endif
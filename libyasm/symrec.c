@@ -28,6 +28,9 @@
 
 #include <limits.h>
 #include <ctype.h>
+#ifdef YASM_THREADS
+#include <pthread.h>
+#endif
 
 #include "libyasm-stdint.h"
 #include "coretype.h"
@@ -40,6 +43,7 @@
 #include "floatnum.h"
 #include "expr.h"
 #include "symrec.h"
+#include "preproc.h"
 
 #include "bytecode.h"
 #include "section.h"
@@ -57,27 +61,67 @@ typedef enum {
                                    purpose */
 } sym_type;
 
+/* Value of an EQU symbol. */
+typedef struct symrec_equ {
+    /*@only@*/ yasm_expr *expn;         /* equ value */
+
+    /* value folded to a constant; NULL if not (yet) known */
+    /*@null@*/ /*@only@*/ yasm_intnum *value;
+} symrec_equ;
+
+/* Symbols are kept small, as there may be millions of them: the name is
+ * stored in the same allocation, and the rarely used parts (EQU values,
+ * user-defined size and segment) are kept elsewhere.
+ */
 struct yasm_symrec {
-    char *name;
-    sym_type type;
-    yasm_sym_status status;
-    yasm_sym_vis visibility;
-    unsigned long def_line;     /* line where symbol was first defined */
-    unsigned long decl_line;    /* line where symbol was first declared */
-    unsigned long use_line;     /* line where symbol was first used */
     union {
-        yasm_expr *expn;        /* equ value */
+        /* equ value (if valued) */
+        /*@dependent@*/ symrec_equ *equ;
 
         /* bytecode immediately preceding a label */
         /*@dependent@*/ yasm_bytecode *precbc;
     } value;
-    unsigned int size;          /* 0 if not user-defined */
-    const char *segment;        /* for segmented systems like DOS */
 
     /* associated data; NULL if none */
     /*@null@*/ /*@only@*/ yasm__assoc_data *assoc_data;
+
+    /* Line where symbol was first defined.  Until it is defined, the line
+     * where it was first used instead, which is only needed to report it
+     * as undefined.
+     */
+    unsigned long line;
+    unsigned long decl_line;    /* line where symbol was first declared */
+
+    unsigned char type;         /* sym_type */
+    unsigned char status;       /* yasm_sym_status */
+    unsigned char visibility;   /* yasm_sym_vis */
+    unsigned char has_size;     /* nonzero if size or segment set */
+
+    char name[1];               /* name (allocated to fit) */
 };
 
+/* User-defined size and segment of a symbol (TASM). */
+typedef struct symrec_size {
+    unsigned int size;          /* 0 if not user-defined */
+    /*@null@*/ /*@dependent@*/ const char *segment;
+} symrec_size;
+
+/* Symbols (with their names) and EQU values are allocated from large
+ * blocks owned by the symbol table rather than one at a time; nothing is
+ * freed before the table is.
+ */
+#define SYMTAB_BLOCK_SIZE   65536
+
+typedef union symtab_align {
+    void *p;
+    unsigned long l;
+} symtab_align;
+
+typedef struct symtab_block {
+    /*@null@*/ /*@owned@*/ struct symtab_block *next;
+    symtab_align data[1];
+} symtab_block;
+
 /* Linked list of symbols not in the symbol table. */
 typedef struct non_table_symrec_s {
      /*@reldef@*/ SLIST_ENTRY(non_table_symrec_s) link;
@@ -90,9 +134,29 @@ struct yasm_symtab {
     /* Symbols not in the table */
     SLIST_HEAD(nontablesymhead_s, non_table_symrec_s) non_table_syms;
 
+    /* Allocation blocks; the first is the one being filled */
+    /*@null@*/ /*@owned@*/ symtab_block *blocks;
+    /*@dependent@*/ char *block_next;   /* next free byte in first block */
+    size_t block_left;                  /* bytes left in first block */
+
     int case_sensitive;
+
+#ifdef YASM_THREADS
+    /* Held while creating the symbols bytecode finalization can create, as
+     * yasm_object_finalize() may finalize bytecodes on several threads.
+     */
+    pthread_mutex_t mutex;
+#endif
 };
 
+#ifdef YASM_THREADS
+# define SYMTAB_LOCK(symtab)    pthread_mutex_lock(&(symtab)->mutex)
+# define SYMTAB_UNLOCK(symtab)  pthread_mutex_unlock(&(symtab)->mutex)
+#else
+# define SYMTAB_LOCK(symtab)
+# define SYMTAB_UNLOCK(symtab)
+#endif
+
 static void
 objext_valparams_destroy(void *data)
 {
@@ -105,7 +169,7 @@ objext_valparams_print(void *data, FILE *f, int indent_level)
     yasm_vps_print((yasm_valparamhead *)data, f);
 }
 
-static yasm_assoc_data_callback objext_valparams_cb = {
+static const yasm_assoc_data_callback objext_valparams_cb = {
     objext_valparams_destroy,
     objext_valparams_print
 };
@@ -125,18 +189,79 @@ common_size_print(void *data, FILE *f, int indent_level)
     yasm_expr_print(*e, f);
 }
 
-static yasm_assoc_data_callback common_size_cb = {
+static const yasm_assoc_data_callback common_size_cb = {
     common_size_destroy,
     common_size_print
 };
 
+static void
+symrec_size_destroy(void *data)
+{
+    yasm_xfree(data);
+}
+
+static void
+symrec_size_print(void *data, FILE *f, int indent_level)
+{
+    symrec_size *sz = (symrec_size *)data;
+    fprintf(f, "%*sSize=%u\n", indent_level, "", sz->size);
+    if (sz->segment)
+        fprintf(f, "%*sSegment=%s\n", indent_level, "", sz->segment);
+}
+
+static const yasm_assoc_data_callback symrec_size_cb = {
+    symrec_size_destroy,
+    symrec_size_print
+};
+
+static /*@out@*/ /*@dependent@*/ void *
+symtab_alloc(yasm_symtab *symtab, size_t size)
+{
+    symtab_block *block;
+    void *p;
+
+    size = (size + sizeof(symtab_align) - 1) & ~(sizeof(symtab_align) - 1);
+    if (size > SYMTAB_BLOCK_SIZE/4) {
+        /* Give large requests their own block, keeping the current one */
+        block = yasm_xmalloc(offsetof(symtab_block, data) + size);
+        if (symtab->blocks) {
+            block->next = symtab->blocks->next;
+            symtab->blocks->next = block;
+        } else {
+            block->next = NULL;
+            symtab->blocks = block;
+            symtab->block_left = 0;
+        }
+        return block->data;
+    }
+
+    if (size > symtab->block_left) {
+        block = yasm_xmalloc(offsetof(symtab_block, data) +
+                             SYMTAB_BLOCK_SIZE);
+        block->next = symtab->blocks;
+        symtab->blocks = block;
+        symtab->block_next = (char *)block->data;
+        symtab->block_left = SYMTAB_BLOCK_SIZE;
+    }
+    p = symtab->block_next;
+    symtab->block_next += size;
+    symtab->block_left -= size;
+    return p;
+}
+
 yasm_symtab *
 yasm_symtab_create(void)
 {
     yasm_symtab *symtab = yasm_xmalloc(sizeof(yasm_symtab));
     symtab->sym_table = HAMT_create(0, yasm_internal_error_);
     SLIST_INIT(&symtab->non_table_syms);
+    symtab->blocks = NULL;
+    symtab->block_next = NULL;
+    symtab->block_left = 0;
     symtab->case_sensitive = 1;
+#ifdef YASM_THREADS
+    pthread_mutex_init(&symtab->mutex, NULL);
+#endif
     return symtab;
 }
 
@@ -150,59 +275,58 @@ static void
 symrec_destroy_one(/*@only@*/ void *d)
 {
     yasm_symrec *sym = d;
-    yasm_xfree(sym->name);
-    if (sym->type == SYM_EQU && (sym->status & YASM_SYM_VALUED))
-        yasm_expr_destroy(sym->value.expn);
+    if (sym->type == SYM_EQU && (sym->status & YASM_SYM_VALUED)) {
+        yasm_expr_destroy(sym->value.equ->expn);
+        if (sym->value.equ->value)
+            yasm_intnum_destroy(sym->value.equ->value);
+    }
     yasm__assoc_data_destroy(sym->assoc_data);
-    yasm_xfree(sym);
 }
 
-static /*@partial@*/ yasm_symrec *
-symrec_new_common(/*@keep@*/ char *name, int case_sensitive)
+static /*@partial@*/ /*@dependent@*/ yasm_symrec *
+symrec_new_common(yasm_symtab *symtab, const char *name)
 {
-    yasm_symrec *rec = yasm_xmalloc(sizeof(yasm_symrec));
+    size_t len = strlen(name);
+    yasm_symrec *rec = symtab_alloc(symtab,
+                                    offsetof(yasm_symrec, name) + len + 1);
 
-    if (!case_sensitive) {
+    memcpy(rec->name, name, len+1);
+    if (!symtab->case_sensitive) {
         char *c;
-        for (c=name; *c; c++)
+        for (c=rec->name; *c; c++)
             *c = tolower(*c);
     }
 
-    rec->name = name;
     rec->type = SYM_UNKNOWN;
-    rec->def_line = 0;
+    rec->line = 0;
     rec->decl_line = 0;
-    rec->use_line = 0;
     rec->visibility = YASM_SYM_LOCAL;
-    rec->size = 0;
-    rec->segment = NULL;
+    rec->has_size = 0;
     rec->assoc_data = NULL;
     return rec;
 }
 
 static /*@partial@*/ /*@dependent@*/ yasm_symrec *
-symtab_get_or_new_in_table(yasm_symtab *symtab, /*@only@*/ char *name)
+symtab_get_or_new_in_table(yasm_symtab *symtab, const char *name)
 {
-    yasm_symrec *rec = symrec_new_common(name, symtab->case_sensitive);
+    yasm_symrec *rec = yasm_symtab_get(symtab, name);
     int replace = 0;
 
-    rec->status = YASM_SYM_NOSTATUS;
+    if (rec)
+        return rec;
 
-    if (!symtab->case_sensitive) {
-        char *c;
-        for (c=name; *c; c++)
-            *c = tolower(*c);
-    }
+    rec = symrec_new_common(symtab, name);
+    rec->status = YASM_SYM_NOSTATUS;
 
-    return HAMT_insert(symtab->sym_table, name, rec, &replace,
+    return HAMT_insert(symtab->sym_table, rec->name, rec, &replace,
                        symrec_destroy_one);
 }
 
 static /*@partial@*/ /*@dependent@*/ yasm_symrec *
-symtab_get_or_new_not_in_table(yasm_symtab *symtab, /*@only@*/ char *name)
+symtab_get_or_new_not_in_table(yasm_symtab *symtab, const char *name)
 {
     non_table_symrec *sym = yasm_xmalloc(sizeof(non_table_symrec));
-    sym->rec = symrec_new_common(name, symtab->case_sensitive);
+    sym->rec = symrec_new_common(symtab, name);
 
     sym->rec->status = YASM_SYM_NOTINTABLE;
 
@@ -212,29 +336,28 @@ symtab_get_or_new_not_in_table(yasm_symtab *symtab, /*@only@*/ char *name)
 }
 
 /* create a new symrec */
-/*@-freshtrans -mustfree@*/
 static /*@partial@*/ /*@dependent@*/ yasm_symrec *
 symtab_get_or_new(yasm_symtab *symtab, const char *name, int in_table)
 {
-    char *symname = yasm__xstrdup(name);
-
+    yasm__preproc_pipe_sync();
     if (in_table)
-        return symtab_get_or_new_in_table(symtab, symname);
+        return symtab_get_or_new_in_table(symtab, name);
     else
-        return symtab_get_or_new_not_in_table(symtab, symname);
+        return symtab_get_or_new_not_in_table(symtab, name);
 }
-/*@=freshtrans =mustfree@*/
 
 int
 yasm_symtab_traverse(yasm_symtab *symtab, void *d,
                      int (*func) (yasm_symrec *sym, void *d))
 {
+    yasm__preproc_pipe_sync();
     return HAMT_traverse(symtab->sym_table, d, (int (*) (void *, void *))func);
 }
 
 const yasm_symtab_iter *
 yasm_symtab_first(const yasm_symtab *symtab)
 {
+    yasm__preproc_pipe_sync();
     return (const yasm_symtab_iter *)HAMT_first(symtab->sym_table);
 }
 
@@ -253,14 +376,23 @@ yasm_symtab_iter_value(const yasm_symtab_iter *cur)
 yasm_symrec *
 yasm_symtab_abs_sym(yasm_symtab *symtab)
 {
-    yasm_symrec *rec = symtab_get_or_new(symtab, "", 1);
-    rec->def_line = 0;
-    rec->decl_line = 0;
-    rec->use_line = 0;
-    rec->type = SYM_EQU;
-    rec->value.expn =
-        yasm_expr_create_ident(yasm_expr_int(yasm_intnum_create_uint(0)), 0);
-    rec->status |= YASM_SYM_DEFINED|YASM_SYM_VALUED|YASM_SYM_USED;
+    yasm_symrec *rec;
+
+    yasm__preproc_pipe_sync();      /* not while holding the lock */
+    SYMTAB_LOCK(symtab);
+    rec = symtab_get_or_new(symtab, "", 1);
+    if (!(rec->status & YASM_SYM_DEFINED)) {
+        rec->line = 0;
+        rec->decl_line = 0;
+        rec->type = SYM_EQU;
+        rec->value.equ = symtab_alloc(symtab, sizeof(symrec_equ));
+        rec->value.equ->expn =
+            yasm_expr_create_ident(yasm_expr_int(yasm_intnum_create_uint(0)),
+                                   0);
+        rec->value.equ->value = NULL;
+        rec->status |= YASM_SYM_DEFINED|YASM_SYM_VALUED|YASM_SYM_USED;
+    }
+    SYMTAB_UNLOCK(symtab);
     return rec;
 }
 
@@ -268,8 +400,8 @@ yasm_symrec *
 yasm_symtab_use(yasm_symtab *symtab, const char *name, unsigned long line)
 {
     yasm_symrec *rec = symtab_get_or_new(symtab, name, 1);
-    if (rec->use_line == 0)
-        rec->use_line = line;   /* set line number of first use */
+    if (!(rec->status & YASM_SYM_DEFINED) && rec->line == 0)
+        rec->line = line;       /* set line number of first use */
     rec->status |= YASM_SYM_USED;
     return rec;
 }
@@ -277,6 +409,7 @@ yasm_symtab_use(yasm_symtab *symtab, const char *name, unsigned long line)
 yasm_symrec *
 yasm_symtab_get(yasm_symtab *symtab, const char *name)
 {
+    yasm__preproc_pipe_sync();
     if (!symtab->case_sensitive) {
         char *_name = yasm__xstrdup(name);
         char *c;
@@ -298,7 +431,7 @@ symtab_define(yasm_symtab *symtab, const char *name, sym_type type,
 
     /* Has it been defined before (either by DEFINED or COMMON/EXTERN)? */
     if (rec->status & YASM_SYM_DEFINED) {
-        yasm_error_set_xref(rec->def_line!=0 ? rec->def_line : rec->decl_line,
+        yasm_error_set_xref(rec->line!=0 ? rec->line : rec->decl_line,
                             N_("`%s' previously defined here"), name);
         yasm_error_set(YASM_ERROR_GENERAL, N_("redefinition of `%s'"),
                        name);
@@ -306,11 +439,14 @@ symtab_define(yasm_symtab *symtab, const char *name, sym_type type,
         if (rec->visibility & YASM_SYM_EXTERN)
             yasm_warn_set(YASM_WARN_GENERAL,
                           N_("`%s' both defined and declared extern"), name);
-        rec->def_line = line;   /* set line number of definition */
+        rec->line = line;       /* set line number of definition */
         rec->type = type;
         rec->status |= YASM_SYM_DEFINED;
-        rec->size = 0;
-        rec->segment = NULL;
+        if (rec->has_size) {
+            symrec_size *sz = yasm_symrec_get_data(rec, &symrec_size_cb);
+            sz->size = 0;
+            sz->segment = NULL;
+        }
     }
     return rec;
 }
@@ -322,7 +458,9 @@ yasm_symtab_define_equ(yasm_symtab *symtab, const char *name, yasm_expr *e,
     yasm_symrec *rec = symtab_define(symtab, name, SYM_EQU, 1, line);
     if (yasm_error_occurred())
         return rec;
-    rec->value.expn = e;
+    rec->value.equ = symtab_alloc(symtab, sizeof(symrec_equ));
+    rec->value.equ->expn = e;
+    rec->value.equ->value = NULL;
     rec->status |= YASM_SYM_VALUED;
     return rec;
 }
@@ -345,10 +483,14 @@ yasm_symrec *
 yasm_symtab_define_curpos(yasm_symtab *symtab, const char *name,
                           yasm_bytecode *precbc, unsigned long line)
 {
-    yasm_symrec *rec = symtab_define(symtab, name, SYM_CURPOS, 0, line);
-    if (yasm_error_occurred())
-        return rec;
-    rec->value.precbc = precbc;
+    yasm_symrec *rec;
+
+    yasm__preproc_pipe_sync();      /* not while holding the lock */
+    SYMTAB_LOCK(symtab);
+    rec = symtab_define(symtab, name, SYM_CURPOS, 0, line);
+    if (!yasm_error_occurred())
+        rec->value.precbc = precbc;
+    SYMTAB_UNLOCK(symtab);
     return rec;
 }
 
@@ -397,7 +539,8 @@ yasm_symrec_declare(yasm_symrec *rec, yasm_sym_vis vis, unsigned long line)
     } else
         yasm_error_set(YASM_ERROR_GENERAL,
             N_("duplicate definition of `%s'; first defined on line %lu"),
-            rec->name, rec->def_line!=0 ? rec->def_line : rec->decl_line);
+            rec->name, yasm_symrec_get_def_line(rec)!=0 ?
+            rec->line : rec->decl_line);
 }
 
 typedef struct symtab_finalize_info {
@@ -419,9 +562,9 @@ symtab_parser_finalize_checksym(yasm_symrec *sym, /*@null@*/ void *d)
         else {
             yasm_error_set(YASM_ERROR_GENERAL,
                            N_("undefined symbol `%s' (first use)"), sym->name);
-            yasm_errwarn_propagate(info->errwarns, sym->use_line);
-            if (sym->use_line < info->firstundef_line)
-                info->firstundef_line = sym->use_line;
+            yasm_errwarn_propagate(info->errwarns, sym->line);
+            if (sym->line < info->firstundef_line)
+                info->firstundef_line = sym->line;
         }
     }
 
@@ -456,6 +599,15 @@ yasm_symtab_destroy(yasm_symtab *symtab)
         yasm_xfree(sym);
     }
 
+    while (symtab->blocks) {
+        symtab_block *block = symtab->blocks;
+        symtab->blocks = block->next;
+        yasm_xfree(block);
+    }
+
+#ifdef YASM_THREADS
+    pthread_mutex_destroy(&symtab->mutex);
+#endif
     yasm_xfree(symtab);
 }
 
@@ -509,19 +661,19 @@ yasm_symrec_get_global_name(const yasm_symrec *sym, const yasm_object *object)
 yasm_sym_vis
 yasm_symrec_get_visibility(const yasm_symrec *sym)
 {
-    return sym->visibility;
+    return (yasm_sym_vis)sym->visibility;
 }
 
 yasm_sym_status
 yasm_symrec_get_status(const yasm_symrec *sym)
 {
-    return sym->status;
+    return (yasm_sym_status)sym->status;
 }
 
 unsigned long
 yasm_symrec_get_def_line(const yasm_symrec *sym)
 {
-    return sym->def_line;
+    return (sym->status & YASM_SYM_DEFINED) ? sym->line : 0;
 }
 
 unsigned long
@@ -533,17 +685,39 @@ yasm_symrec_get_decl_line(const yasm_symrec *sym)
 unsigned long
 yasm_symrec_get_use_line(const yasm_symrec *sym)
 {
-    return sym->use_line;
+    return (sym->status & YASM_SYM_DEFINED) ? 0 : sym->line;
 }
 
 const yasm_expr *
 yasm_symrec_get_equ(const yasm_symrec *sym)
 {
     if (sym->type == SYM_EQU && (sym->status & YASM_SYM_VALUED))
-        return sym->value.expn;
+        return sym->value.equ->expn;
     return (const yasm_expr *)NULL;
 }
 
+const yasm_intnum *
+yasm_symrec_get_equ_value(const yasm_symrec *sym)
+{
+    if (sym->type == SYM_EQU && (sym->status & YASM_SYM_VALUED))
+        return sym->value.equ->value;
+    return (const yasm_intnum *)NULL;
+}
+
+void
+yasm_symrec_set_equ_value(yasm_symrec *sym, yasm_intnum *value)
+{
+    if (!(sym->type == SYM_EQU && (sym->status & YASM_SYM_VALUED))) {
+        /* Nothing to cache it for */
+        if (value)
+            yasm_intnum_destroy(value);
+        return;
+    }
+    if (sym->value.equ->value)
+        yasm_intnum_destroy(sym->value.equ->value);
+    sym->value.equ->value = value;
+}
+
 int
 yasm_symrec_get_label(const yasm_symrec *sym,
                       yasm_symrec_get_label_bytecodep *precbc)
@@ -557,34 +731,63 @@ yasm_symrec_get_label(const yasm_symrec *sym,
     return 1;
 }
 
+/* Get the user-defined size and segment of a symbol, adding them if
+ * needed.
+ */
+static symrec_size *
+symrec_get_size_data(yasm_symrec *sym)
+{
+    symrec_size *sz;
+
+    if (sym->has_size)
+        return yasm_symrec_get_data(sym, &symrec_size_cb);
+    sz = yasm_xmalloc(sizeof(symrec_size));
+    sz->size = 0;
+    sz->segment = NULL;
+    yasm_assoc_data_register(&symrec_size_cb);
+    yasm_symrec_add_data(sym, &symrec_size_cb, sz);
+    sym->has_size = 1;
+    return sz;
+}
+
 void
 yasm_symrec_set_size(yasm_symrec *sym, int size)
 {
-    sym->size = size;
+    if (size == 0 && !sym->has_size)
+        return;
+    symrec_get_size_data(sym)->size = size;
 }
 
 int
 yasm_symrec_get_size(const yasm_symrec *sym)
 {
-    return sym->size;
+    if (!sym->has_size)
+        return 0;
+    return ((symrec_size *)yasm__assoc_data_get(sym->assoc_data,
+                                                &symrec_size_cb))->size;
 }
 
 void
 yasm_symrec_set_segment(yasm_symrec *sym, const char *segment)
 {
-    sym->segment = segment;
+    if (!segment && !sym->has_size)
+        return;
+    symrec_get_size_data(sym)->segment = segment;
 }
 
 const char *
 yasm_symrec_get_segment(const yasm_symrec *sym)
 {
-    return sym->segment;
+    if (!sym->has_size)
+        return NULL;
+    return ((symrec_size *)yasm__assoc_data_get(sym->assoc_data,
+                                                &symrec_size_cb))->segment;
 }
 
 int
 yasm_symrec_is_abs(const yasm_symrec *sym)
 {
-    return (sym->def_line == 0 && sym->type == SYM_EQU &&
+    return (sym->line == 0 && sym->type == SYM_EQU &&
             sym->name[0] == '\0');
 }
 
@@ -604,6 +807,7 @@ void
 yasm_symrec_set_objext_valparams(yasm_symrec *sym,
                                  /*@only@*/ yasm_valparamhead *objext_valparams)
 {
+    yasm_assoc_data_register(&objext_valparams_cb);
     yasm_symrec_add_data(sym, &objext_valparams_cb, objext_valparams);
 }
 
@@ -619,6 +823,7 @@ yasm_symrec_set_common_size(yasm_symrec *sym,
 {
     yasm_expr **ep = yasm_xmalloc(sizeof(yasm_expr *));
     *ep = common_size;
+    yasm_assoc_data_register(&common_size_cb);
     yasm_symrec_add_data(sym, &common_size_cb, ep);
 }
 
@@ -653,7 +858,7 @@ yasm_symrec_print(const yasm_symrec *sym, FILE *f, int indent_level)
             fprintf(f, "%*s_EQU_\n", indent_level, "");
             fprintf(f, "%*sExpn=", indent_level, "");
             if (sym->status & YASM_SYM_VALUED)
-                yasm_expr_print(sym->value.expn, f);
+                yasm_expr_print(sym->value.equ->expn, f);
             else
                 fprintf(f, "***UNVALUED***");
             fprintf(f, "\n");
@@ -707,8 +912,9 @@ yasm_symrec_print(const yasm_symrec *sym, FILE *f, int indent_level)
     }
 
     fprintf(f, "%*sLine Index (Defined)=%lu\n", indent_level, "",
-            sym->def_line);
+            yasm_symrec_get_def_line(sym));
     fprintf(f, "%*sLine Index (Declared)=%lu\n", indent_level, "",
             sym->decl_line);
-    fprintf(f, "%*sLine Index (Used)=%lu\n", indent_level, "", sym->use_line);
+    fprintf(f, "%*sLine Index (Used)=%lu\n", indent_level, "",
+            yasm_symrec_get_use_line(sym));
 }
@@ -282,7 +282,7 @@ yasm_sym_status yasm_symrec_get_status(const yasm_symrec *sym);
 
 /** Get the virtual line of where a symbol was first defined.
  * \param sym       symbol
- * \return line     virtual line
+ * \return line     virtual line (0 if not defined)
  */
 YASM_LIB_DECL
 unsigned long yasm_symrec_get_def_line(const yasm_symrec *sym);
@@ -294,9 +294,11 @@ unsigned long yasm_symrec_get_def_line(const yasm_symrec *sym);
 YASM_LIB_DECL
 unsigned long yasm_symrec_get_decl_line(const yasm_symrec *sym);
 
-/** Get the virtual line of where a symbol was first used.
+/** Get the virtual line of where a symbol was first used.  This is only
+ * kept until the symbol is defined, as it's only needed to report the
+ * symbol as undefined.
  * \param sym       symbol
- * \return line     virtual line
+ * \return line     virtual line (0 if the symbol has been defined)
  */
 YASM_LIB_DECL
 unsigned long yasm_symrec_get_use_line(const yasm_symrec *sym);
@@ -309,6 +311,25 @@ YASM_LIB_DECL
 /*@observer@*/ /*@null@*/ const yasm_expr *yasm_symrec_get_equ
     (const yasm_symrec *sym);
 
+/** Get the cached constant value of an EQU symbol.  This is set by
+ * yasm_expr__level_tree() the first time the EQU expression folds to an
+ * integer, so later uses don't need to copy and re-simplify the expression.
+ * \param sym       symbol
+ * \return Folded EQU value, or NULL if not known.
+ */
+YASM_LIB_DECL
+/*@observer@*/ /*@null@*/ const yasm_intnum *yasm_symrec_get_equ_value
+    (const yasm_symrec *sym);
+
+/** Set (or clear) the cached constant value of an EQU symbol.  The cache is
+ * also cleared when the symbol's EQU expression is set.
+ * \param sym       symbol
+ * \param value     folded EQU value (kept, may be NULL)
+ */
+YASM_LIB_DECL
+void yasm_symrec_set_equ_value(yasm_symrec *sym,
+                               /*@null@*/ /*@only@*/ yasm_intnum *value);
+
 /** Dependent pointer to a bytecode. */
 typedef /*@dependent@*/ yasm_bytecode *yasm_symrec_get_label_bytecodep;
 
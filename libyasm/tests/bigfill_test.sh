@@ -0,0 +1,99 @@
+#! /bin/sh
+# Repeated data is written without generating every copy (and zeros are
+# seeked over), so gigabytes of TIMES/reserve output must assemble within
+# a small address space.
+
+YASM_TEST_SUITE=1
+export YASM_TEST_SUITE
+
+# Needs a 64-bit long for multi-gigabyte file offsets.
+if test "`getconf LONG_BIT 2>/dev/null`" != "64"; then
+    echo "Test bigfill: skipped"
+    exit 77
+fi
+
+mkdir results >/dev/null 2>&1
+rm -f results/bigfill.bin
+
+(ulimit -v 131072 >/dev/null 2>&1; ./yasm -f bin -o results/bigfill.bin - \
+    2>results/bigfill.ew) <<'EOF_ASM'
+section .data
+db 1
+times 0x30000000 dd 0
+db 2
+times 0x800000 dw 0x5aa5
+resq 0x10000000
+db 3
+EOF_ASM
+status=$?
+
+byte_at() {
+    dd if=results/bigfill.bin bs=1 skip=$1 count=$2 2>/dev/null | \
+        od -An -tx1 | tr -d ' \n'
+}
+
+failed=""
+if test $status -ne 0; then
+    failed="returned an error code"
+elif test "`wc -c < results/bigfill.bin | tr -d ' '`" != "5385486339"; then
+    failed="output size mismatch"
+elif test "`byte_at 0 1`" != "01" || \
+     test "`byte_at 3221225473 5`" != "02a55aa55a" || \
+     test "`byte_at 3238002688 2`" != "a55a" || \
+     test "`byte_at 5385486338 1`" != "03"; then
+    failed="output contents mismatch"
+fi
+rm -f results/bigfill.bin
+
+# Formats that otherwise build sections in memory (rdf, and elf and coff
+# with --presize-output) must stream large sections the same way.
+cat > results/bigfill2.asm <<'EOF_ASM'
+section .data
+db 1
+times 0x4000000 dd 0
+db 2
+times 0x100000 dw 0x5aa5
+resq 0x1000000
+db 3
+EOF_ASM
+
+bigfill2() {
+    (ulimit -v 131072 >/dev/null 2>&1; ./yasm "$@" results/bigfill2.asm \
+        2>results/bigfill.ew)
+}
+
+if test -z "$failed"; then
+    for fmt in elf64 win64; do
+        rm -f results/bigfill.o results/bigfill-p.o
+        if ! bigfill2 -f $fmt -o results/bigfill.o || \
+           ! bigfill2 -f $fmt --presize-output -o results/bigfill-p.o; then
+            failed="$fmt returned an error code"
+        elif ! cmp -s results/bigfill.o results/bigfill-p.o; then
+            failed="$fmt --presize-output output mismatch"
+        fi
+        rm -f results/bigfill.o results/bigfill-p.o
+        test -n "$failed" && break
+    done
+fi
+
+if test -z "$failed"; then
+    rm -f results/bigfill.bin
+    if ! bigfill2 -f rdf -o results/bigfill.bin; then
+        failed="rdf returned an error code"
+    elif test "`wc -c < results/bigfill.bin | tr -d ' '`" != "404750373"; then
+        failed="rdf output size mismatch"
+    elif test "`byte_at 24 1`" != "01" || \
+         test "`byte_at 268435481 5`" != "02a55aa55a" || \
+         test "`byte_at 404750362 1`" != "03"; then
+        failed="rdf output contents mismatch"
+    fi
+    rm -f results/bigfill.bin
+fi
+rm -f results/bigfill2.asm
+
+if test -n "$failed"; then
+    echo "Test bigfill: FAIL ($failed)"
+    exit 1
+fi
+echo "Test bigfill: +1-0/1 100%"
+exit 0
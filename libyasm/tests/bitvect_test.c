@@ -140,6 +140,123 @@ test_oct_large_num(void)
     return 0;
 }
 
+/* Multiplication and division of vectors of up to 256 bits use word-level
+ * kernels; larger vectors use the original bit-serial loops.  Check that
+ * both give the same results on random operands of random lengths.
+ */
+#define ARITH_CASES     4000
+
+static wordptr ax, ay, aq, ar, bx, by, bq, br, bt;
+
+static void
+arith_setup(void)
+{
+    BitVector_Boot();
+    ax = BitVector_Create(256, FALSE);
+    ay = BitVector_Create(256, FALSE);
+    aq = BitVector_Create(256, FALSE);
+    ar = BitVector_Create(256, FALSE);
+    bx = BitVector_Create(512, FALSE);
+    by = BitVector_Create(512, FALSE);
+    bq = BitVector_Create(512, FALSE);
+    br = BitVector_Create(512, FALSE);
+    bt = BitVector_Create(512, FALSE);
+    srand(1);
+}
+
+static void
+arith_teardown(void)
+{
+    BitVector_Destroy(ax);
+    BitVector_Destroy(ay);
+    BitVector_Destroy(aq);
+    BitVector_Destroy(ar);
+    BitVector_Destroy(bx);
+    BitVector_Destroy(by);
+    BitVector_Destroy(bq);
+    BitVector_Destroy(br);
+    BitVector_Destroy(bt);
+}
+
+/* Random value of 1 to 255 bits and random sign; chunks are biased towards
+ * all-zero and all-one patterns to exercise quotient digit correction.
+ */
+static void
+random_value(wordptr v)
+{
+    unsigned int len = 1 + rand() % 255, i;
+    N_long chunk;
+
+    BitVector_Empty(v);
+    for (i = 0; i < len; i += 16) {
+        switch (rand() % 4) {
+            case 0: chunk = 0; break;
+            case 1: chunk = 0xFFFF; break;
+            default: chunk = (N_long)(rand() & 0xFFFF); break;
+        }
+        if (len - i < 16)
+            chunk &= (1UL << (len - i)) - 1;
+        BitVector_Chunk_Store(v, 16, i, chunk);
+    }
+    if (rand() % 2)
+        BitVector_Negate(v, v);
+}
+
+/* Is the 512-bit vector a equal to the sign-extended 256-bit vector b? */
+static int
+same_value(wordptr a, wordptr b)
+{
+    BitVector_Copy(bt, b);
+    return BitVector_equal(a, bt);
+}
+
+static int
+test_mul_div(void)
+{
+    int i;
+    ErrCode err;
+    charptr s1, s2;
+
+    for (i = 0; i < ARITH_CASES; i++) {
+        random_value(ax);
+        random_value(ay);
+        BitVector_Copy(bx, ax);
+        BitVector_Copy(by, ay);
+
+        err = BitVector_Multiply(aq, ax, ay);
+        if (BitVector_Multiply(bq, bx, by) != ErrCode_Ok)
+            return 1;
+        if (err == ErrCode_Ok) {
+            if (!same_value(bq, aq))
+                return 1;
+        } else {
+            /* 256-bit overflow: magnitude must need more than 255 bits */
+            if (err != ErrCode_Ovfl)
+                return 1;
+            if (BitVector_Sign(bq) < 0)
+                BitVector_Negate(bq, bq);
+            if (Set_Max(bq) < 255)
+                return 1;
+        }
+
+        if (BitVector_is_empty(ay))
+            continue;
+        if (BitVector_Divide(aq, ax, ay, ar) != ErrCode_Ok ||
+            BitVector_Divide(bq, bx, by, br) != ErrCode_Ok)
+            return 1;
+        if (!same_value(bq, aq) || !same_value(br, ar))
+            return 1;
+
+        s1 = BitVector_to_Dec(ax);
+        s2 = BitVector_to_Dec(bx);
+        if (strcmp((char *)s1, (char *)s2) != 0)
+            return 1;
+        BitVector_Dispose(s1);
+        BitVector_Dispose(s2);
+    }
+    return 0;
+}
+
 char failed[1000];
 
 static int
@@ -170,7 +287,8 @@ main(void)
     nf += runtest(boot, NULL, NULL);
     nf += runtest(oct_small_num, num_family_setup, num_family_teardown);
     nf += runtest(oct_large_num, num_family_setup, num_family_teardown);
-    printf(" +%d-%d/3 %d%%\n%s",
-           3-nf, nf, 100*(3-nf)/3, failed);
+    nf += runtest(mul_div, arith_setup, arith_teardown);
+    printf(" +%d-%d/4 %d%%\n%s",
+           4-nf, nf, 100*(4-nf)/4, failed);
     return (nf == 0) ? EXIT_SUCCESS : EXIT_FAILURE;
 }
@@ -0,0 +1,54 @@
+#! /bin/sh
+# Switching among many sections must find each one by name without
+# scanning all of them: create 100000 sections, then re-enter each one
+# (XDF, as it has 32-bit section numbers).
+
+YASM_TEST_SUITE=1
+export YASM_TEST_SUITE
+
+mkdir results >/dev/null 2>&1
+rm -f results/manysect.xdf
+
+(ulimit -t 60 >/dev/null 2>&1; ./yasm -f xdf -o results/manysect.xdf - \
+    2>results/manysect.ew) <<'EOF_ASM'
+%assign i 0
+%rep 100000
+section .text.fn_ %+ i
+db i & 0xff
+%assign i i+1
+%endrep
+%assign i 0
+%rep 100000
+section .text.fn_ %+ i
+db (i >> 8) & 0xff
+%assign i i+1
+%endrep
+EOF_ASM
+status=$?
+
+bytes() {
+    od -An -tx1 | tr -d ' \n'
+}
+
+# 100001 sections (including the default .text); section data is output
+# last, in order, so the file ends with the two bytes of each of the last
+# sections.
+failed=""
+if test $status -ne 0; then
+    failed="returned an error code"
+elif test "`dd if=results/manysect.xdf bs=1 skip=4 count=4 2>/dev/null | \
+        bytes`" != "a1860100"; then
+    failed="section count mismatch"
+elif test "`tail -c 8 results/manysect.xdf | bytes`" != "9c869d869e869f86"; then
+    failed="section contents mismatch"
+elif test -s results/manysect.ew; then
+    failed="unexpected errors or warnings"
+fi
+rm -f results/manysect.xdf
+
+if test -n "$failed"; then
+    echo "Test manysect: FAIL ($failed)"
+    exit 1
+fi
+echo "Test manysect: +1-0/1 100%"
+exit 0
@@ -0,0 +1,3 @@
+#! /bin/sh
+${srcdir}/out_test.sh libyasm_test libyasm/tests/maxdiag "libyasm" "--max-diagnostics=3 -f bin" ""
+exit $?
@@ -0,0 +1,8 @@
+section .text
+section .data
+db 300
+db 301
+section .text
+db 302
+db 303
+db 304
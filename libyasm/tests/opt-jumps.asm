@@ -0,0 +1,40 @@
+; Relative jumps in sections no general span depends on are relaxed apart
+; from the other spans; check both paths and that expansions cascade.
+bits 32
+
+section .text
+a1:	jmp	a3		; only long once a2 is
+a2:	jz	a4
+	times 124 nop
+a3:	jmp	a1
+	times 100 nop
+a4:	jnc	a2		; only long once a5 is
+	times 120 nop
+a5:	call	a1
+	jmp	a5
+	jmp	short a5
+
+section .text2
+; align makes this section go through the general spans
+b1:	jmp	b3
+b2:	jz	b4
+	times 124 nop
+b3:	times 30 nop
+	align	16
+	times 100 nop
+b4:	jmp	b1
+
+section .text3
+; referenced from .data and an EQU, so also through the general spans
+c1:	jmp	c3
+c2:	jz	c4
+	times 124 nop
+c3:	times 130 nop
+c4:	jmp	c1
+c5:
+
+clen	equ	c5 - c4
+
+section .data
+	dd	c2 - c1
+	db	clen
@@ -0,0 +1,131 @@
+#! /bin/sh
+# Size hints saved by one run must reproduce its output when used again (also
+# with --verify-size-hints), and when used on an edited source must only be
+# applied where they still fit; checking them must then find the jz too far.
+
+YASM_TEST_SUITE=1
+export YASM_TEST_SUITE
+
+mkdir results >/dev/null 2>&1
+rm -f results/sizehints.hints
+
+# With -DLONG more is out of short range.  Without it, the hinted spans
+# stay expanded, the hint for the now forced short jump is ignored, and the
+# jz (not hinted) still has to be made near.
+cat >results/sizehints.asm <<'EOF_ASM'
+bits 32
+%ifdef LONG
+%define PAD1 130
+%define PAD2 10
+%define J jmp
+%else
+%define PAD1 10
+%define PAD2 200
+%define J jmp short
+%endif
+a1:	jmp	a2
+	times PAD1 nop
+a2:	J	a3
+	times PAD1 nop
+a3:	jz	a4
+	times PAD2 nop
+a4:	add	ebx, a2 - a1
+	ret
+EOF_ASM
+
+# Output bytes in hex, with each run of NOPs shown as a space
+bytes() {
+    od -An -v -tx1 results/$1 | tr -s ' \n' '\n\n' | awk '
+        $0 == "90" { if (!nop) printf " "; nop = 1; next }
+        { printf "%s", $0; nop = 0 }'
+}
+
+failed=""
+if ! ./yasm -f bin -DLONG -o results/sizehints-long.bin \
+        --save-size-hints=results/sizehints.hints results/sizehints.asm \
+        2>results/sizehints.ew; then
+    failed="saving hints returned an error code"
+elif ! ./yasm -f bin -DLONG -o results/sizehints-long2.bin \
+        --size-hints=results/sizehints.hints results/sizehints.asm \
+        2>results/sizehints.ew; then
+    failed="using hints returned an error code"
+elif ! cmp results/sizehints-long.bin results/sizehints-long2.bin \
+        >/dev/null; then
+    failed="output with hints differs"
+elif ! ./yasm -f bin -DLONG -o results/sizehints-long3.bin \
+        --size-hints=results/sizehints.hints --verify-size-hints \
+        results/sizehints.asm 2>results/sizehints.ew; then
+    failed="verifying hints returned an error code"
+elif ! cmp results/sizehints-long.bin results/sizehints-long3.bin \
+        >/dev/null; then
+    failed="output with verified hints differs"
+elif ./yasm -f bin -o results/sizehints-verify.bin \
+        --size-hints=results/sizehints.hints --verify-size-hints \
+        results/sizehints.asm 2>results/sizehints-verify.ew; then
+    failed="verifying stale hints did not return an error code"
+elif test "`grep -c 'out of range' results/sizehints-verify.ew`" != 1 \
+        || ! grep ':15:' results/sizehints-verify.ew >/dev/null; then
+    failed="verifying stale hints did not find the jz"
+elif ! ./yasm -f bin -o results/sizehints.bin \
+        --size-hints=results/sizehints.hints results/sizehints.asm \
+        2>results/sizehints.ew; then
+    failed="using stale hints returned an error code"
+elif test "`bytes sizehints.bin`" != \
+        "e90a000000 eb0a 0f84c8000000 81c30f000000c3"; then
+    failed="output with stale hints mismatch"
+elif test -s results/sizehints.ew; then
+    failed="unexpected errors or warnings"
+fi
+
+# Verifying needs hints to verify: without a readable, valid hints file it
+# must fail rather than check against the shortest sizes.
+echo "not size hints" >results/sizehints-bad.hints
+rm -f results/sizehints-missing.hints
+
+if test -n "$failed"; then
+    :
+elif ./yasm -f bin -o results/sizehints-verify.bin --verify-size-hints \
+        results/sizehints.asm 2>results/sizehints-verify.ew; then
+    failed="verifying without --size-hints did not return an error code"
+elif ./yasm -f bin -o results/sizehints-verify.bin \
+        --size-hints=results/sizehints-missing.hints --verify-size-hints \
+        results/sizehints.asm 2>results/sizehints-verify.ew; then
+    failed="verifying a missing hints file did not return an error code"
+elif ./yasm -f bin -o results/sizehints-verify.bin \
+        --size-hints=results/sizehints-bad.hints --verify-size-hints \
+        results/sizehints.asm 2>results/sizehints-verify.ew; then
+    failed="verifying an invalid hints file did not return an error code"
+elif ! grep 'not a valid size hints file' results/sizehints-verify.ew \
+        >/dev/null; then
+    failed="verifying an invalid hints file did not report it"
+fi
+
+# Hints are keyed by source line, which %line can make arbitrarily large.
+cat >results/sizehints-line.asm <<'EOF_ASM'
+%line 2000000000+1 sizehints-line.asm
+a1:	jmp	a2
+	times 200 nop
+a2:	jmp	a1
+EOF_ASM
+
+if test -n "$failed"; then
+    :
+elif ! ./yasm -f bin -o results/sizehints-line.bin \
+        --save-size-hints=results/sizehints-line.hints \
+        results/sizehints-line.asm 2>results/sizehints.ew; then
+    failed="saving hints for large line numbers returned an error code"
+elif ! ./yasm -f bin -o results/sizehints-line2.bin \
+        --size-hints=results/sizehints-line.hints \
+        results/sizehints-line.asm 2>results/sizehints.ew; then
+    failed="using hints for large line numbers returned an error code"
+elif ! cmp results/sizehints-line.bin results/sizehints-line2.bin \
+        >/dev/null; then
+    failed="output with hints for large line numbers differs"
+fi
+
+if test -n "$failed"; then
+    echo "Test sizehints: FAIL ($failed)"
+    exit 1
+fi
+echo "Test sizehints: +1-0/1 100%"
+exit 0
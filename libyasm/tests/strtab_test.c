@@ -0,0 +1,152 @@
+/*
+ *
+ *  Copyright (C) 2026  Yasm developers
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR AND OTHER CONTRIBUTORS ``AS IS''
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE AUTHOR OR OTHER CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "util.h"
+#include "libyasm/coretype.h"
+#include "libyasm/strtab.h"
+
+typedef struct Test_Entry {
+    /* offset of first string */
+    unsigned long base;
+
+    /* whether to merge tails */
+    int merge_tails;
+
+    /* strings added, NULL-terminated */
+    const char *strs[8];
+
+    /* correct offset of each string */
+    unsigned long offsets[8];
+
+    /* correct table contents */
+    const char *result;
+
+    /* correct table size */
+    unsigned long result_len;
+} Test_Entry;
+
+static Test_Entry tests[] = {
+    /* Duplicates share one string */
+    {4, 0, {"abc", "defg", "abc", NULL}, {4, 8, 4}, "abc\0defg", 9},
+    /* Tails are not merged unless asked for */
+    {0, 0, {"", ".text", ".rela.text", NULL}, {0, 1, 7},
+     "\0.text\0.rela.text", 18},
+    /* The empty string stays first; later tails point into earlier strings */
+    {0, 1, {"", ".text", ".rela.text", ".data", "xt", ".text", NULL},
+     {0, 6, 1, 12, 9, 6}, "\0.rela.text\0.data", 18},
+    /* Tails of tails, and strings sharing a tail but not ending each other */
+    {0, 1, {"a.b.c", "b.c", "c", "x.b.c", NULL}, {0, 2, 4, 6},
+     "a.b.c\0x.b.c", 12},
+    {1, 1, {"abc", NULL}, {1}, "abc", 4},
+};
+
+static char failed[1000];
+static char failmsg[100];
+
+static int
+run_test(Test_Entry *test)
+{
+    yasm_strtab *strtab = yasm_strtab_create(test->base, test->merge_tails);
+    unsigned long indices[8], len;
+    char out[64];
+    FILE *f;
+    int i;
+
+    for (i=0; test->strs[i]; i++)
+        indices[i] = yasm_strtab_add(strtab, test->strs[i]);
+    for (i=0; test->strs[i]; i++) {
+        if (strcmp(test->strs[i], test->strs[indices[i]]) != 0) {
+            sprintf(failmsg, "\"%s\" got index of \"%s\"!", test->strs[i],
+                    test->strs[indices[i]]);
+            yasm_strtab_destroy(strtab);
+            return 1;
+        }
+    }
+
+    len = yasm_strtab_finalize(strtab);
+    if (len != test->result_len) {
+        sprintf(failmsg, "bad table size: expected %lu, got %lu!",
+                test->result_len, len);
+        yasm_strtab_destroy(strtab);
+        return 1;
+    }
+
+    for (i=0; test->strs[i]; i++) {
+        unsigned long offset = yasm_strtab_get_offset(strtab, indices[i]);
+        if (offset != test->offsets[i]) {
+            sprintf(failmsg, "\"%s\" bad offset: expected %lu, got %lu!",
+                    test->strs[i], test->offsets[i], offset);
+            yasm_strtab_destroy(strtab);
+            return 1;
+        }
+    }
+
+    f = tmpfile();
+    if (!f) {
+        sprintf(failmsg, "could not open temporary file!");
+        yasm_strtab_destroy(strtab);
+        return 1;
+    }
+    len = yasm_strtab_output(strtab, f);
+    yasm_strtab_destroy(strtab);
+    rewind(f);
+    if (len != test->result_len ||
+        fread(out, 1, sizeof(out), f) != (size_t)len ||
+        memcmp(out, test->result, len) != 0) {
+        sprintf(failmsg, "bad table contents!");
+        fclose(f);
+        return 1;
+    }
+    fclose(f);
+
+    return 0;
+}
+
+int
+main(void)
+{
+    int nf = 0;
+    int numtests = sizeof(tests)/sizeof(Test_Entry);
+    int i;
+
+    failed[0] = '\0';
+    printf("Test strtab_test: ");
+    for (i=0; i<numtests; i++) {
+        int fail = run_test(&tests[i]);
+        printf("%c", fail>0 ? 'F':'.');
+        fflush(stdout);
+        if (fail)
+            sprintf(failed, "%s ** F: %s\n", failed, failmsg);
+        nf += fail;
+    }
+
+    printf(" +%d-%d/%d %d%%\n%s",
+           numtests-nf, nf, numtests, 100*(numtests-nf)/numtests, failed);
+    return (nf == 0) ? EXIT_SUCCESS : EXIT_FAILURE;
+}
@@ -0,0 +1,9 @@
+db 0xaa
+times 5 db 1, 2, 3
+times 3 dw 0x1234
+x: times 2 dw x
+times 3 dw $-x
+times 4 db 0
+times 0 db 9
+times 7 dd 0x89abcdef
+db 0x55
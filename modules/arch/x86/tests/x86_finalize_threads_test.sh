@@ -0,0 +1,3 @@
+#! /bin/sh
+${srcdir}/out_test.sh x86_finalize_threads_test modules/arch/x86/tests "x86 arch finalized on threads" "-f bin --finalize-threads=4" "" "threads-"
+exit $?
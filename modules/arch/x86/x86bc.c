@@ -31,6 +31,15 @@
 #include "x86arch.h"
 
 
+/* Instruction whose encoding is fully known at finalize time: no memory
+ * operand and either no immediate or a constant one.  The instruction is
+ * encoded once and only the bytes are kept.
+ */
+typedef struct x86_insn_resolved {
+    unsigned char len;
+    unsigned char bytes[15];
+} x86_insn_resolved;
+
 /* Bytecode callback function prototypes */
 
 static void x86_bc_insn_destroy(void *contents);
@@ -49,6 +58,17 @@ static int x86_bc_insn_tobytes(yasm_bytecode *bc, unsigned char **bufp,
 
 static void x86_bc_jmp_destroy(void *contents);
 static void x86_bc_jmp_print(const void *contents, FILE *f, int indent_level);
+static void x86_bc_insn_resolved_destroy(void *contents);
+static void x86_bc_insn_resolved_print(const void *contents, FILE *f,
+                                       int indent_level);
+static int x86_bc_insn_resolved_calc_len(yasm_bytecode *bc,
+                                         yasm_bc_add_span_func add_span,
+                                         void *add_span_data);
+static int x86_bc_insn_resolved_tobytes
+    (yasm_bytecode *bc, unsigned char **bufp, unsigned char *bufstart,
+     void *d, yasm_output_value_func output_value,
+     /*@null@*/ yasm_output_reloc_func output_reloc);
+
 static int x86_bc_jmp_calc_len(yasm_bytecode *bc,
                                yasm_bc_add_span_func add_span,
                                void *add_span_data);
@@ -84,6 +104,17 @@ static const yasm_bytecode_callback x86_bc_callback_insn = {
     0
 };
 
+static const yasm_bytecode_callback x86_bc_callback_insn_resolved = {
+    x86_bc_insn_resolved_destroy,
+    x86_bc_insn_resolved_print,
+    yasm_bc_finalize_common,
+    NULL,
+    x86_bc_insn_resolved_calc_len,
+    yasm_bc_expand_common,
+    x86_bc_insn_resolved_tobytes,
+    0
+};
+
 static const yasm_bytecode_callback x86_bc_callback_jmp = {
     x86_bc_jmp_destroy,
     x86_bc_jmp_print,
@@ -138,10 +169,78 @@ yasm_x86__set_rex_from_reg(unsigned char *rex, unsigned char *low3,
     return 0;
 }
 
+static int
+x86_value_is_const(yasm_value *value)
+{
+    return !value->rel && !value->wrt && !value->seg_of && !value->rshift &&
+        !value->curpos_rel && !value->ip_rel && !value->section_rel &&
+        (!value->abs || yasm_expr_get_intnum(&value->abs, 0));
+}
+
+static void
+x86_resolve_add_span(void *add_span_data, yasm_bytecode *bc, int id,
+                     const yasm_value *value, long neg_thres, long pos_thres)
+{
+    *((int *)add_span_data) = 1;
+}
+
+static int
+x86_resolve_output_value(yasm_value *value, unsigned char *buf,
+                         unsigned int destsize, unsigned long offset,
+                         yasm_bytecode *bc, int warn, void *d)
+{
+    return yasm_value_output_basic(value, buf, destsize, bc, warn,
+                                   (yasm_arch *)d) != 1;
+}
+
+/* Encode insn right away if its length and bytes can't change anymore, and
+ * replace it with the resolved form.  Most register-only and constant
+ * immediate instructions qualify, and this saves the optimizer and output
+ * passes from recomputing them and frees the effective address and
+ * immediate value.
+ */
+static void
+x86_bc_insn_resolve(yasm_bytecode *bc, x86_insn *insn)
+{
+    x86_insn_resolved *resolved;
+    unsigned char buf[32];
+    unsigned char *bufp = buf;
+    unsigned long len;
+    int need_span = 0;
+
+    if (yasm_error_occurred() || !bc->section)
+        return;
+    if (insn->x86_ea &&
+        (insn->x86_ea->ea.need_disp || insn->x86_ea->ea.disp.abs))
+        return;
+    if (insn->imm && !x86_value_is_const(insn->imm))
+        return;
+
+    len = bc->len;
+    bc->len = 0;
+    if (x86_bc_insn_calc_len(bc, x86_resolve_add_span, &need_span) != 0 ||
+        need_span || bc->len > sizeof(resolved->bytes) ||
+        x86_bc_insn_tobytes(bc, &bufp, buf,
+                            yasm_section_get_object(bc->section)->arch,
+                            x86_resolve_output_value, NULL) != 0) {
+        bc->len = len;
+        return;
+    }
+    if ((unsigned long)(bufp-buf) != bc->len)
+        yasm_internal_error(N_("x86: resolved instruction length mismatch"));
+
+    resolved = yasm_xmalloc(sizeof(x86_insn_resolved));
+    resolved->len = (unsigned char)bc->len;
+    memcpy(resolved->bytes, buf, bc->len);
+    bc->len = len;
+    yasm_bc_transform(bc, &x86_bc_callback_insn_resolved, resolved);
+}
+
 void
 yasm_x86__bc_transform_insn(yasm_bytecode *bc, x86_insn *insn)
 {
     yasm_bc_transform(bc, &x86_bc_callback_insn, insn);
+    x86_bc_insn_resolve(bc, insn);
 }
 
 void
@@ -367,6 +466,12 @@ x86_bc_insn_destroy(void *contents)
     yasm_xfree(contents);
 }
 
+static void
+x86_bc_insn_resolved_destroy(void *contents)
+{
+    yasm_xfree(contents);
+}
+
 static void
 x86_bc_jmp_destroy(void *contents)
 {
@@ -462,6 +567,19 @@ x86_bc_insn_print(const void *contents, FILE *f, int indent_level)
             (unsigned int)insn->postop);
 }
 
+static void
+x86_bc_insn_resolved_print(const void *contents, FILE *f, int indent_level)
+{
+    const x86_insn_resolved *resolved = (const x86_insn_resolved *)contents;
+    unsigned int i;
+
+    fprintf(f, "%*s_Instruction (resolved)_\n", indent_level, "");
+    fprintf(f, "%*sBytes:", indent_level, "");
+    for (i=0; i<resolved->len; i++)
+        fprintf(f, " %02x", (unsigned int)resolved->bytes[i]);
+    fprintf(f, "\n");
+}
+
 static void
 x86_bc_jmp_print(const void *contents, FILE *f, int indent_level)
 {
@@ -684,6 +802,15 @@ x86_bc_insn_expand(yasm_bytecode *bc, int span, long old_val, long new_val,
     return 0;
 }
 
+static int
+x86_bc_insn_resolved_calc_len(yasm_bytecode *bc,
+                              yasm_bc_add_span_func add_span,
+                              void *add_span_data)
+{
+    bc->len += ((x86_insn_resolved *)bc->contents)->len;
+    return 0;
+}
+
 static int
 x86_bc_jmp_calc_len(yasm_bytecode *bc, yasm_bc_add_span_func add_span,
                     void *add_span_data)
@@ -931,6 +1058,20 @@ x86_bc_insn_tobytes(yasm_bytecode *bc, unsigned char **bufp,
     return 0;
 }
 
+static int
+x86_bc_insn_resolved_tobytes(yasm_bytecode *bc, unsigned char **bufp,
+                             unsigned char *bufstart, void *d,
+                             yasm_output_value_func output_value,
+                             /*@unused@*/ yasm_output_reloc_func output_reloc)
+{
+    const x86_insn_resolved *resolved =
+        (const x86_insn_resolved *)bc->contents;
+
+    memcpy(*bufp, resolved->bytes, resolved->len);
+    *bufp += resolved->len;
+    return 0;
+}
+
 static int
 x86_bc_jmp_tobytes(yasm_bytecode *bc, unsigned char **bufp,
                    unsigned char *bufstart, void *d,
@@ -81,6 +81,8 @@ dwarf2_dbgfmt_create(yasm_object *object)
         yasm_xmalloc(sizeof(yasm_dbgfmt_dwarf2));
     size_t i;
 
+    yasm_assoc_data_register(&yasm_dwarf2__section_data_cb);
+
     dbgfmt_dwarf2->dbgfmt.module = &yasm_dwarf2_LTX_dbgfmt;
 
     dbgfmt_dwarf2->dirs_allocated = 32;
@@ -105,6 +105,9 @@ bin_objfmt_create(yasm_object *object)
     yasm_objfmt_bin *objfmt_bin = yasm_xmalloc(sizeof(yasm_objfmt_bin));
     objfmt_bin->objfmt.module = &yasm_bin_LTX_objfmt;
 
+    yasm_assoc_data_register(&bin_section_data_cb);
+    yasm_assoc_data_register(&bin_symrec_data_cb);
+
     objfmt_bin->map_flags = NO_MAP;
     objfmt_bin->map_filename = NULL;
     objfmt_bin->org = NULL;
@@ -189,6 +192,7 @@ typedef struct bin_objfmt_output_info {
     yasm_errwarns *errwarns;
     /*@dependent@*/ FILE *f;
     /*@only@*/ unsigned char *buf;
+    yasm_outbuf ob;             /* section contents output buffer */
     /*@observer@*/ const yasm_section *sect;
     unsigned long start;        /* what normal variables go against */
 
@@ -975,43 +979,18 @@ static int
 bin_objfmt_output_bytecode(yasm_bytecode *bc, /*@null@*/ void *d)
 {
     /*@null@*/ bin_objfmt_output_info *info = (bin_objfmt_output_info *)d;
-    /*@null@*/ /*@only@*/ unsigned char *bigbuf;
-    unsigned long size = REGULAR_OUTBUF_SIZE;
+    unsigned long size;
     int gap;
 
     assert(info != NULL);
 
-    bigbuf = yasm_bc_tobytes(bc, info->buf, &size, &gap, info,
-                             bin_objfmt_output_value, NULL);
-
-    /* Don't bother doing anything else if size ended up being 0. */
-    if (size == 0) {
-        if (bigbuf)
-            yasm_xfree(bigbuf);
-        return 0;
-    }
+    size = yasm_bc_tobytes_outbuf(bc, &info->ob, &gap, info,
+                                  bin_objfmt_output_value, NULL);
 
-    /* Warn that gaps are converted to 0 and write out the 0's. */
-    if (gap) {
-        unsigned long left;
+    /* Warn that gaps are converted to 0 (the 0's have already been output) */
+    if (size != 0 && gap)
         yasm_warn_set(YASM_WARN_UNINIT_CONTENTS,
             N_("uninitialized space declared in code/data section: zeroing"));
-        /* Write out in chunks */
-        memset(info->buf, 0, REGULAR_OUTBUF_SIZE);
-        left = size;
-        while (left > REGULAR_OUTBUF_SIZE) {
-            fwrite(info->buf, REGULAR_OUTBUF_SIZE, 1, info->f);
-            left -= REGULAR_OUTBUF_SIZE;
-        }
-        fwrite(info->buf, left, 1, info->f);
-    } else {
-        /* Output buf (or bigbuf if non-NULL) to file */
-        fwrite(bigbuf ? bigbuf : info->buf, (size_t)size, 1, info->f);
-    }
-
-    /* If bigbuf was allocated, free it */
-    if (bigbuf)
-        yasm_xfree(bigbuf);
 
     return 0;
 }
@@ -1081,6 +1060,7 @@ bin_objfmt_output_section(yasm_section *sect, /*@null@*/ void *d)
             yasm__fatal(N_("could not seek on output file"));
         yasm_section_bcs_traverse(sect, info->errwarns,
                                   info, bin_objfmt_output_bytecode);
+        yasm_outbuf_flush(&info->ob);
     }
 
     return 0;
@@ -1092,6 +1072,7 @@ bin_objfmt_cleanup(bin_objfmt_output_info *info)
     bin_group *group, *group_temp;
 
     yasm_xfree(info->buf);
+    yasm_outbuf_delete(&info->ob);
     yasm_intnum_destroy(info->origin);
     yasm_intnum_destroy(info->tmp_intn);
 
@@ -1136,6 +1117,7 @@ bin_objfmt_output(yasm_object *object, FILE *f, /*@unused@*/ int all_syms,
     info.errwarns = errwarns;
     info.f = f;
     info.buf = yasm_xmalloc(REGULAR_OUTBUF_SIZE);
+    yasm_outbuf_initialize(&info.ob, f);
     info.tmp_intn = yasm_intnum_create_uint(0);
     TAILQ_INIT(&info.lma_groups);
     TAILQ_INIT(&info.vma_groups);
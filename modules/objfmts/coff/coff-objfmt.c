@@ -202,10 +202,12 @@ typedef struct coff_objfmt_output_info {
     yasm_section *sect;
     /*@dependent@*/ coff_section_data *csd;
     unsigned long addr;                 /* start of next section */
+    unsigned long pos;                  /* next file offset (presized) */
+    yasm_outbuf ob;                     /* section contents output buffer */
 
     unsigned long indx;                 /* current symbol index */
     int all_syms;                       /* outputting all symbols? */
-    unsigned long strtab_offset;        /* current string table offset */
+    /*@only@*/ yasm_strtab *strtab;     /* string table */
 } coff_objfmt_output_info;
 
 static void coff_section_data_destroy(/*@only@*/ void *d);
@@ -278,6 +280,9 @@ coff_common_create(yasm_object *object)
     yasm_objfmt_coff *objfmt_coff = yasm_xmalloc(sizeof(yasm_objfmt_coff));
     yasm_symrec *filesym;
 
+    yasm_assoc_data_register(&coff_section_data_cb);
+    yasm_assoc_data_register(&coff_symrec_data_cb);
+
     /* Only support x86 arch */
     if (yasm__strcasecmp(yasm_arch_keyword(object->arch), "x86") != 0) {
         yasm_xfree(objfmt_coff);
@@ -716,45 +721,24 @@ static int
 coff_objfmt_output_bytecode(yasm_bytecode *bc, /*@null@*/ void *d)
 {
     /*@null@*/ coff_objfmt_output_info *info = (coff_objfmt_output_info *)d;
-    /*@null@*/ /*@only@*/ unsigned char *bigbuf;
-    unsigned long size = REGULAR_OUTBUF_SIZE;
+    unsigned long size;
     int gap;
 
     assert(info != NULL);
 
-    bigbuf = yasm_bc_tobytes(bc, info->buf, &size, &gap, info,
-                             coff_objfmt_output_value, NULL);
+    size = yasm_bc_tobytes_outbuf(bc, &info->ob, &gap, info,
+                                  coff_objfmt_output_value, NULL);
 
     /* Don't bother doing anything else if size ended up being 0. */
-    if (size == 0) {
-        if (bigbuf)
-            yasm_xfree(bigbuf);
+    if (size == 0)
         return 0;
-    }
 
     info->csd->size += size;
 
-    /* Warn that gaps are converted to 0 and write out the 0's. */
-    if (gap) {
-        unsigned long left;
+    /* Warn that gaps are converted to 0 (the 0's have already been output) */
+    if (gap)
         yasm_warn_set(YASM_WARN_UNINIT_CONTENTS,
             N_("uninitialized space declared in code/data section: zeroing"));
-        /* Write out in chunks */
-        memset(info->buf, 0, REGULAR_OUTBUF_SIZE);
-        left = size;
-        while (left > REGULAR_OUTBUF_SIZE) {
-            fwrite(info->buf, REGULAR_OUTBUF_SIZE, 1, info->f);
-            left -= REGULAR_OUTBUF_SIZE;
-        }
-        fwrite(info->buf, left, 1, info->f);
-    } else {
-        /* Output buf (or bigbuf if non-NULL) to file */
-        fwrite(bigbuf ? bigbuf : info->buf, (size_t)size, 1, info->f);
-    }
-
-    /* If bigbuf was allocated, free it */
-    if (bigbuf)
-        yasm_xfree(bigbuf);
 
     return 0;
 }
@@ -775,10 +759,9 @@ coff_objfmt_output_section(yasm_section *sect, /*@null@*/ void *d)
     /* Add to strtab if in win32 format and name > 8 chars */
     if (info->objfmt_coff->win32) {
         size_t namelen = strlen(yasm_section_get_name(sect));
-        if (namelen > 8) {
-            csd->strtab_name = info->strtab_offset;
-            info->strtab_offset += (unsigned long)(namelen + 1);
-        }
+        if (namelen > 8)
+            csd->strtab_name = yasm_strtab_get_offset(info->strtab,
+                yasm_strtab_add(info->strtab, yasm_section_get_name(sect)));
     }
 
     if (!csd->isdebug)
@@ -790,18 +773,39 @@ coff_objfmt_output_section(yasm_section *sect, /*@null@*/ void *d)
          */
         pos = 0;    /* position = 0 because it's not in the file */
         csd->size = yasm_bc_next_offset(yasm_section_bcs_last(sect));
+    } else if (info->object->presize_output &&
+               yasm_section_get_size(sect) <= YASM_SECTION_TOBYTES_MAX) {
+        /* Generate the whole section in memory, then write it at once */
+        unsigned char *buf;
+
+        pos = (long)info->pos;
+        info->sect = sect;
+        info->csd = csd;
+        buf = yasm_section_tobytes(sect, info->errwarns, &csd->size, info,
+                                   coff_objfmt_output_value, NULL);
+        if (buf) {
+            fwrite(buf, (size_t)csd->size, 1, info->f);
+            yasm_xfree(buf);
+        }
+        info->pos += csd->size;
     } else {
-        pos = ftell(info->f);
-        if (pos == -1) {
-            yasm__fatal(N_("could not get file position on output file"));
-            /*@notreached@*/
-            return 1;
+        if (info->object->presize_output)
+            pos = (long)info->pos;
+        else {
+            pos = ftell(info->f);
+            if (pos == -1) {
+                yasm__fatal(N_("could not get file position on output file"));
+                /*@notreached@*/
+                return 1;
+            }
         }
 
         info->sect = sect;
         info->csd = csd;
         yasm_section_bcs_traverse(sect, info->errwarns, info,
                                   coff_objfmt_output_bytecode);
+        yasm_outbuf_flush(&info->ob);
+        info->pos += csd->size;
 
         /* Sanity check final section size */
         if (yasm_errwarns_num_errors(info->errwarns, 0) == 0 &&
@@ -822,13 +826,21 @@ coff_objfmt_output_section(yasm_section *sect, /*@null@*/ void *d)
     if (csd->nreloc == 0)
         return 0;
 
-    pos = ftell(info->f);
-    if (pos == -1) {
-        yasm__fatal(N_("could not get file position on output file"));
-        /*@notreached@*/
-        return 1;
+    if (info->object->presize_output) {
+        /* Relocations directly follow the section data */
+        csd->relptr = info->pos;
+        info->pos += 10*csd->nreloc;
+        if (csd->nreloc >= 64*1024 && info->objfmt_coff->win32)
+            info->pos += 10;
+    } else {
+        pos = ftell(info->f);
+        if (pos == -1) {
+            yasm__fatal(N_("could not get file position on output file"));
+            /*@notreached@*/
+            return 1;
+        }
+        csd->relptr = (unsigned long)pos;
     }
-    csd->relptr = (unsigned long)pos;
 
     /* If >=64K relocs (for Win32/64), we set a flag in the section header
      * (NRELOC_OVFL) and the first relocation contains the number of relocs.
@@ -863,24 +875,6 @@ coff_objfmt_output_section(yasm_section *sect, /*@null@*/ void *d)
     return 0;
 }
 
-static int
-coff_objfmt_output_sectstr(yasm_section *sect, /*@null@*/ void *d)
-{
-    /*@null@*/ coff_objfmt_output_info *info = (coff_objfmt_output_info *)d;
-    const char *name;
-    size_t len;
-
-    /* Add to strtab if in win32 format and name > 8 chars */
-    if (!info->objfmt_coff->win32)
-       return 0;
-    
-    name = yasm_section_get_name(sect);
-    len = strlen(name);
-    if (len > 8)
-        fwrite(name, len+1, 1, info->f);
-    return 0;
-}
-
 static int
 coff_objfmt_output_secthead(yasm_section *sect, /*@null@*/ void *d)
 {
@@ -1009,7 +1003,7 @@ coff_objfmt_output_sym(yasm_symrec *sym, /*@null@*/ void *d)
         /*@only*/ char *name;
         const yasm_expr *equ_val;
         const yasm_intnum *intn;
-        unsigned char *localbuf;
+        unsigned char *entry, *localbuf;
         size_t len;
         int aux;
         unsigned long value = 0;
@@ -1086,11 +1080,16 @@ coff_objfmt_output_sym(yasm_symrec *sym, /*@null@*/ void *d)
                 scnum = 0;
         }
 
-        localbuf = info->buf;
+        /* Encode the entry and its aux entries straight into the symbol
+         * table buffer.
+         */
+        entry = yasm_outbuf_reserve(&info->ob, 18*(1+csymd->numaux));
+        yasm_outbuf_commit(&info->ob, 18*(1+csymd->numaux));
+        localbuf = entry;
         if (len > 8) {
             YASM_WRITE_32_L(localbuf, 0);       /* "zeros" field */
-            YASM_WRITE_32_L(localbuf, info->strtab_offset); /* strtab offset */
-            info->strtab_offset += (unsigned long)(len+1);
+            YASM_WRITE_32_L(localbuf, yasm_strtab_get_offset(info->strtab,
+                yasm_strtab_add(info->strtab, name))); /* strtab offset */
         } else {
             /* <8 chars, so no string table entry needed */
             strncpy((char *)localbuf, name, 8);
@@ -1101,9 +1100,8 @@ coff_objfmt_output_sym(yasm_symrec *sym, /*@null@*/ void *d)
         YASM_WRITE_16_L(localbuf, csymd->type); /* type */
         YASM_WRITE_8(localbuf, csymd->sclass);  /* storage class */
         YASM_WRITE_8(localbuf, csymd->numaux);  /* number of aux entries */
-        fwrite(info->buf, 18, 1, info->f);
         for (aux=0; aux<csymd->numaux; aux++) {
-            localbuf = info->buf;
+            localbuf = entry + 18*(aux+1);
             memset(localbuf, 0, 18);
             switch (csymd->auxtype) {
                 case COFF_SYMTAB_AUX_NONE:
@@ -1117,8 +1115,10 @@ coff_objfmt_output_sym(yasm_symrec *sym, /*@null@*/ void *d)
                     len = strlen(csymd->aux[0].fname);
                     if (len > 14) {
                         YASM_WRITE_32_L(localbuf, 0);
-                        YASM_WRITE_32_L(localbuf, info->strtab_offset);
-                        info->strtab_offset += (unsigned long)(len+1);
+                        YASM_WRITE_32_L(localbuf, yasm_strtab_get_offset(
+                            info->strtab,
+                            yasm_strtab_add(info->strtab,
+                                            csymd->aux[0].fname)));
                     } else
                         strncpy((char *)localbuf, csymd->aux[0].fname, 14);
                     break;
@@ -1126,45 +1126,6 @@ coff_objfmt_output_sym(yasm_symrec *sym, /*@null@*/ void *d)
                     yasm_internal_error(
                         N_("coff: unrecognized aux symtab type"));
             }
-            fwrite(info->buf, 18, 1, info->f);
-        }
-        yasm_xfree(name);
-    }
-    return 0;
-}
-
-static int
-coff_objfmt_output_str(yasm_symrec *sym, /*@null@*/ void *d)
-{
-    /*@null@*/ coff_objfmt_output_info *info = (coff_objfmt_output_info *)d;
-    yasm_sym_vis vis = yasm_symrec_get_visibility(sym);
-    /*@dependent@*/ /*@null@*/ coff_symrec_data *csymd;
-    csymd = yasm_symrec_get_data(sym, &coff_symrec_data_cb);
-
-    assert(info != NULL);
-
-    /* Don't output local syms unless outputting all syms */
-    if (info->all_syms || vis != YASM_SYM_LOCAL ||
-        (csymd && csymd->forcevis)) {
-        /*@only@*/ char *name = yasm_symrec_get_global_name(sym, info->object);
-        size_t len = strlen(name);
-        int aux;
-
-        if (!csymd)
-            yasm_internal_error(N_("coff: expected sym data to be present"));
-
-        if (len > 8)
-            fwrite(name, len+1, 1, info->f);
-        for (aux=0; aux<csymd->numaux; aux++) {
-            switch (csymd->auxtype) {
-                case COFF_SYMTAB_AUX_FILE:
-                    len = strlen(csymd->aux[0].fname);
-                    if (len > 14)
-                        fwrite(csymd->aux[0].fname, len+1, 1, info->f);
-                    break;
-                default:
-                    break;
-            }
         }
         yasm_xfree(name);
     }
@@ -1204,7 +1165,7 @@ coff_objfmt_output(yasm_object *object, FILE *f, int all_syms,
      */
     all_syms |= objfmt_coff->win64;
 
-    info.strtab_offset = 4;
+    info.strtab = yasm_strtab_create(4, 0);
     info.object = object;
     info.objfmt_coff = objfmt_coff;
     info.errwarns = errwarns;
@@ -1233,28 +1194,42 @@ coff_objfmt_output(yasm_object *object, FILE *f, int all_syms,
          */
         info.addr = 0;
         if (yasm_object_sections_traverse(object, &info,
-                                          coff_objfmt_set_section_addr))
+                                          coff_objfmt_set_section_addr)) {
+            yasm_strtab_destroy(info.strtab);
             return;
+        }
     }
     info.addr = 0;
+    info.pos = 20+40*(objfmt_coff->parse_scnum-1);
+    yasm_outbuf_initialize(&info.ob, f);
     if (yasm_object_sections_traverse(object, &info,
-                                      coff_objfmt_output_section))
+                                      coff_objfmt_output_section)) {
+        yasm_outbuf_delete(&info.ob);
+        yasm_strtab_destroy(info.strtab);
         return;
+    }
+    yasm_outbuf_delete(&info.ob);
 
     /* Symbol table */
-    pos = ftell(f);
-    if (pos == -1) {
-        yasm__fatal(N_("could not get file position on output file"));
-        /*@notreached@*/
-        return;
+    if (object->presize_output)
+        symtab_pos = info.pos;
+    else {
+        pos = ftell(f);
+        if (pos == -1) {
+            yasm__fatal(N_("could not get file position on output file"));
+            /*@notreached@*/
+            return;
+        }
+        symtab_pos = (unsigned long)pos;
     }
-    symtab_pos = (unsigned long)pos;
+    yasm_outbuf_initialize(&info.ob, f);
     yasm_symtab_traverse(object->symtab, &info, coff_objfmt_output_sym);
+    yasm_outbuf_delete(&info.ob);
 
-    /* String table */
-    yasm_fwrite_32_l(info.strtab_offset, f); /* total length */
-    yasm_object_sections_traverse(object, &info, coff_objfmt_output_sectstr);
-    yasm_symtab_traverse(object->symtab, &info, coff_objfmt_output_str);
+    /* String table: total length, then section and symbol names */
+    yasm_fwrite_32_l(4+yasm_strtab_finalize(info.strtab), f);
+    yasm_strtab_output(info.strtab, f);
+    yasm_strtab_destroy(info.strtab);
 
     /* Write headers */
     if (fseek(f, 0, SEEK_SET) < 0) {
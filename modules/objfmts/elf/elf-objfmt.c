@@ -68,6 +68,8 @@ typedef struct {
     yasm_object *object;
     unsigned long sindex;
     yasm_symrec *GOT_sym;
+    unsigned long pos;              /* next file offset (presized output) */
+    yasm_outbuf ob;                 /* section contents output buffer */
 } elf_objfmt_output_info;
 
 typedef struct {
@@ -355,6 +357,10 @@ elf_objfmt_create_common(yasm_object *object, yasm_objfmt_module *module,
     elf_symtab_entry *entry;
     const elf_machine_handler *elf_march;
 
+    yasm_assoc_data_register(&elf_section_data);
+    yasm_assoc_data_register(&elf_symrec_data);
+    yasm_assoc_data_register(&elf_ssym_symrec_data);
+
     objfmt_elf->objfmt.module = module;
     elf_march = elf_set_arch(object->arch, object->symtab, bits_pref);
     if (!elf_march) {
@@ -593,50 +599,29 @@ static int
 elf_objfmt_output_bytecode(yasm_bytecode *bc, /*@null@*/ void *d)
 {
     /*@null@*/ elf_objfmt_output_info *info = (elf_objfmt_output_info *)d;
-    unsigned char buf[256];
-    /*@null@*/ /*@only@*/ unsigned char *bigbuf;
-    unsigned long size = 256;
+    unsigned long size;
     int gap;
 
     if (info == NULL)
         yasm_internal_error("null info struct");
 
-    bigbuf = yasm_bc_tobytes(bc, buf, &size, &gap, info,
-                             elf_objfmt_output_value, elf_objfmt_output_reloc);
+    size = yasm_bc_tobytes_outbuf(bc, &info->ob, &gap, info,
+                                  elf_objfmt_output_value,
+                                  elf_objfmt_output_reloc);
 
     /* Don't bother doing anything else if size ended up being 0. */
-    if (size == 0) {
-        if (bigbuf)
-            yasm_xfree(bigbuf);
+    if (size == 0)
         return 0;
-    }
     else {
         yasm_intnum *bcsize = yasm_intnum_create_uint(size);
         elf_secthead_add_size(info->shead, bcsize);
         yasm_intnum_destroy(bcsize);
     }
 
-    /* Warn that gaps are converted to 0 and write out the 0's. */
-    if (gap) {
-        unsigned long left;
+    /* Warn that gaps are converted to 0 (the 0's have already been output) */
+    if (gap)
         yasm_warn_set(YASM_WARN_UNINIT_CONTENTS,
             N_("uninitialized space declared in code/data section: zeroing"));
-        /* Write out in chunks */
-        memset(buf, 0, 256);
-        left = size;
-        while (left > 256) {
-            fwrite(buf, 256, 1, info->f);
-            left -= 256;
-        }
-        fwrite(buf, left, 1, info->f);
-    } else {
-        /* Output buf (or bigbuf if non-NULL) to file */
-        fwrite(bigbuf ? bigbuf : buf, (size_t)size, 1, info->f);
-    }
-
-    /* If bigbuf was allocated, free it */
-    if (bigbuf)
-        yasm_xfree(bigbuf);
 
     return 0;
 }
@@ -647,6 +632,7 @@ elf_objfmt_output_section(yasm_section *sect, /*@null@*/ void *d)
     /*@null@*/ elf_objfmt_output_info *info = (elf_objfmt_output_info *)d;
     /*@dependent@*/ /*@null@*/ elf_secthead *shead;
     long pos;
+    unsigned long relsize;
     char *relname;
     const char *sectname;
 
@@ -673,7 +659,9 @@ elf_objfmt_output_section(yasm_section *sect, /*@null@*/ void *d)
         return 0;
     }
 
-    if ((pos = ftell(info->f)) == -1) {
+    if (info->object->presize_output)
+        pos = (long)info->pos;
+    else if ((pos = ftell(info->f)) == -1) {
         yasm_error_set(YASM_ERROR_IO,
                        N_("couldn't read position on output stream"));
         yasm_errwarn_propagate(info->errwarns, 0);
@@ -686,15 +674,38 @@ elf_objfmt_output_section(yasm_section *sect, /*@null@*/ void *d)
 
     info->sect = sect;
     info->shead = shead;
-    yasm_section_bcs_traverse(sect, info->errwarns, info,
-                              elf_objfmt_output_bytecode);
+    if (info->object->presize_output &&
+        yasm_section_get_size(sect) <= YASM_SECTION_TOBYTES_MAX) {
+        /* Generate the whole section in memory, then write it at once */
+        unsigned long size;
+        unsigned char *buf;
+
+        buf = yasm_section_tobytes(sect, info->errwarns, &size, info,
+                                   elf_objfmt_output_value,
+                                   elf_objfmt_output_reloc);
+        if (buf) {
+            yasm_intnum *sectsize = yasm_intnum_create_uint(size);
+            elf_secthead_add_size(shead, sectsize);
+            yasm_intnum_destroy(sectsize);
+            fwrite(buf, (size_t)size, 1, info->f);
+            yasm_xfree(buf);
+        }
+        info->pos = (unsigned long)pos + size;
+    } else {
+        yasm_section_bcs_traverse(sect, info->errwarns, info,
+                                  elf_objfmt_output_bytecode);
+        yasm_outbuf_flush(&info->ob);
+        info->pos = (unsigned long)pos + yasm_section_get_size(sect);
+    }
 
     elf_secthead_set_index(shead, ++info->sindex);
 
     /* No relocations to output?  Go on to next section */
-    if (elf_secthead_write_relocs_to_file(info->f, sect, shead,
-                                          info->errwarns) == 0)
+    relsize = elf_secthead_write_relocs_to_file(info->f, sect, shead,
+                                                info->errwarns);
+    if (relsize == 0)
         return 0;
+    info->pos = ((info->pos + 3) & ~3UL) + relsize;  /* 4-aligned relocs */
     elf_secthead_set_rel_index(shead, ++info->sindex);
 
     /* name the relocation section .rel[a].foo */
@@ -752,6 +763,7 @@ elf_objfmt_output(yasm_object *object, FILE *f, int all_syms,
     info.errwarns = errwarns;
     info.f = f;
     info.GOT_sym = yasm_symtab_get(object->symtab, "_GLOBAL_OFFSET_TABLE_");
+    info.pos = elf_proghead_get_size();
 
     /* Update filename strtab */
     elf_strtab_entry_set_str(objfmt_elf->file_strtab_entry,
@@ -777,9 +789,13 @@ elf_objfmt_output(yasm_object *object, FILE *f, int all_syms,
     /* output known sections - includes reloc sections which aren't in yasm's
      * list.  Assign indices as we go. */
     info.sindex = 3;
+    yasm_outbuf_initialize(&info.ob, f);
     if (yasm_object_sections_traverse(object, &info,
-                                      elf_objfmt_output_section))
+                                      elf_objfmt_output_section)) {
+        yasm_outbuf_delete(&info.ob);
         return;
+    }
+    yasm_outbuf_delete(&info.ob);
 
     /* add final sections to the shstrtab */
     elf_strtab_name = elf_strtab_append_str(objfmt_elf->shstrtab, ".strtab");
@@ -205,19 +205,9 @@ elf_strtab_entry_create(const char *str)
 void
 elf_strtab_entry_set_str(elf_strtab_entry *entry, const char *str)
 {
-    elf_strtab_entry *last;
     if (entry->str)
         yasm_xfree(entry->str);
     entry->str = yasm__xstrdup(str);
-
-    /* Update all following indices since string length probably changes */
-    last = entry;
-    entry = STAILQ_NEXT(last, qlink);
-    while (entry) {
-        entry->index = last->index + (unsigned long)strlen(last->str) + 1;
-        last = entry;
-        entry = STAILQ_NEXT(last, qlink);
-    }
 }
 
 elf_strtab_head *
@@ -237,18 +227,14 @@ elf_strtab_create()
 elf_strtab_entry *
 elf_strtab_append_str(elf_strtab_head *strtab, const char *str)
 {
-    elf_strtab_entry *last, *entry;
+    elf_strtab_entry *entry;
 
     if (strtab == NULL)
         yasm_internal_error("strtab is null");
     if (STAILQ_EMPTY(strtab))
         yasm_internal_error("strtab is missing initial dummy entry");
 
-    last = STAILQ_LAST(strtab, elf_strtab_entry, qlink);
-
     entry = elf_strtab_entry_create(str);
-    entry->index = last->index + (unsigned long)strlen(last->str) + 1;
-
     STAILQ_INSERT_TAIL(strtab, entry, qlink);
     return entry;
 }
@@ -276,18 +262,25 @@ elf_strtab_destroy(elf_strtab_head *strtab)
 unsigned long
 elf_strtab_output_to_file(FILE *f, elf_strtab_head *strtab)
 {
-    unsigned long size = 0;
+    unsigned long size;
     elf_strtab_entry *entry;
+    yasm_strtab *table;
 
     if (strtab == NULL)
         yasm_internal_error("strtab is null");
 
-    /* consider optimizing tables here */
-    STAILQ_FOREACH(entry, strtab, qlink) {
-        size_t len = 1 + strlen(entry->str);
-        fwrite(entry->str, len, 1, f);
-        size += (unsigned long)len;
-    }
+    /* Equal names share one string, and names that end another (.text,
+     * .rela.text) point into it.  The initial dummy entry is added first
+     * and is never merged, so index 0 stays the empty string.
+     */
+    table = yasm_strtab_create(0, 1);
+    STAILQ_FOREACH(entry, strtab, qlink)
+        entry->index = yasm_strtab_add(table, entry->str);
+    yasm_strtab_finalize(table);
+    STAILQ_FOREACH(entry, strtab, qlink)
+        entry->index = yasm_strtab_get_offset(table, entry->index);
+    size = yasm_strtab_output(table, f);
+    yasm_strtab_destroy(table);
     return size;
 }
 
@@ -467,18 +460,21 @@ unsigned long
 elf_symtab_write_to_file(FILE *f, elf_symtab_head *symtab,
                          yasm_errwarns *errwarns)
 {
-    unsigned char buf[SYMTAB_MAXSIZE], *bufp;
     elf_symtab_entry *entry, *prev;
     unsigned long size = 0;
+    yasm_outbuf ob;
 
     if (!symtab)
         yasm_internal_error(N_("symtab is null"));
+    if (!elf_march->write_symtab_entry || !elf_march->symtab_entry_size)
+        yasm_internal_error(N_("Unsupported machine for ELF output"));
 
+    /* Entries are encoded directly into one output buffer */
+    yasm_outbuf_initialize(&ob, f);
     prev = NULL;
     STAILQ_FOREACH(entry, symtab, qlink) {
 
         yasm_intnum *size_intn=NULL, *value_intn=NULL;
-        bufp = buf;
 
         /* get size (if specified); expr overrides stored integer */
         if (entry->xsize) {
@@ -529,10 +525,10 @@ elf_symtab_write_to_file(FILE *f, elf_symtab_head *symtab,
             }
         }
 
-        if (!elf_march->write_symtab_entry || !elf_march->symtab_entry_size)
-            yasm_internal_error(N_("Unsupported machine for ELF output"));
-        elf_march->write_symtab_entry(bufp, entry, value_intn, size_intn);
-        fwrite(buf, elf_march->symtab_entry_size, 1, f);
+        elf_march->write_symtab_entry(
+            yasm_outbuf_reserve(&ob, elf_march->symtab_entry_size), entry,
+            value_intn, size_intn);
+        yasm_outbuf_commit(&ob, elf_march->symtab_entry_size);
         size += elf_march->symtab_entry_size;
 
         yasm_intnum_destroy(size_intn);
@@ -540,6 +536,7 @@ elf_symtab_write_to_file(FILE *f, elf_symtab_head *symtab,
 
         prev = entry;
     }
+    yasm_outbuf_delete(&ob);
     return size;
 }
 
@@ -397,7 +397,7 @@ struct elf_reloc_entry {
 STAILQ_HEAD(elf_strtab_head, elf_strtab_entry);
 struct elf_strtab_entry {
     STAILQ_ENTRY(elf_strtab_entry) qlink;
-    unsigned long        index;
+    unsigned long        index;     /* set by elf_strtab_output_to_file() */
     char                *str;
 };
 
@@ -0,0 +1,3 @@
+#! /bin/sh
+${srcdir}/out_test.sh elf_presize_test modules/objfmts/elf/tests/presize "elf objfmt presized output" "-f elf --presize-output" ".o"
+exit $?
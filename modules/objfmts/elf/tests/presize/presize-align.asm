@@ -0,0 +1,2 @@
+[section .data align=64]
+[section .rodata align=32]
@@ -0,0 +1,8 @@
+EXTERN constant
+EXTERN function
+GLOBAL main
+
+main:
+	mov	eax, constant
+	call	function
+	ret
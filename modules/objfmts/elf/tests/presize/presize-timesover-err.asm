@@ -0,0 +1,2 @@
+times 512 db 0
+times 01FEh-($-$$) db 0
@@ -276,7 +276,7 @@ typedef struct macho_section_data {
 typedef struct macho_symrec_data {
     unsigned long index;        /* index in output order */
     yasm_intnum *value;         /* valid after writing symtable to file */
-    unsigned long length;       /* length + 1 (plus auto underscore) */
+    unsigned long strx;         /* index of name in string table */
 } macho_symrec_data;
 
 
@@ -296,6 +296,7 @@ typedef struct macho_objfmt_output_info {
     yasm_errwarns *errwarns;
     /*@dependent@ */ FILE *f;
     /*@only@ */ unsigned char *buf;
+    yasm_outbuf ob;             /* section contents output buffer */
     yasm_section *sect;
     /*@dependent@ */ macho_section_data *msd;
 
@@ -310,10 +311,11 @@ typedef struct macho_objfmt_output_info {
     unsigned long rel_base;     /* first relocation in file */
     unsigned long s_reloff;     /* in-file offset to relocations */
 
-    unsigned long indx;         /* current symbol size in bytes (name length+1) */
+    unsigned long indx;         /* number of symbols output */
     unsigned long symindex;     /* current symbol index in output order */
     int all_syms;               /* outputting all symbols? */
     unsigned long strlength;    /* length of all strings */
+    /*@only@*/ yasm_strtab *strtab;     /* string table */
 } macho_objfmt_output_info;
 
 
@@ -343,6 +345,9 @@ macho_objfmt_create_common(yasm_object *object, yasm_objfmt_module *module,
 {
     yasm_objfmt_macho *objfmt_macho = yasm_xmalloc(sizeof(yasm_objfmt_macho));
 
+    yasm_assoc_data_register(&macho_section_data_cb);
+    yasm_assoc_data_register(&macho_symrec_data_cb);
+
     objfmt_macho->objfmt.module = module;
 
     /* Only support x86 arch for now */
@@ -579,44 +584,18 @@ static int
 macho_objfmt_output_bytecode(yasm_bytecode *bc, /*@null@*/ void *d)
 {
     /*@null@*/ macho_objfmt_output_info *info = (macho_objfmt_output_info *)d;
-    /*@null@*/ /*@only@*/ unsigned char *bigbuf;
-    unsigned long size = REGULAR_OUTBUF_SIZE;
+    unsigned long size;
     int gap;
 
     assert(info != NULL);
 
-    bigbuf = yasm_bc_tobytes(bc, info->buf, &size, &gap, info,
-                             macho_objfmt_output_value, NULL);
-
-    /* Don't bother doing anything else if size ended up being 0. */
-    if (size == 0) {
-        if (bigbuf)
-            yasm_xfree(bigbuf);
-        return 0;
-    }
-
-    /* Warn that gaps are converted to 0 and write out the 0's. */
-    if (gap) {
-        unsigned long left;
+    size = yasm_bc_tobytes_outbuf(bc, &info->ob, &gap, info,
+                                  macho_objfmt_output_value, NULL);
 
+    /* Warn that gaps are converted to 0 (the 0's have already been output) */
+    if (size != 0 && gap)
         yasm_warn_set(YASM_WARN_UNINIT_CONTENTS,
                       N_("uninitialized space: zeroing"));
-        /* Write out in chunks */
-        memset(info->buf, 0, REGULAR_OUTBUF_SIZE);
-        left = size;
-        while (left > REGULAR_OUTBUF_SIZE) {
-            fwrite(info->buf, REGULAR_OUTBUF_SIZE, 1, info->f);
-            left -= REGULAR_OUTBUF_SIZE;
-        }
-        fwrite(info->buf, left, 1, info->f);
-    } else {
-        /* Output buf (or bigbuf if non-NULL) to file */
-        fwrite(bigbuf ? bigbuf : info->buf, (size_t) size, 1, info->f);
-    }
-
-    /* If bigbuf was allocated, free it */
-    if (bigbuf)
-        yasm_xfree(bigbuf);
 
     return 0;
 }
@@ -815,9 +794,7 @@ macho_objfmt_count_sym(yasm_symrec *sym, /*@null@*/ void *d)
 
             name = yasm_symrec_get_global_name(sym, info->object);
             /*printf("%s\n",name); */
-            /* name length + delimiter */
-            sym_data->length = (unsigned long)strlen(name) + 1;
-            info->strlength += sym_data->length;
+            sym_data->strx = yasm_strtab_add(info->strtab, name);
             info->indx++;
             yasm_xfree(name);
         }
@@ -943,8 +920,11 @@ macho_objfmt_output_symtable(yasm_symrec *sym, /*@null@*/ void *d)
             n_type |= N_EXT | data.flag;
         }
 
-        localbuf = info->buf;
-        YASM_WRITE_32_L(localbuf, info->indx);  /* offset in string table */
+        localbuf = yasm_outbuf_reserve(&info->ob, 8 + long_int_bytes);
+        yasm_outbuf_commit(&info->ob, 8 + long_int_bytes);
+        /* offset in string table */
+        YASM_WRITE_32_L(localbuf, yasm_strtab_get_offset(info->strtab,
+                                                         symd->strx));
         YASM_WRITE_8(localbuf, n_type); /* type of symbol entry */
         n_sect = (scnum >= 0) ? scnum + 1 : NO_SECT;
         YASM_WRITE_8(localbuf, n_sect); /* referring section where symbol is found */
@@ -955,41 +935,12 @@ macho_objfmt_output_symtable(yasm_symrec *sym, /*@null@*/ void *d)
             symd->value = val;
         else
             yasm_intnum_destroy(val);
-
-        info->indx += symd->length;
-
-        fwrite(info->buf, 8 + long_int_bytes, 1, info->f);
     }
 
     return 0;
 }
 
 
-static int
-macho_objfmt_output_str(yasm_symrec *sym, /*@null@*/ void *d)
-{
-    /*@null@*/ macho_objfmt_output_info *info = (macho_objfmt_output_info *)d;
-    yasm_sym_vis vis = yasm_symrec_get_visibility(sym);
-    /*@null@*/ macho_symrec_data *xsymd;
-
-
-    assert(info != NULL);
-
-    if (info->all_syms ||
-        vis & (YASM_SYM_GLOBAL | YASM_SYM_COMMON | YASM_SYM_EXTERN)) {
-        if (0 == macho_objfmt_is_section_label(sym)) {
-            /*@only@*/ char *name =
-                yasm_symrec_get_global_name(sym, info->object);
-            size_t len = strlen(name);
-
-            xsymd = yasm_symrec_get_data(sym, &macho_symrec_data_cb);
-            fwrite(name, len + 1, 1, info->f);
-            yasm_xfree(name);
-        }
-    }
-    return 0;
-}
-
 static int
 macho_objfmt_calc_sectsize(yasm_section *sect, /*@null@ */ void *d)
 {
@@ -1090,11 +1041,13 @@ macho_objfmt_output(yasm_object *object, FILE *f, int all_syms,
     /* Get number of symbols */
     info.symindex = 0;
     info.indx = 0;
-    info.strlength = 1;         /* string table starts with a zero byte */
+    info.strtab = yasm_strtab_create(0, 1);
+    yasm_strtab_add(info.strtab, "");   /* string table starts with a zero byte */
     info.all_syms = all_syms || info.is_64;
     /*info.all_syms = 1;                * force all syms into symbol table */
     yasm_symtab_traverse(object->symtab, &info, macho_objfmt_count_sym);
     symtab_count = info.indx;
+    info.strlength = yasm_strtab_finalize(info.strtab);
 
     /* write raw section data first */
     if (fseek(f, (long)headsize, SEEK_SET) < 0) {
@@ -1112,7 +1065,9 @@ macho_objfmt_output(yasm_object *object, FILE *f, int all_syms,
     yasm_object_sections_traverse(object, &info, macho_objfmt_calc_sectsize);
 
     /* output sections to file */
+    yasm_outbuf_initialize(&info.ob, f);
     yasm_object_sections_traverse(object, &info, macho_objfmt_output_section);
+    yasm_outbuf_delete(&info.ob);
 
     fileoff_sections = ftell(f);
 
@@ -1243,12 +1198,13 @@ macho_objfmt_output(yasm_object *object, FILE *f, int all_syms,
     yasm_object_sections_traverse(object, &info, macho_objfmt_output_relocs);
 
     /* symbol table (NLIST) */
-    info.indx = 1;              /* restart symbol table indices */
+    yasm_outbuf_initialize(&info.ob, f);
     yasm_symtab_traverse(object->symtab, &info, macho_objfmt_output_symtable);
+    yasm_outbuf_delete(&info.ob);
 
     /* symbol strings */
-    fwrite(pad_data, 1, 1, f);
-    yasm_symtab_traverse(object->symtab, &info, macho_objfmt_output_str);
+    yasm_strtab_output(info.strtab, f);
+    yasm_strtab_destroy(info.strtab);
 
     yasm_intnum_destroy(val);
     yasm_xfree(info.buf);
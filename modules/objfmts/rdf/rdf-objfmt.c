@@ -93,6 +93,8 @@ typedef struct rdf_section_data {
     unsigned long size;     /* size of raw data (section data) in bytes */
 
     unsigned char *raw_data;    /* raw section data, only used during output */
+    FILE *raw_file;             /* same, for sections too large to keep in
+                                 * memory (temporary file) */
 } rdf_section_data;
 
 typedef struct rdf_symrec_data {
@@ -120,6 +122,7 @@ typedef struct rdf_objfmt_output_info {
     yasm_errwarns *errwarns;
     /*@dependent@*/ FILE *f;
     /*@only@*/ unsigned char *buf;
+    yasm_outbuf ob;                 /* section contents (memory only) */
     yasm_section *sect;
     /*@dependent@*/ rdf_section_data *rsd;
 
@@ -163,6 +166,9 @@ rdf_objfmt_create(yasm_object *object)
 {
     yasm_objfmt_rdf *objfmt_rdf = yasm_xmalloc(sizeof(yasm_objfmt_rdf));
 
+    yasm_assoc_data_register(&rdf_section_data_cb);
+    yasm_assoc_data_register(&rdf_symrec_data_cb);
+
     /* We theoretically support all arches, so don't check.
      * Really we only support byte-addressable ones.
      */
@@ -298,39 +304,18 @@ static int
 rdf_objfmt_output_bytecode(yasm_bytecode *bc, /*@null@*/ void *d)
 {
     /*@null@*/ rdf_objfmt_output_info *info = (rdf_objfmt_output_info *)d;
-    /*@null@*/ /*@only@*/ unsigned char *bigbuf;
-    unsigned long size = REGULAR_OUTBUF_SIZE;
+    unsigned long size;
     int gap;
 
     assert(info != NULL);
 
-    bigbuf = yasm_bc_tobytes(bc, info->buf, &size, &gap, info,
-                             rdf_objfmt_output_value, NULL);
+    size = yasm_bc_tobytes_outbuf(bc, &info->ob, &gap, info,
+                                  rdf_objfmt_output_value, NULL);
 
-    /* Don't bother doing anything else if size ended up being 0. */
-    if (size == 0) {
-        if (bigbuf)
-            yasm_xfree(bigbuf);
-        return 0;
-    }
-
-    /* Warn that gaps are converted to 0 and write out the 0's. */
-    if (gap) {
+    /* Warn that gaps are converted to 0 (the 0's have already been output) */
+    if (size != 0 && gap)
         yasm_warn_set(YASM_WARN_UNINIT_CONTENTS,
                       N_("uninitialized space: zeroing"));
-        /* Write out in chunks */
-        memset(&info->rsd->raw_data[info->rsd->size], 0, size);
-    } else {
-        /* Output buf (or bigbuf if non-NULL) to file */
-        memcpy(&info->rsd->raw_data[info->rsd->size],
-               bigbuf ? bigbuf : info->buf, (size_t)size);
-    }
-
-    info->rsd->size += size;
-
-    /* If bigbuf was allocated, free it */
-    if (bigbuf)
-        yasm_xfree(bigbuf);
 
     return 0;
 }
@@ -360,15 +345,37 @@ rdf_objfmt_output_section_mem(yasm_section *sect, /*@null@*/ void *d)
     if (size == 0)
         return 0;
 
-    /* See UGH comment in output() for why we're doing this */
-    rsd->raw_data = yasm_xmalloc(size);
-    rsd->size = 0;
+    /* See UGH comment in output() for why we're doing this.
+     * Bytecodes are serialized straight into the (presized) raw data, or
+     * for large sections into a temporary file, which seeks over zeros.
+     */
+    if (size > YASM_SECTION_TOBYTES_MAX)
+        rsd->raw_file = tmpfile();
+    yasm_outbuf_initialize(&info->ob, rsd->raw_file);
+    if (!rsd->raw_file)
+        yasm_outbuf_reserve(&info->ob, size);
 
     info->sect = sect;
     info->rsd = rsd;
     yasm_section_bcs_traverse(sect, info->errwarns, info,
                               rdf_objfmt_output_bytecode);
 
+    if (rsd->raw_file) {
+        long len;
+
+        yasm_outbuf_delete(&info->ob);
+        len = ftell(rsd->raw_file);
+        if (len == -1) {
+            yasm__fatal(N_("could not get file position on temporary file"));
+            /*@notreached@*/
+            return 1;
+        }
+        rsd->size = (unsigned long)len;
+    } else {
+        rsd->raw_data = info->ob.buf;
+        rsd->size = info->ob.len;
+    }
+
     /* Sanity check final section size */
     if (rsd->size != size)
         yasm_internal_error(
@@ -421,6 +428,33 @@ rdf_objfmt_output_section_reloc(yasm_section *sect, /*@null@*/ void *d)
     return 0;
 }
 
+/* Copy size bytes of section data from a temporary file to the output.
+ * Blocks of zeros are seeked over (except at the end, so the output is
+ * extended), keeping large reserved areas sparse as in the temporary file.
+ */
+static void
+rdf_objfmt_copy_raw_file(FILE *from, FILE *to, unsigned long size)
+{
+    unsigned char buf[16384];
+    size_t chunk, i;
+
+    if (fseek(from, 0, SEEK_SET) < 0)
+        yasm__fatal(N_("could not seek on temporary file"));
+    while (size > 0) {
+        chunk = size > sizeof(buf) ? sizeof(buf) : (size_t)size;
+        if (fread(buf, chunk, 1, from) != 1)
+            yasm__fatal(N_("could not read temporary file"));
+        size -= chunk;
+        for (i=0; i<chunk && buf[i] == 0; i++)
+            ;
+        if (i == chunk && size > 0) {
+            if (fseek(to, (long)chunk, SEEK_CUR) < 0)
+                yasm__fatal(N_("could not seek on output file"));
+        } else
+            fwrite(buf, chunk, 1, to);
+    }
+}
+
 static int
 rdf_objfmt_output_section_file(yasm_section *sect, /*@null@*/ void *d)
 {
@@ -450,6 +484,12 @@ rdf_objfmt_output_section_file(yasm_section *sect, /*@null@*/ void *d)
     fwrite(info->buf, 10, 1, info->f);
 
     /* Section data */
+    if (rsd->raw_file) {
+        rdf_objfmt_copy_raw_file(rsd->raw_file, info->f, rsd->size);
+        fclose(rsd->raw_file);
+        rsd->raw_file = NULL;
+        return 0;
+    }
     fwrite(rsd->raw_data, rsd->size, 1, info->f);
 
     /* Free section data */
@@ -825,6 +865,7 @@ rdf_objfmt_init_new_section(yasm_section *sect, unsigned long line)
     data->reserved = 0;
     data->size = 0;
     data->raw_data = NULL;
+    data->raw_file = NULL;
     yasm_section_add_data(sect, &rdf_section_data_cb, data);
 
     sym = yasm_symtab_define_label(object->symtab, sectname,
@@ -974,6 +1015,8 @@ rdf_section_data_destroy(void *data)
     rdf_section_data *rsd = (rdf_section_data *)data;
     if (rsd->raw_data)
         yasm_xfree(rsd->raw_data);
+    if (rsd->raw_file)
+        fclose(rsd->raw_file);
     yasm_xfree(data);
 }
 
@@ -0,0 +1,3 @@
+#! /bin/sh
+${srcdir}/out_test.sh win64_presize_test modules/objfmts/win64/tests "win64 objfmt presized output" "-f win64 --presize-output" ".obj" "presize-"
+exit $?
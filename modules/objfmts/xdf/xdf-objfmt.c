@@ -91,6 +91,7 @@ typedef struct xdf_objfmt_output_info {
     yasm_errwarns *errwarns;
     /*@dependent@*/ FILE *f;
     /*@only@*/ unsigned char *buf;
+    yasm_outbuf ob;                 /* section contents output buffer */
     yasm_section *sect;
     /*@dependent@*/ xdf_section_data *xsd;
 
@@ -123,6 +124,9 @@ xdf_objfmt_create(yasm_object *object)
 {
     yasm_objfmt_xdf *objfmt_xdf = yasm_xmalloc(sizeof(yasm_objfmt_xdf));
 
+    yasm_assoc_data_register(&xdf_section_data_cb);
+    yasm_assoc_data_register(&xdf_symrec_data_cb);
+
     /* Only support x86 arch */
     if (yasm__strcasecmp(yasm_arch_keyword(object->arch), "x86") != 0) {
         yasm_xfree(objfmt_xdf);
@@ -236,45 +240,24 @@ static int
 xdf_objfmt_output_bytecode(yasm_bytecode *bc, /*@null@*/ void *d)
 {
     /*@null@*/ xdf_objfmt_output_info *info = (xdf_objfmt_output_info *)d;
-    /*@null@*/ /*@only@*/ unsigned char *bigbuf;
-    unsigned long size = REGULAR_OUTBUF_SIZE;
+    unsigned long size;
     int gap;
 
     assert(info != NULL);
 
-    bigbuf = yasm_bc_tobytes(bc, info->buf, &size, &gap, info,
-                             xdf_objfmt_output_value, NULL);
+    size = yasm_bc_tobytes_outbuf(bc, &info->ob, &gap, info,
+                                  xdf_objfmt_output_value, NULL);
 
     /* Don't bother doing anything else if size ended up being 0. */
-    if (size == 0) {
-        if (bigbuf)
-            yasm_xfree(bigbuf);
+    if (size == 0)
         return 0;
-    }
 
     info->xsd->size += size;
 
-    /* Warn that gaps are converted to 0 and write out the 0's. */
-    if (gap) {
-        unsigned long left;
+    /* Warn that gaps are converted to 0 (the 0's have already been output) */
+    if (gap)
         yasm_warn_set(YASM_WARN_UNINIT_CONTENTS,
                       N_("uninitialized space: zeroing"));
-        /* Write out in chunks */
-        memset(info->buf, 0, REGULAR_OUTBUF_SIZE);
-        left = size;
-        while (left > REGULAR_OUTBUF_SIZE) {
-            fwrite(info->buf, REGULAR_OUTBUF_SIZE, 1, info->f);
-            left -= REGULAR_OUTBUF_SIZE;
-        }
-        fwrite(info->buf, left, 1, info->f);
-    } else {
-        /* Output buf (or bigbuf if non-NULL) to file */
-        fwrite(bigbuf ? bigbuf : info->buf, (size_t)size, 1, info->f);
-    }
-
-    /* If bigbuf was allocated, free it */
-    if (bigbuf)
-        yasm_xfree(bigbuf);
 
     return 0;
 }
@@ -309,6 +292,7 @@ xdf_objfmt_output_section(yasm_section *sect, /*@null@*/ void *d)
         info->xsd = xsd;
         yasm_section_bcs_traverse(sect, info->errwarns, info,
                                   xdf_objfmt_output_bytecode);
+        yasm_outbuf_flush(&info->ob);
 
         /* Sanity check final section size */
         if (xsd->size != yasm_bc_next_offset(yasm_section_bcs_last(sect)))
@@ -573,9 +557,13 @@ xdf_objfmt_output(yasm_object *object, FILE *f, int all_syms,
     yasm_symtab_traverse(object->symtab, &info, xdf_objfmt_output_str);
 
     /* Section data/relocs */
+    yasm_outbuf_initialize(&info.ob, f);
     if (yasm_object_sections_traverse(object, &info,
-                                      xdf_objfmt_output_section))
+                                      xdf_objfmt_output_section)) {
+        yasm_outbuf_delete(&info.ob);
         return;
+    }
+    yasm_outbuf_delete(&info.ob);
 
     /* Write headers */
     if (fseek(f, 0, SEEK_SET) < 0) {
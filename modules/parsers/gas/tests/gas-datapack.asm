@@ -0,0 +1,8 @@
+.data
+x: .byte 1, 2, 3
+.short 1, x, 2
+.long 0x11223344, 5, x, 6
+.quad 7, 8
+.uleb128 1, 300
+.sleb128 -1
+.byte 9
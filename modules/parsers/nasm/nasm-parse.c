@@ -219,12 +219,7 @@ nasm_parser_parse(yasm_parser_nasm *parser_nasm)
             yasm_preproc_get_line(parser_nasm->preproc)) != NULL) {
         yasm_bytecode *bc = NULL, *temp_bc;
 
-        parser_nasm->s.bot = line;
-        parser_nasm->s.tok = line;
-        parser_nasm->s.ptr = line;
-        parser_nasm->s.cur = line;
-        parser_nasm->s.lim = line + strlen((char *)line)+1;
-        parser_nasm->s.top = parser_nasm->s.lim;
+        yasm_scanner_set_line(&parser_nasm->s, line, strlen((char *)line));
 
         get_next_token();
         if (!is_eol()) {
@@ -268,11 +263,13 @@ nasm_parser_parse(yasm_parser_nasm *parser_nasm)
             temp_bc = NULL;
         yasm_errwarn_propagate(parser_nasm->errwarns, cur_line);
 
+        /* Hand the line itself to the linemap rather than copying it */
         if (parser_nasm->save_input)
-            yasm_linemap_add_source(parser_nasm->linemap, temp_bc,
-                                    (char *)line);
+            yasm_linemap_add_source_owned(parser_nasm->linemap, temp_bc,
+                                          (char *)line);
+        else
+            yasm_xfree(line);
         yasm_linemap_goto_next(parser_nasm->linemap);
-        yasm_xfree(line);
     }
 }
 
@@ -652,10 +649,14 @@ error:
                         yasm_dvs_delete(&dvs);
                         return NULL;
                     }
-                } else
-                    dv = yasm_dv_create_expr(e);
+                } else {
+                    /* Constants are packed as they're parsed */
+                    yasm_dvs_append_expr(&dvs, e, size, p_object->arch);
+                    goto dv_next;
+                }
 dv_done:
                 yasm_dvs_append(&dvs, dv);
+dv_next:
                 if (is_eol())
                     break;
                 if (!expect(',')) {
@@ -1663,12 +1664,7 @@ gas_intel_syntax_parse_instr(yasm_parser_nasm *parser_nasm, unsigned char *instr
     yasm_bytecode *bc = NULL;
     char *sinstr = (char *) instr;
 
-    parser_nasm->s.bot = instr;
-    parser_nasm->s.tok = instr;
-    parser_nasm->s.ptr = instr;
-    parser_nasm->s.cur = instr;
-    parser_nasm->s.lim = instr + strlen(sinstr) + 1;
-    parser_nasm->s.top = parser_nasm->s.lim;
+    yasm_scanner_set_line(&parser_nasm->s, instr, strlen(sinstr));
     parser_nasm->peek_token = NONE;
 
     get_next_token();
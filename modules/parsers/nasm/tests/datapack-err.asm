@@ -0,0 +1,5 @@
+db 1, 300, 2
+db 'don''t'
+dw 2, 65536
+dd 'abcd', 5 )
+dq 1, -1, 0x10000000000000000
@@ -0,0 +1,6 @@
+x: db 1, 2, 'abc', 3, x, 4
+dw 'a', 0x1234, 'bcd', 5
+dd 1, 'ab', 2, x, 3, 4
+dd 'abcd', 6, 'abcde'
+dq 1, x, 2
+dt 3, 4
@@ -0,0 +1,16 @@
+; Constant EQU values are folded once and cached; uses before the
+; definitions, negated uses and uses mixed with labels must all see the
+; same values.
+bits 32
+db fwd, fwd+1
+fwd equ base*2
+base equ 3
+s0 equ 8
+s1 equ s0+4
+s2 equ s1*2
+s3 equ -s2+s1
+dd s0, s1, s2, s3
+dd -s3, s2-s1, s3*s3
+dd lbl+s2, lbl-s1
+lbl:
+db fwd, base, s3
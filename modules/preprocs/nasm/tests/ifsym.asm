@@ -0,0 +1,15 @@
+; %if on symbols the parser has defined by then, far enough into the source
+; that --pipeline has the preprocessor ahead of the parser
+count	equ 3
+%rep 300
+nop
+%endrep
+%if count > 2
+db count
+%else
+db 0
+%endif
+limit	equ count*2
+%if limit == 6
+dw limit
+%endif
@@ -0,0 +1,3 @@
+#! /bin/sh
+${srcdir}/out_test.sh nasmpp_pipeline_test modules/preprocs/nasm/tests "nasm preproc pipelined" "-f bin --pipeline" "" "pipeline-"
+exit $?
@@ -23,10 +23,13 @@ echo $ECHO_N "Test $1: $ECHO_C"
 for asm in ${srcdir}/$2/*.asm
 do
     a=`echo ${asm} | sed 's,^.*/,,;s,.asm$,,'`
-    o=${a}$5
-    oh=${a}.hx
+    # Results are named with $6 (if any) prepended, so that another test can
+    # use the same sources with different options.
+    r=$6${a}
+    o=${r}$5
+    oh=${r}.hx
     og=`echo ${asm} | sed 's,.asm$,.hex,'`
-    e=${a}.ew
+    e=${r}.ew
     eg=`echo ${asm} | sed 's,.asm$,.errwarn,'`
     if test \! -f ${eg}; then
         eg=/dev/null
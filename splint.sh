@@ -42,9 +42,12 @@ splint \
  libyasm/md5.c \
  libyasm/mergesort.c \
  libyasm/phash.c \
+ libyasm/preproc.c \
  libyasm/section.c \
+ libyasm/sizehints.c \
  libyasm/strcasecmp.c \
  libyasm/strsep.c \
+ libyasm/strtab.c \
  libyasm/symrec.c \
  libyasm/valparam.c \
  libyasm/value.c \
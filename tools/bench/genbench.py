@@ -0,0 +1,235 @@
+#!/usr/bin/env python
+# Generate a scalable benchmark corpus for the yasm frontend.
+#
+#  Copyright (C) 2026  Yasm developers
+#
+# Redistribution and use in source and binary forms, with or without
+# modification, are permitted provided that the following conditions
+# are met:
+# 1. Redistributions of source code must retain the above copyright
+#    notice, this list of conditions and the following disclaimer.
+# 2. Redistributions in binary form must reproduce the above copyright
+#    notice, this list of conditions and the following disclaimer in the
+#    documentation and/or other materials provided with the distribution.
+#
+# THIS SOFTWARE IS PROVIDED BY THE AUTHOR AND OTHER CONTRIBUTORS ``AS IS''
+# AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+# IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+# ARE DISCLAIMED.  IN NO EVENT SHALL THE AUTHOR OR OTHER CONTRIBUTORS BE
+# LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+# CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+# SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+# INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+# CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+# ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+# POSSIBILITY OF SUCH DAMAGE.
+#
+# Each workload is written as <name>.asm (NASM syntax) or <name>.s (GAS
+# syntax) into the output directory.  Sizes are proportional to the scale
+# factor; scale 1 gives inputs of roughly 100k-200k lines that assemble in a
+# second or two, scale 10 gives millions of instructions.  The output is a
+# pure function of the scale so reports from different runs are comparable.
+#
+# Usage: genbench.py [-s scale] [outdir]
+
+import os
+import sys
+
+class LCG(object):
+    """Tiny deterministic generator; random.Random differs across Pythons."""
+    def __init__(self, seed):
+        self.state = seed & 0xffffffff
+
+    def next(self, n):
+        self.state = (self.state * 1103515245 + 12345) & 0x7fffffff
+        return self.state % n
+
+regs = ["rax", "rbx", "rcx", "rdx", "rsi", "rdi", "rbp",
+        "r8", "r9", "r10", "r11", "r12", "r13", "r14", "r15"]
+regs32 = ["eax", "ebx", "ecx", "edx", "esi", "edi", "ebp",
+          "r8d", "r9d", "r10d", "r11d", "r12d", "r13d", "r14d", "r15d"]
+
+def random_insn(rng):
+    """A mix of common register/memory/immediate forms."""
+    k = rng.next(8)
+    r1 = regs[rng.next(len(regs))]
+    r2 = regs[rng.next(len(regs))]
+    if k == 0:
+        return "mov %s, %s" % (r1, r2)
+    if k == 1:
+        return "add %s, %d" % (r1, rng.next(100000))
+    if k == 2:
+        return "mov %s, [%s+%d]" % (regs32[rng.next(len(regs32))], r2,
+                                   rng.next(4096))
+    if k == 3:
+        return "lea %s, [%s+%s*4+%d]" % (r1, r2, regs[rng.next(6)],
+                                         rng.next(256))
+    if k == 4:
+        return "xor %s, %s" % (regs32[rng.next(len(regs32))],
+                               regs32[rng.next(len(regs32))])
+    if k == 5:
+        return "cmp %s, %d" % (r1, rng.next(128))
+    if k == 6:
+        return "push %s" % r1
+    return "pop %s" % r1
+
+def gen_insns(f, scale):
+    """Straight-line code: parser, insn finalization and output."""
+    rng = LCG(1)
+    f.write("bits 64\nsection .text\n")
+    for i in range(200000 * scale):
+        f.write("%s\n" % random_insn(rng))
+
+def gen_jumps(f, scale):
+    """Dense forward/backward branches: exercises the span optimizer."""
+    rng = LCG(2)
+    n = 100000 * scale
+    f.write("bits 64\nsection .text\n")
+    for i in range(n):
+        k = rng.next(10)
+        if k < 3:
+            # mostly short, some long, both directions
+            if rng.next(4) == 0:
+                t = rng.next(n)
+            else:
+                t = max(0, min(n-1, i + rng.next(64) - 32))
+            f.write("L%d: %s L%d\n" % (i, ("jmp", "jz", "jnc")[k], t))
+        elif k == 3:
+            f.write("L%d: call L%d\n" % (i, rng.next(n)))
+        else:
+            f.write("L%d: %s\n" % (i, random_insn(rng)))
+
+def gen_chain(f, scale):
+    """Jumps each just in short range until the next one is expanded: the
+    expansions cascade backwards, one jump at a time."""
+    n = 20000 * scale
+    f.write("bits 64\nsection .text\n")
+    for i in range(n):
+        f.write("jmp M%d\nnop\nM%d:\ntimes 123 nop\n" % (i+1, i))
+    f.write("times 5 nop\nM%d:\n" % n)
+
+def gen_data(f, scale):
+    """Large data tables and TIMES/RES blocks."""
+    rng = LCG(3)
+    f.write("bits 64\nsection .data\n")
+    for i in range(20000 * scale):
+        k = rng.next(5)
+        if k == 0:
+            f.write("db %s\n" % ", ".join([str(rng.next(256))
+                                           for j in range(16)]))
+        elif k == 1:
+            f.write("dw %s\n" % ", ".join([str(rng.next(65536))
+                                           for j in range(8)]))
+        elif k == 2:
+            f.write("dd %s\n" % ", ".join(["0x%x" % rng.next(1 << 30)
+                                           for j in range(4)]))
+        elif k == 3:
+            f.write("dq tbl%d, %d\n" % (rng.next(16), rng.next(1 << 30)))
+        else:
+            f.write("times %d db %d\n" % (1 + rng.next(256), rng.next(256)))
+    for i in range(16):
+        f.write("tbl%d: times %d dd %d\n" % (i, 1000 * scale, i))
+    f.write("section .bss\n")
+    for i in range(1000 * scale):
+        f.write("resb %d\n" % (1 + rng.next(4096)))
+
+def gen_macros(f, scale):
+    """Deeply nested NASM macros and %rep: exercises the preprocessor."""
+    depth = 12
+    f.write("bits 64\nsection .text\n")
+    f.write("%macro m0 2\n  add %1, %2\n  xor %1, %2\n%endmacro\n")
+    for d in range(1, depth):
+        f.write("%%macro m%d 2\n" % d)
+        f.write("  m%d %%1, %%2\n" % (d-1))
+        f.write("  %%if %d %% 3 == 0\n    inc %%1\n  %%endif\n" % d)
+        f.write("%endmacro\n")
+    f.write("%assign i 0\n")
+    f.write("%%rep %d\n" % (5000 * scale))
+    f.write("  m%d rax, i\n" % (depth-1))
+    f.write("  %assign i i+1\n")
+    f.write("%endrep\n")
+
+def gen_gas(f, scale):
+    """GAS syntax with .macro and .rept."""
+    rng = LCG(5)
+    f.write(".code64\n.text\n")
+    f.write(".macro addxor r, v\n  add $\\v, %\\r\n  xor %\\r, %\\r\n"
+            ".endm\n")
+    f.write(".macro twice r, v\n  addxor \\r, \\v\n  addxor \\r, \\v+1\n"
+            ".endm\n")
+    for i in range(20000 * scale):
+        k = rng.next(4)
+        r = regs[rng.next(len(regs))]
+        if k == 0:
+            f.write("twice %s, %d\n" % (r, rng.next(1000)))
+        elif k == 1:
+            f.write(".rept 4\n  nop\n.endr\n")
+        elif k == 2:
+            f.write("movq %d(%%%s), %%%s\n" % (rng.next(4096),
+                    regs[rng.next(len(regs))], r))
+        else:
+            f.write("lbl%d: jmp lbl%d\n" % (i, rng.next(i+1)))
+
+def gen_symbols(f, scale):
+    """Huge numbers of labels and EQUs: symbol table and symbol output."""
+    rng = LCG(6)
+    n = 100000 * scale
+    names = []
+    f.write("bits 64\nsection .text\n")
+    for i in range(n):
+        names.append("sym_%d_%x" % (i, rng.next(1 << 24)))
+        f.write("%s: db %d\n" % (names[-1], rng.next(256)))
+    for i in range(n // 4):
+        f.write("equ_%d equ %d\n" % (i, rng.next(1 << 30)))
+    f.write("section .data\n")
+    for i in range(n // 4):
+        f.write("dq equ_%d + %s\n" % (i, names[rng.next(n)]))
+
+def gen_lines(f, scale):
+    """Many source lines with distinct line numbers, for line tables.
+    Assembled with a debug format (dwarf2 or cv8) by the runner."""
+    rng = LCG(7)
+    f.write("bits 64\nsection .text\n")
+    for i in range(1000 * scale):
+        f.write("func%d:\n" % i)
+        for j in range(100):
+            f.write("%s\n" % random_insn(rng))
+        f.write("ret\n")
+
+# name: (generator, file suffix)
+workloads = [
+    ("insns", gen_insns, ".asm"),
+    ("jumps", gen_jumps, ".asm"),
+    ("chain", gen_chain, ".asm"),
+    ("data", gen_data, ".asm"),
+    ("macros", gen_macros, ".asm"),
+    ("gas", gen_gas, ".s"),
+    ("symbols", gen_symbols, ".asm"),
+    ("lines", gen_lines, ".asm"),
+]
+
+def main(argv):
+    scale = 1
+    args = argv[1:]
+    if len(args) >= 2 and args[0] == "-s":
+        scale = int(args[1])
+        args = args[2:]
+    if len(args) > 1 or (args and args[0].startswith("-")) or scale < 1:
+        sys.stderr.write("Usage: genbench.py [-s scale] [outdir]\n")
+        return 2
+    outdir = args and args[0] or "bench"
+    if not os.path.isdir(outdir):
+        os.makedirs(outdir)
+    for name, gen, suffix in workloads:
+        path = os.path.join(outdir, name + suffix)
+        f = open(path, "w")
+        gen(f, scale)
+        f.close()
+        sys.stdout.write("generated %s\n" % path)
+    f = open(os.path.join(outdir, "SCALE"), "w")
+    f.write("%d\n" % scale)
+    f.close()
+    return 0
+
+if __name__ == "__main__":
+    sys.exit(main(sys.argv))
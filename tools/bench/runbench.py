@@ -0,0 +1,176 @@
+#!/usr/bin/env python
+# Run the benchmark corpus produced by genbench.py through yasm.
+#
+#  Copyright (C) 2026  Yasm developers
+#
+# Redistribution and use in source and binary forms, with or without
+# modification, are permitted provided that the following conditions
+# are met:
+# 1. Redistributions of source code must retain the above copyright
+#    notice, this list of conditions and the following disclaimer.
+# 2. Redistributions in binary form must reproduce the above copyright
+#    notice, this list of conditions and the following disclaimer in the
+#    documentation and/or other materials provided with the distribution.
+#
+# THIS SOFTWARE IS PROVIDED BY THE AUTHOR AND OTHER CONTRIBUTORS ``AS IS''
+# AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+# IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+# ARE DISCLAIMED.  IN NO EVENT SHALL THE AUTHOR OR OTHER CONTRIBUTORS BE
+# LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+# CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+# SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+# INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+# CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+# ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+# POSSIBILITY OF SUCH DAMAGE.
+#
+# Each workload is assembled for every output format (best of N runs by
+# wall time) with --stats=json.  Throughput (source lines/s and source
+# bytes/s; lines are counted before macro expansion), output size, peak RSS
+# and the per-phase times reported by yasm are written as a text table and
+# optionally a JSON report.  A previous JSON report can be given with -c to
+# print the relative change in wall time of each entry.
+#
+# Usage: runbench.py [-y yasm] [-n runs] [-o report.json] [-c old.json]
+#                    [corpusdir]
+
+import json
+import os
+import subprocess
+import sys
+import time
+
+formats = ["elf64", "win64", "macho64", "bin"]
+
+# Debug formats used for the line table workload, per output format; it is
+# skipped for formats without line table support (macho64 and bin).
+line_dbgfmts = {"elf64": "dwarf2", "win64": "cv8"}
+
+def count_lines(path):
+    f = open(path, "rb")
+    n = 0
+    for line in f:
+        n += 1
+    f.close()
+    return n
+
+def run_one(yasm, src, fmt, runs, outdir):
+    name = os.path.splitext(os.path.basename(src))[0]
+    out = os.path.join(outdir, "%s.%s.out" % (name, fmt))
+    cmd = [yasm, "--stats=json", "-f", fmt, "-o", out]
+    if src.endswith(".s"):
+        cmd += ["-p", "gas"]
+    if name == "lines":
+        cmd += ["-g", line_dbgfmts[fmt]]
+    cmd.append(src)
+
+    best = None
+    for i in range(runs):
+        start = time.time()
+        p = subprocess.Popen(cmd, stdout=subprocess.PIPE,
+                             stderr=subprocess.PIPE)
+        stdout, stderr = p.communicate()
+        wall = time.time() - start
+        if p.returncode != 0:
+            sys.stderr.write("%s failed:\n%s" % (" ".join(cmd),
+                                                 stderr.decode("latin-1")))
+            return None
+        if best is None or wall < best[0]:
+            best = (wall, json.loads(stdout.decode("latin-1")))
+
+    wall, stats = best
+    lines = count_lines(src)
+    size = os.path.getsize(src)
+    peak = 0
+    for phase in stats["phases"].values():
+        peak = max(peak, phase["peak_rss_kb"])
+    result = {
+        "workload": name,
+        "format": fmt,
+        "lines": lines,
+        "bytes": size,
+        "output_bytes": os.path.getsize(out),
+        "wall": round(wall, 6),
+        "lines_per_sec": round(lines / wall, 1),
+        "bytes_per_sec": round(size / wall, 1),
+        "peak_rss_kb": peak,
+        "phases": dict([(k, v["wall"]) for k, v in stats["phases"].items()]),
+        "counts": stats["counts"],
+    }
+    os.remove(out)
+    return result
+
+def main(argv):
+    yasm = "./yasm"
+    runs = 3
+    report = None
+    compare = None
+    args = argv[1:]
+    while args and args[0].startswith("-") and len(args) >= 2:
+        if args[0] == "-y":
+            yasm = args[1]
+        elif args[0] == "-n":
+            runs = int(args[1])
+        elif args[0] == "-o":
+            report = args[1]
+        elif args[0] == "-c":
+            compare = args[1]
+        else:
+            break
+        args = args[2:]
+    if len(args) > 1 or (args and args[0].startswith("-")):
+        sys.stderr.write("Usage: runbench.py [-y yasm] [-n runs] "
+                         "[-o report.json] [-c old.json] [corpusdir]\n")
+        return 2
+    corpus = args and args[0] or "bench"
+
+    scale = 0
+    if os.path.exists(os.path.join(corpus, "SCALE")):
+        scale = int(open(os.path.join(corpus, "SCALE")).read())
+    sources = sorted([os.path.join(corpus, f) for f in os.listdir(corpus)
+                      if f.endswith(".asm") or f.endswith(".s")])
+    if not sources:
+        sys.stderr.write("no benchmark sources in %s (run genbench.py)\n"
+                         % corpus)
+        return 1
+
+    old = {}
+    if compare:
+        for r in json.load(open(compare))["results"]:
+            old[(r["workload"], r["format"])] = r
+
+    results = []
+    failed = 0
+    print("%-8s %-8s %9s %9s %11s %13s %10s %8s" % (
+        "workload", "format", "lines", "wall (s)", "lines/s", "bytes/s",
+        "RSS (K)", "change"))
+    for src in sources:
+        for fmt in formats:
+            if src.endswith("lines.asm") and fmt not in line_dbgfmts:
+                continue
+            r = run_one(yasm, src, fmt, runs, corpus)
+            if r is None:
+                failed += 1
+                continue
+            results.append(r)
+            change = ""
+            o = old.get((r["workload"], fmt))
+            if o:
+                change = "%+.1f%%" % (100.0 * (r["wall"] - o["wall"])
+                                      / o["wall"])
+            print("%-8s %-8s %9d %9.3f %11.0f %13.0f %10d %8s" % (
+                r["workload"], fmt, r["lines"], r["wall"],
+                r["lines_per_sec"], r["bytes_per_sec"], r["peak_rss_kb"],
+                change))
+            sys.stdout.flush()
+
+    if report:
+        f = open(report, "w")
+        json.dump({"version": 1, "scale": scale, "runs": runs,
+                   "results": results}, f, indent=1, sort_keys=True)
+        f.write("\n")
+        f.close()
+    return failed and 1 or 0
+
+if __name__ == "__main__":
+    sys.exit(main(sys.argv))
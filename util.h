@@ -128,6 +128,22 @@
 # define yasm_xfree(ptr)                xfree(ptr)
 #endif
 
+/* Storage class for data each thread keeps its own copy of; it must directly
+ * follow "static" or "extern".  YASM_THREADS is defined if parts of the
+ * assembly can also run on threads of their own (see yasm_object_finalize()
+ * and yasm_preproc_pipe_create()); YASM_MEMORY_BARRIER() then orders the
+ * memory accesses before it against those after it.
+ */
+#ifdef HAVE_THREAD_LOCAL
+# define YASM_THREAD_LOCAL              __thread
+# if defined(HAVE_PTHREAD) && defined(HAVE_SYNC_SYNCHRONIZE)
+#  define YASM_THREADS                  1
+#  define YASM_MEMORY_BARRIER()         __sync_synchronize()
+# endif
+#else
+# define YASM_THREAD_LOCAL
+#endif
+
 /* Bit-counting: used primarily by HAMT but also in a few other places. */
 #define BC_TWO(c)       (0x1ul << (c))
 #define BC_MSK(c)       (((unsigned long)(-1)) / (BC_TWO(BC_TWO(c)) + 1ul))